@@ -1,11 +1,11 @@
-using System;
-using System.Collections.Generic;
-using System.Linq;
-using System.Text;
-using System.Runtime.InteropServices;
-using SparkLanguagePackageLib;
-
-namespace SparkLanguage
-{
-
-}
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Runtime.InteropServices;
+using SparkLanguagePackageLib;
+
+namespace SparkLanguage
+{
+
+}
@@ -1,251 +1,348 @@
-using System;
-using System.Collections.Generic;
-using System.Linq;
-using System.Text;
-using System.Runtime.InteropServices;
-using Spark.Compiler;
-using Spark.Parser.Markup;
-using SparkLanguage.VsAdapters;
-using SparkLanguagePackageLib;
-using Spark.Parser;
-using Spark;
-
-namespace SparkLanguage
-{
-    public class SourceSupervisor : ISourceSupervisor
-    {
-        readonly SparkViewEngine _engine;
-        readonly MarkupGrammar _grammar;
-        readonly ISparkSource _source;
-        readonly string _path;
-
-        uint _dwLastCookie;
-        readonly IDictionary<uint, ISourceSupervisorEvents> _events = new Dictionary<uint, ISourceSupervisorEvents>();
-
-        static SourceSupervisor()
-        {
-            // To enable Visual Studio to correlate errors, the location of the 
-            // error must be allowed to come from the natural location 
-            // in the generated file. This setting is changed for the entire 
-            // AppDomain running inside the devenv process.
-
-            SourceWriter.AdjustDebugSymbolsDefault = false;
-        }
-
-        public SourceSupervisor(ISparkSource source)
-        {
-            _source = source;
-
-            IVsHierarchy hierarchy;
-            uint itemid;
-            IVsTextLines buffer;
-            _source.GetDocument(out hierarchy, out itemid, out buffer);
-
-            _path = GetDocumentPath(hierarchy, itemid);
-
-
-            //Spark.Web.Mvc.SparkView
-            //MyBaseView
-
-            var settings = new VsProjectSparkSettings(hierarchy)
-                               {
-                                   PageBaseType = source.GetDefaultPageBaseType()
-                               };
-
-            var viewFolder = new VsProjectViewFolder(_source, hierarchy);
-
-            _engine = new SparkViewEngine(settings)
-                          {
-                              ViewFolder = viewFolder
-                          };
-
-            _grammar = new MarkupGrammar(settings);
-        }
-
-        private static string GetDocumentPath(IVsHierarchy hierarchy, uint itemid)
-        {
-            var rootid = -2;
-            var rootItem = new HierarchyItem(hierarchy, (uint)rootid);
-            var viewItem = rootItem.FirstOrDefault(child => child.Name == "Views");
-
-            var docItem = new HierarchyItem(hierarchy, itemid);
-            var path = docItem.Name;
-            while (!Equals(docItem.Parent, viewItem) &&
-                   !Equals(docItem.Parent, rootItem))
-            {
-                docItem = docItem.Parent;
-                path = docItem.Name + "\\" + path;
-            }
-
-            if (Equals(docItem.Parent, rootItem))
-                path = "$\\" + path;
-
-            return path;
-        }
-
-        public void Advise(ISourceSupervisorEvents pEvents, out uint pdwCookie)
-        {
-            pdwCookie = ++_dwLastCookie;
-            _events[_dwLastCookie] = pEvents;
-        }
-
-        public void Unadvise(uint dwCookie)
-        {
-            if (_events.ContainsKey(dwCookie))
-                _events.Remove(dwCookie);
-        }
-
-        class PaintInfo
-        {
-            public int Count { get; set; }
-            public _SOURCEPAINTING[] Paint { get; set; }
-            public Exception ParseError { get; set; }
-        }
-
-        class MappingInfo
-        {
-            public string GeneratedCode { get; set; }
-            public int Count { get; set; }
-            public _SOURCEMAPPING[] Mapping { get; set; }
-            public Exception GenerationError { get; set; }
-        }
-
-        public void PrimaryTextChanged(int processImmediately)
-        {
-            var primaryText = _source.GetPrimaryText();
-
-            var paintInfo = GetPaintInfo(primaryText);
-
-            var mappingInfo = GetMappingInfo();
-
-
-            foreach (var events in _events.Values)
-            {
-                events.OnGenerated(
-                    primaryText,
-                    mappingInfo.GeneratedCode,
-                    mappingInfo.Count,
-                    ref mappingInfo.Mapping[0],
-                    paintInfo.Count,
-                    ref paintInfo.Paint[0]);
-            }
-        }
-
-        private PaintInfo GetPaintInfo(string primaryText)
-        {
-            var paintInfo = new PaintInfo();
-            try
-            {
-                var sourceContext = new SourceContext(primaryText, 0, _path);
-                var result = _grammar.Nodes(new Position(sourceContext));
-
-                paintInfo.Paint = result.Rest.GetPaint()
-                    .OfType<Paint<SparkTokenType>>()
-                    .Where(p => string.Equals(p.Begin.SourceContext.FileName, _path,
-                                              StringComparison.InvariantCultureIgnoreCase))
-                    .Select(p => new _SOURCEPAINTING
-                                     {
-                                         start = p.Begin.Offset,
-                                         end = p.End.Offset,
-                                         color = (int)p.Value
-                                     })
-                    .ToArray();
-
-                paintInfo.Count = paintInfo.Paint.Length;
-            }
-            catch (Exception ex)
-            {
-                paintInfo.ParseError = ex;
-            }
-
-            if (paintInfo.Count == 0)
-                paintInfo.Paint = new _SOURCEPAINTING[1];
-            return paintInfo;
-        }
-
-        private MappingInfo GetMappingInfo()
-        {
-            var mappingInfo = new MappingInfo();
-            try
-            {
-                var descriptor = new SparkViewDescriptor()
-                    .AddTemplate(_path);
-
-                var entry = _engine.CreateEntryInternal(descriptor, false);
-
-                mappingInfo.GeneratedCode = entry.SourceCode;
-
-                mappingInfo.Mapping = entry.SourceMappings
-                    .Where(m => string.Equals(m.Source.Begin.SourceContext.FileName, _path,
-                                              StringComparison.InvariantCultureIgnoreCase))
-                    .Select(m => new _SOURCEMAPPING
-                    {
-                        start1 = m.Source.Begin.Offset,
-                        end1 = m.Source.End.Offset,
-                        start2 = m.OutputBegin,
-                        end2 = m.OutputEnd
-                    })
-                    .ToArray();
-
-                mappingInfo.Count = mappingInfo.Mapping.Length;
-            }
-            catch (Exception ex)
-            {
-                mappingInfo.GenerationError = ex;
-            }
-
-            if (mappingInfo.Count == 0)
-                mappingInfo.Mapping = new _SOURCEMAPPING[1];
-            return mappingInfo;
-        }
-
-        public void OnTypeChar(IVsTextView pView, string ch)
-        {
-            if (ch == "{")
-            {
-                // add a closing "}" if it makes a complete expression or condition where one doesn't exist otherwise
-
-                _TextSpan selection;
-                pView.GetSelectionSpan(out selection);
-
-                IVsTextLines buffer;
-                pView.GetBuffer(out buffer);
-
-                string before;
-                buffer.GetLineText(0, 0, selection.iStartLine, selection.iStartIndex, out before);
-
-                int iLastLine, iLastColumn;
-                buffer.GetLastLineIndex(out iLastLine, out iLastColumn);
-
-                string after;
-                buffer.GetLineText(selection.iEndLine, selection.iEndIndex, iLastLine, iLastColumn, out after);
-
-                var existingResult = _grammar.Nodes(new Position(new SourceContext(before + ch + after)));
-                var expressionHits = existingResult.Rest.GetPaint()
-                    .OfType<Paint<Node>>()
-                    .Where(p => p.Begin.Offset <= before.Length && before.Length <= p.End.Offset && (p.Value is ExpressionNode || p.Value is ConditionNode));
-
-                // if a node exists normally, do nothing
-                if (expressionHits.Count() != 0)
-                    return;
-
-                var withCloseResult = _grammar.Nodes(new Position(new SourceContext(before + ch + "}" + after)));
-                var withCloseHits = withCloseResult.Rest.GetPaint()
-                    .OfType<Paint<Node>>()
-                    .Where(p => p.Begin.Offset <= before.Length && before.Length <= p.End.Offset && (p.Value is ExpressionNode || p.Value is ConditionNode));
-
-                // if a close brace doesn't cause a node to exist, do nothing
-                if (withCloseHits.Count() == 0)
-                    return;
-
-                // add a closing } after the selection, then set the selection back to what it was
-                int iAnchorLine, iAnchorCol, iEndLine, iEndCol;
-                pView.GetSelection(out iAnchorLine, out iAnchorCol, out iEndLine, out iEndCol);
-                _TextSpan inserted;
-                buffer.ReplaceLines(selection.iEndLine, selection.iEndIndex, selection.iEndLine, selection.iEndIndex, "}", 1, out inserted);
-                pView.SetSelection(iAnchorLine, iAnchorCol, iEndLine, iEndCol);
-            }
-        }
-
-    }
-}
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using System.Runtime.InteropServices;
+using Spark.Compiler;
+using Spark.Parser.Markup;
+using SparkLanguage.VsAdapters;
+using SparkLanguagePackageLib;
+using Spark.Parser;
+using Spark;
+
+namespace SparkLanguage
+{
+    public class SourceSupervisor : ISourceSupervisor, ISourceSupervisor2
+    {
+        readonly SparkViewEngine _engine;
+        readonly MarkupGrammar _grammar;
+        readonly ISparkSource _source;
+        readonly string _path;
+
+        uint _dwLastCookie;
+        readonly IDictionary<uint, ISourceSupervisorEvents> _events = new Dictionary<uint, ISourceSupervisorEvents>();
+
+        // what each sink taking deltas was last sent, the base of the next delta
+        readonly IDictionary<uint, DeliveredInfo> _delivered = new Dictionary<uint, DeliveredInfo>();
+        int _lastGeneration;
+
+        static SourceSupervisor()
+        {
+            // To enable Visual Studio to correlate errors, the location of the 
+            // error must be allowed to come from the natural location 
+            // in the generated file. This setting is changed for the entire 
+            // AppDomain running inside the devenv process.
+
+            SourceWriter.AdjustDebugSymbolsDefault = false;
+        }
+
+        public SourceSupervisor(ISparkSource source)
+        {
+            _source = source;
+
+            IVsHierarchy hierarchy;
+            uint itemid;
+            IVsTextLines buffer;
+            _source.GetDocument(out hierarchy, out itemid, out buffer);
+
+            _path = GetDocumentPath(hierarchy, itemid);
+
+
+            //Spark.Web.Mvc.SparkView
+            //MyBaseView
+
+            var settings = new VsProjectSparkSettings(hierarchy)
+                               {
+                                   PageBaseType = source.GetDefaultPageBaseType()
+                               };
+
+            var viewFolder = new VsProjectViewFolder(_source, hierarchy);
+
+            _engine = new SparkViewEngine(settings)
+                          {
+                              ViewFolder = viewFolder
+                          };
+
+            _grammar = new MarkupGrammar(settings);
+        }
+
+        private static string GetDocumentPath(IVsHierarchy hierarchy, uint itemid)
+        {
+            var rootid = -2;
+            var rootItem = new HierarchyItem(hierarchy, (uint)rootid);
+            var viewItem = rootItem.FirstOrDefault(child => child.Name == "Views");
+
+            var docItem = new HierarchyItem(hierarchy, itemid);
+            var path = docItem.Name;
+            while (!Equals(docItem.Parent, viewItem) &&
+                   !Equals(docItem.Parent, rootItem))
+            {
+                docItem = docItem.Parent;
+                path = docItem.Name + "\\" + path;
+            }
+
+            if (Equals(docItem.Parent, rootItem))
+                path = "$\\" + path;
+
+            return path;
+        }
+
+        public void Advise(ISourceSupervisorEvents pEvents, out uint pdwCookie)
+        {
+            pdwCookie = ++_dwLastCookie;
+            _events[_dwLastCookie] = pEvents;
+        }
+
+        public void Unadvise(uint dwCookie)
+        {
+            if (_events.ContainsKey(dwCookie))
+                _events.Remove(dwCookie);
+            if (_delivered.ContainsKey(dwCookie))
+                _delivered.Remove(dwCookie);
+        }
+
+        class MappingInfo
+        {
+            public string GeneratedCode { get; set; }
+            public int Count { get; set; }
+            public _SOURCEMAPPING[] Mapping { get; set; }
+            public Exception GenerationError { get; set; }
+        }
+
+        class DeliveredInfo
+        {
+            public int Generation { get; set; }
+            public int PrimaryLength { get; set; }
+            public string GeneratedCode { get; set; }
+            public _SOURCEMAPPING[] Mapping { get; set; }
+        }
+
+        public void PrimaryTextChanged(int processImmediately)
+        {
+            var primaryText = _source.GetPrimaryText();
+
+            // markup is colored natively by the package - only generation happens here
+            var mappingInfo = GetMappingInfo();
+
+            var current = new DeliveredInfo
+                              {
+                                  Generation = ++_lastGeneration,
+                                  PrimaryLength = (primaryText ?? "").Length,
+                                  GeneratedCode = mappingInfo.GeneratedCode ?? "",
+                                  Mapping = mappingInfo.Mapping.Take(mappingInfo.Count).ToArray()
+                              };
+            var primaryHash = HashText(primaryText ?? "");
+
+            foreach (var pair in _events)
+            {
+                var events2 = pair.Value as ISourceSupervisorEvents2;
+                if (events2 == null)
+                {
+                    var noPaint = new _SOURCEPAINTING[1];
+                    pair.Value.OnGenerated(
+                        primaryText,
+                        mappingInfo.GeneratedCode,
+                        mappingInfo.Count,
+                        ref mappingInfo.Mapping[0],
+                        0,
+                        ref noPaint[0]);
+                    continue;
+                }
+
+                // only what changed since the last delivery goes across, unless the sink lost track of it
+                DeliveredInfo previous;
+                _delivered.TryGetValue(pair.Key, out previous);
+                if (previous == null || !SendDelta(events2, previous, current, primaryHash))
+                    SendDelta(events2, null, current, primaryHash);
+                _delivered[pair.Key] = current;
+            }
+        }
+
+        private static bool SendDelta(ISourceSupervisorEvents2 events, DeliveredInfo previous, DeliveredInfo current, int primaryHash)
+        {
+            var previousCode = previous == null ? "" : previous.GeneratedCode;
+            var previousMapping = previous == null ? new _SOURCEMAPPING[0] : previous.Mapping;
+            var primaryShift = current.PrimaryLength - (previous == null ? 0 : previous.PrimaryLength);
+            var generatedShift = current.GeneratedCode.Length - previousCode.Length;
+
+            // the generated code between its common prefix and suffix is replaced as one edit
+            var code = current.GeneratedCode;
+            var shorter = Math.Min(previousCode.Length, code.Length);
+            var prefix = 0;
+            while (prefix != shorter && previousCode[prefix] == code[prefix])
+                ++prefix;
+            var suffix = 0;
+            while (suffix != shorter - prefix && previousCode[previousCode.Length - suffix - 1] == code[code.Length - suffix - 1])
+                ++suffix;
+
+            var inserted = code.Substring(prefix, code.Length - prefix - suffix);
+            var textEdits = new[]
+                                {
+                                    new _GENERATEDTEXTEDIT
+                                        {
+                                            start = prefix,
+                                            end = previousCode.Length - suffix,
+                                            insertStart = 0,
+                                            insertEnd = inserted.Length
+                                        }
+                                };
+
+            _SOURCEMAPPING[] insertedMapping;
+            var mappingOps = new[]
+                                 {
+                                     DiffItems(previousMapping, current.Mapping,
+                                               (a, b) => a.Equals(b),
+                                               (a, b) => a.start1 + primaryShift == b.start1 && a.end1 + primaryShift == b.end1 &&
+                                                         a.start2 + generatedShift == b.start2 && a.end2 + generatedShift == b.end2,
+                                               primaryShift, generatedShift, out insertedMapping)
+                                 };
+
+            var mappingCount = insertedMapping.Length;
+            if (mappingCount == 0)
+                insertedMapping = new _SOURCEMAPPING[1];
+
+            var applied = events.OnGeneratedDelta(
+                current.Generation,
+                previous == null ? 0 : previous.Generation,
+                current.PrimaryLength,
+                primaryHash,
+                textEdits.Length,
+                ref textEdits[0],
+                inserted,
+                mappingOps.Length,
+                ref mappingOps[0],
+                mappingCount,
+                ref insertedMapping[0]);
+            return applied != 0;
+        }
+
+        private static _SOURCEDELTAOP DiffItems<T>(T[] previous, T[] current, Func<T, T, bool> sameBefore, Func<T, T, bool> sameAfter, int shift1, int shift2, out T[] inserted)
+        {
+            // items before the change are untouched, items after it are only moved
+            var prefix = 0;
+            while (prefix != previous.Length && prefix != current.Length && sameBefore(previous[prefix], current[prefix]))
+                ++prefix;
+            var suffix = 0;
+            while (suffix != previous.Length - prefix && suffix != current.Length - prefix &&
+                   sameAfter(previous[previous.Length - suffix - 1], current[current.Length - suffix - 1]))
+                ++suffix;
+
+            inserted = current.Skip(prefix).Take(current.Length - prefix - suffix).ToArray();
+            return new _SOURCEDELTAOP
+                       {
+                           index = prefix,
+                           cRemove = previous.Length - prefix - suffix,
+                           cInsert = inserted.Length,
+                           shift1 = shift1,
+                           shift2 = shift2
+                       };
+        }
+
+        private static int HashText(string text)
+        {
+            // FNV-1a over the UTF-16 code units, the same as the package's GeneratedState::HashText
+            unchecked
+            {
+                var hash = 2166136261;
+                foreach (var ch in text)
+                {
+                    hash ^= ch;
+                    hash *= 16777619;
+                }
+                return (int)hash;
+            }
+        }
+
+        private MappingInfo GetMappingInfo()
+        {
+            var mappingInfo = new MappingInfo();
+            try
+            {
+                var descriptor = new SparkViewDescriptor()
+                    .AddTemplate(_path);
+
+                var entry = _engine.CreateEntryInternal(descriptor, false);
+
+                mappingInfo.GeneratedCode = entry.SourceCode;
+
+                mappingInfo.Mapping = entry.SourceMappings
+                    .Where(m => string.Equals(m.Source.Begin.SourceContext.FileName, _path,
+                                              StringComparison.InvariantCultureIgnoreCase))
+                    .Select(m => new _SOURCEMAPPING
+                    {
+                        start1 = m.Source.Begin.Offset,
+                        end1 = m.Source.End.Offset,
+                        start2 = m.OutputBegin,
+                        end2 = m.OutputEnd
+                    })
+                    .ToArray();
+
+                mappingInfo.Count = mappingInfo.Mapping.Length;
+            }
+            catch (Exception ex)
+            {
+                mappingInfo.GenerationError = ex;
+            }
+
+            if (mappingInfo.Count == 0)
+                mappingInfo.Mapping = new _SOURCEMAPPING[1];
+            return mappingInfo;
+        }
+
+        const string TypeCharTriggers = "{";
+
+        public string GetTypeCharTriggers()
+        {
+            return TypeCharTriggers;
+        }
+
+        public void OnTypeChar(IVsTextView pView, string ch)
+        {
+            if (ch == "{")
+            {
+                // add a closing "}" if it makes a complete expression or condition where one doesn't exist otherwise
+
+                _TextSpan selection;
+                pView.GetSelectionSpan(out selection);
+
+                IVsTextLines buffer;
+                pView.GetBuffer(out buffer);
+
+                string before;
+                buffer.GetLineText(0, 0, selection.iStartLine, selection.iStartIndex, out before);
+
+                int iLastLine, iLastColumn;
+                buffer.GetLastLineIndex(out iLastLine, out iLastColumn);
+
+                string after;
+                buffer.GetLineText(selection.iEndLine, selection.iEndIndex, iLastLine, iLastColumn, out after);
+
+                var existingResult = _grammar.Nodes(new Position(new SourceContext(before + ch + after)));
+                var expressionHits = existingResult.Rest.GetPaint()
+                    .OfType<Paint<Node>>()
+                    .Where(p => p.Begin.Offset <= before.Length && before.Length <= p.End.Offset && (p.Value is ExpressionNode || p.Value is ConditionNode));
+
+                // if a node exists normally, do nothing
+                if (expressionHits.Count() != 0)
+                    return;
+
+                var withCloseResult = _grammar.Nodes(new Position(new SourceContext(before + ch + "}" + after)));
+                var withCloseHits = withCloseResult.Rest.GetPaint()
+                    .OfType<Paint<Node>>()
+                    .Where(p => p.Begin.Offset <= before.Length && before.Length <= p.End.Offset && (p.Value is ExpressionNode || p.Value is ConditionNode));
+
+                // if a close brace doesn't cause a node to exist, do nothing
+                if (withCloseHits.Count() == 0)
+                    return;
+
+                // add a closing } after the selection, then set the selection back to what it was
+                int iAnchorLine, iAnchorCol, iEndLine, iEndCol;
+                pView.GetSelection(out iAnchorLine, out iAnchorCol, out iEndLine, out iEndCol);
+                _TextSpan inserted;
+                buffer.ReplaceLines(selection.iEndLine, selection.iEndIndex, selection.iEndLine, selection.iEndIndex, "}", 1, out inserted);
+                pView.SetSelection(iAnchorLine, iAnchorCol, iEndLine, iEndCol);
+            }
+        }
+
+    }
+}
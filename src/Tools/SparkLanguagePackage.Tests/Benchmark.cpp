@@ -0,0 +1,42 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+
+static volatile LONGLONG s_allocations;
+
+#ifdef __GLIBC__
+
+// counted on the way through to the C library's own allocator
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_realloc(void* pv, size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+	InterlockedIncrement64(&s_allocations);
+	return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* pv, size_t size)
+{
+	InterlockedIncrement64(&s_allocations);
+	return __libc_realloc(pv, size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+	InterlockedIncrement64(&s_allocations);
+	return __libc_calloc(count, size);
+}
+
+#endif
+
+LONGLONG GetAllocationCount()
+{
+	return InterlockedCompareExchange64(&s_allocations, 0, 0);
+}
+
+void ReportBenchmark(const char* name, long cLines, double value, const char* units, double allocations)
+{
+	printf("%-28s %7ld lines %12.1f %-14s %10.1f allocations/pass\n", name, cLines, value, units, allocations);
+	fflush(stdout);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// Shared by the benchmarks in PackageBenchmark. Each one runs against a SyntheticView 
+// of the given number of lines and prints one line per measurement.
+
+// allocations made through malloc, realloc and calloc (and so operator new) so far
+LONGLONG GetAllocationCount();
+
+// wall clock in nanoseconds, the same units as Diagnostics::Now in the portable build
+inline LONGLONG BenchmarkNow()
+{
+	return PortableNanoseconds();
+}
+
+void ReportBenchmark(const char* name, long cLines, double value, const char* units, double allocations);
+
+void RunColorizeBenchmark(long cLines, long cPasses);
+void RunDiffBenchmark(long cLines, long cPasses);
+void RunLineIndexBenchmark(long cLines, long cPasses);
+void RunRegenerationBenchmark(long cLines, long cPasses);
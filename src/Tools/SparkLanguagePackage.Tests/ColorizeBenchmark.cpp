@@ -0,0 +1,149 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "SyntheticView.h"
+#include "MemoryTextTarget.h"
+#include "MarkupTokenizer.h"
+
+// the number of contained language colors ahead of the markup colors, as C# has
+static const ULONG s_containedColorCount = 16;
+
+// What Colorizer::ColorizeLine does for every line the editor shows - markup from the 
+// tokenizer, then each contained language run from the line's mapping fragments, which 
+// a stand-in fills the way a contained colorizer would.
+static long ColorizeLine(const WCHAR* pText, long iLine, long cchLine, long state, const SpanMappingTable& mappingTable, ULONG* pAttributes)
+{
+	long endState = MarkupTokenizer::ColorizeLine(pText, cchLine, state, s_containedColorCount, pAttributes);
+
+	long cFragments = 0;
+	const SpanMappingTable::Fragment* rgFragments = mappingTable.GetLine(iLine, &cFragments);
+	for (long index = 0; index != cFragments; ++index)
+	{
+		long iStart = 0;
+		long iEnd = 0;
+		if (!SpanMappingTable::ClampToLine(rgFragments[index], cchLine, &iStart, &iEnd))
+			continue;
+		for (long iIndex = iStart; iIndex != iEnd; ++iIndex)
+			pAttributes[iIndex] = 1;
+	}
+	return endState;
+}
+
+// the same fill one attribute at a time, as ColorizeLine did before FillAttributes
+static void ScalarFillAttributes(ULONG* pAttributes, long count, ULONG value)
+{
+	for (long index = 0; index != count; ++index)
+		pAttributes[index] = value;
+}
+
+// The whole view on one line, as a minified template has it - colorized in one call, 
+// and the attribute fill alone for a run that long, wide and one at a time
+static void RunLongLineBenchmark(const SyntheticView& view, long cPasses)
+{
+	const CStringW& primary = view.GetPrimary();
+	CStringW line;
+	const WCHAR* pPrimary = primary;
+	for (long index = 0; index != primary.GetLength(); ++index)
+	{
+		if (pPrimary[index] != L'\r' && pPrimary[index] != L'\n')
+			line.AppendChar(pPrimary[index]);
+	}
+	long length = line.GetLength();
+	PooledArray<ULONG> attributes;
+	attributes.SetCount(length + 1);
+
+	LONGLONG ticks = 0;
+	LONGLONG wideTicks = 0;
+	LONGLONG scalarTicks = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		LONGLONG start = BenchmarkNow();
+		MarkupTokenizer::ColorizeLine(line, length, MarkupStateText, s_containedColorCount, attributes.GetData());
+		LONGLONG wideStart = BenchmarkNow();
+		MarkupTokenizer::FillAttributes(attributes.GetData(), length + 1, (ULONG)pass);
+		LONGLONG scalarStart = BenchmarkNow();
+		ScalarFillAttributes(attributes.GetData(), length + 1, (ULONG)pass);
+		if (pass != 0)
+		{
+			ticks += wideStart - start;
+			wideTicks += scalarStart - wideStart;
+			scalarTicks += BenchmarkNow() - scalarStart;
+		}
+	}
+	ReportBenchmark("colorize one long line", view.GetLineCount(), (double)ticks / cPasses / length, "ns/char", 0);
+	ReportBenchmark("fill attributes wide", view.GetLineCount(), (double)wideTicks / cPasses / (length + 1), "ns/char", 0);
+	ReportBenchmark("fill attributes scalar", view.GetLineCount(), (double)scalarTicks / cPasses / (length + 1), "ns/char", 0);
+}
+
+void RunColorizeBenchmark(long cLines, long cPasses)
+{
+	SyntheticView view;
+	view.Build(cLines, 0x5EED);
+	const CStringW& primary = view.GetPrimary();
+	const WCHAR* pPrimary = primary;
+
+	// mappings by line, as the source has them after a generation
+	LineIndex primaryLines;
+	primaryLines.Build(primary, primary.GetLength());
+	MemoryTextTarget target;
+	SpanMappingTable mappingTable;
+	SecondaryTextBuffers buffers;
+	SecondaryText::Apply(
+		&target, primaryLines, 
+		view.GetSecondary(), view.GetSecondary().GetLength(), 
+		view.GetMappings().GetData(), (long)view.GetMappings().GetCount(), 
+		mappingTable, buffers);
+
+	LineTable lines;
+	lines.Build(primary, primary.GetLength());
+	long cchLongest = 0;
+	for (long iLine = 0; iLine != lines.GetLineCount(); ++iLine)
+		cchLongest = std::max(cchLongest, lines.GetLineStart(iLine + 1) - lines.GetLineStart(iLine));
+	PooledArray<ULONG> attributes;
+	attributes.SetCount(cchLongest + 1);
+
+	// a full pass over every line, carrying the state from one line to the next the way 
+	// the editor's line state cache does. the first pass isn't counted
+	LONGLONG ticks = 0;
+	LONGLONG allocations = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		LONGLONG start = BenchmarkNow();
+		LONGLONG allocationsStart = GetAllocationCount();
+
+		long state = MarkupStateText;
+		for (long iLine = 0; iLine != lines.GetLineCount(); ++iLine)
+		{
+			long iStart = lines.GetLineStart(iLine);
+			long cchLine = lines.GetLineStart(iLine + 1) - iStart;
+			while (cchLine != 0 && (pPrimary[iStart + cchLine - 1] == L'\r' || pPrimary[iStart + cchLine - 1] == L'\n'))
+				--cchLine;
+			state = ColorizeLine(pPrimary + iStart, iLine, cchLine, state, mappingTable, attributes.GetData());
+		}
+
+		if (pass != 0)
+		{
+			ticks += BenchmarkNow() - start;
+			allocations += GetAllocationCount() - allocationsStart;
+		}
+	}
+	ReportBenchmark("colorize", cLines, (double)ticks / cPasses / lines.GetLineCount(), "ns/line", (double)allocations / cPasses);
+
+	// ISparkSource::GetPaint, for whoever still asks for a whole document's paint
+	PooledArray<SourcePainting> paints;
+	ticks = 0;
+	allocations = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		LONGLONG start = BenchmarkNow();
+		LONGLONG allocationsStart = GetAllocationCount();
+		MarkupTokenizer::Tokenize(primary, primary.GetLength(), paints);
+		if (pass != 0)
+		{
+			ticks += BenchmarkNow() - start;
+			allocations += GetAllocationCount() - allocationsStart;
+		}
+	}
+	ReportBenchmark("get paint", cLines, (double)ticks / cPasses / 1000, "us/pass", (double)allocations / cPasses);
+
+	RunLongLineBenchmark(view, cPasses);
+}
@@ -0,0 +1,207 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "Diagnostics.h"
+
+static bool TextIs(BSTR text, const WCHAR* expected)
+{
+	long length = (long)wcslen(expected);
+	if ((long)SysStringLen(text) == length && memcmp(text, expected, length * sizeof(WCHAR)) == 0)
+		return true;
+
+	printf("  expected: ");
+	for (long index = 0; index != length; ++index)
+		printf("%c", (char)expected[index]);
+	printf("\n  actual:   ");
+	for (long index = 0; index != (long)SysStringLen(text); ++index)
+		printf("%c", (char)text[index]);
+	printf("\n");
+	return false;
+}
+
+// portable ticks are nanoseconds
+static LONGLONG Microseconds(LONGLONG microseconds)
+{
+	return microseconds * 1000;
+}
+
+TEST(DumpListsCountersAndBucketsInUse)
+{
+	Diagnostics diagnostics;
+	diagnostics.Add(SparkCounterRegenerations, 3);
+	diagnostics.Add(SparkCounterBytesCopied, 4096);
+	diagnostics.Set(SparkCounterMappingCount, 12);
+	diagnostics.Record(SparkTimingOnGenerated, 0);
+	diagnostics.Record(SparkTimingOnGenerated, Microseconds(1500));
+	diagnostics.Record(SparkTimingOnGenerated, Microseconds(2000));
+	diagnostics.Record(SparkTimingColorizePass, Microseconds(3));
+
+	Diagnostics::Block block;
+	Diagnostics::Clear(block);
+	diagnostics.Read(block);
+
+	CComBSTR text;
+	CHECK_EQUAL(S_OK, Diagnostics::Dump(block, &text));
+	CHECK(TextIs(text,
+		L"Regenerations 3\r\n"
+		L"CoalescedRegenerations 0\r\n"
+		L"CancelledRegenerations 0\r\n"
+		L"MappingCount 12\r\n"
+		L"BytesCopied 4096\r\n"
+		L"DeferredRegenerations 0\r\n"
+		L"EnsureSecondaryBufferReady\r\n"
+		L"OnGenerated <1us:1 <2048us:2\r\n"
+		L"BeginColorization\r\n"
+		L"ColorizePass <4us:1\r\n"));
+}
+
+TEST(CountersAndHistogramsReadBack)
+{
+	Diagnostics diagnostics;
+	diagnostics.Add(SparkCounterCancelledRegenerations, 2);
+	diagnostics.Record(SparkTimingBeginColorization, Microseconds(5));
+
+	Diagnostics::Block block;
+	Diagnostics::Clear(block);
+	diagnostics.Read(block);
+
+	LONGLONG value = -1;
+	CHECK_EQUAL(S_OK, Diagnostics::GetCounter(block, SparkCounterCancelledRegenerations, &value));
+	CHECK_EQUAL(2, value);
+	CHECK_EQUAL(E_INVALIDARG, Diagnostics::GetCounter(block, SparkCounterMaximum, &value));
+
+	LONGLONG rgCounts[Diagnostics::HistogramBuckets + 4];
+	long cBuckets = 0;
+	CHECK_EQUAL(S_OK, Diagnostics::GetHistogram(block, SparkTimingBeginColorization, _countof(rgCounts), rgCounts, &cBuckets));
+	CHECK_EQUAL(Diagnostics::HistogramBuckets, cBuckets);
+	CHECK_EQUAL(1, rgCounts[3]);
+	CHECK_EQUAL(S_OK, Diagnostics::GetHistogram(block, SparkTimingBeginColorization, 2, rgCounts, &cBuckets));
+	CHECK_EQUAL(2, cBuckets);
+	CHECK_EQUAL(E_INVALIDARG, Diagnostics::GetHistogram(block, SparkTimingMaximum, 2, rgCounts, &cBuckets));
+}
+
+TEST(ResetClearsTotalsButNotSizes)
+{
+	Diagnostics diagnostics;
+	diagnostics.Add(SparkCounterRegenerations, 5);
+	diagnostics.Set(SparkCounterMappingCount, 40);
+	diagnostics.Record(SparkTimingColorizePass, 0);
+	diagnostics.Reset();
+	diagnostics.Add(SparkCounterRegenerations, 1);
+
+	Diagnostics::Block block;
+	Diagnostics::Clear(block);
+	diagnostics.Read(block);
+	CHECK_EQUAL(1, block.counters[SparkCounterRegenerations]);
+	CHECK_EQUAL(40, block.counters[SparkCounterMappingCount]);
+	CHECK_EQUAL(0, block.histograms[SparkTimingColorizePass][0]);
+}
+
+struct ThreadArguments
+{
+	Diagnostics* diagnostics;
+	long cAdds;
+	volatile LONG* pStop;
+	bool fNegative;
+	bool fFellBack;
+};
+
+static void* AddFromWorker(void* pArguments)
+{
+	ThreadArguments& arguments = *(ThreadArguments*)pArguments;
+	for (long add = 0; add != arguments.cAdds; ++add)
+	{
+		arguments.diagnostics->Add(SparkCounterBytesCopied, 3);
+		arguments.diagnostics->Record(SparkTimingOnGenerated, 0);
+	}
+	return NULL;
+}
+
+// reads until told to stop - totals may not fall between resets, or go below zero
+static void* ReadUntilStopped(void* pArguments)
+{
+	ThreadArguments& arguments = *(ThreadArguments*)pArguments;
+	LONGLONG last = 0;
+	while (InterlockedCompareExchange(arguments.pStop, 0, 0) == 0)
+	{
+		Diagnostics::Block block;
+		Diagnostics::Clear(block);
+		arguments.diagnostics->Read(block);
+		LONGLONG bytes = block.counters[SparkCounterBytesCopied];
+		if (bytes < 0 || block.histograms[SparkTimingOnGenerated][0] < 0)
+			arguments.fNegative = true;
+		if (bytes < last)
+			arguments.fFellBack = true;
+		last = bytes;
+	}
+	return NULL;
+}
+
+static void* ResetUntilStopped(void* pArguments)
+{
+	ThreadArguments& arguments = *(ThreadArguments*)pArguments;
+	while (InterlockedCompareExchange(arguments.pStop, 0, 0) == 0)
+	{
+		Diagnostics::Block block;
+		Diagnostics::Clear(block);
+		arguments.diagnostics->Read(block);
+		if (block.counters[SparkCounterBytesCopied] < 0)
+			arguments.fNegative = true;
+		arguments.diagnostics->Reset();
+	}
+	return NULL;
+}
+
+// the owner (this thread) and four workers add at once while another thread reads
+TEST(EveryAddIsCountedFromAnyThread)
+{
+	const long cWorkers = 4;
+	const long cAdds = 200000;
+	Diagnostics diagnostics;
+	volatile LONG stop = 0;
+
+	ThreadArguments arguments = {&diagnostics, cAdds, &stop, false, false};
+	pthread_t workers[cWorkers];
+	pthread_t reader;
+	for (long worker = 0; worker != cWorkers; ++worker)
+		pthread_create(&workers[worker], NULL, AddFromWorker, &arguments);
+	pthread_create(&reader, NULL, ReadUntilStopped, &arguments);
+
+	AddFromWorker(&arguments);
+	for (long worker = 0; worker != cWorkers; ++worker)
+		pthread_join(workers[worker], NULL);
+	InterlockedExchange(&stop, 1);
+	pthread_join(reader, NULL);
+
+	Diagnostics::Block block;
+	Diagnostics::Clear(block);
+	diagnostics.Read(block);
+	CHECK_EQUAL(3 * cAdds * (cWorkers + 1), block.counters[SparkCounterBytesCopied]);
+	CHECK_EQUAL(cAdds * (cWorkers + 1), block.histograms[SparkTimingOnGenerated][0]);
+	CHECK(!arguments.fNegative);
+	CHECK(!arguments.fFellBack);
+}
+
+// resets from another thread while the owner adds - none of the owner's adds after the 
+// last reset may be lost, and no read may see less than nothing
+TEST(ResetFromAnotherThreadWhileTheOwnerAdds)
+{
+	Diagnostics diagnostics;
+	volatile LONG stop = 0;
+
+	ThreadArguments arguments = {&diagnostics, 200000, &stop, false, false};
+	pthread_t resetter;
+	pthread_create(&resetter, NULL, ResetUntilStopped, &arguments);
+	AddFromWorker(&arguments);
+	InterlockedExchange(&stop, 1);
+	pthread_join(resetter, NULL);
+	CHECK(!arguments.fNegative);
+
+	diagnostics.Reset();
+	diagnostics.Add(SparkCounterBytesCopied, 7);
+
+	Diagnostics::Block block;
+	Diagnostics::Clear(block);
+	diagnostics.Read(block);
+	CHECK_EQUAL(7, block.counters[SparkCounterBytesCopied]);
+	CHECK_EQUAL(0, block.histograms[SparkTimingOnGenerated][0]);
+}
@@ -0,0 +1,112 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "SyntheticView.h"
+#include "TextDiff.h"
+
+// one character at a time, as TextDiff compared before it took 8 at once
+static size_t ScalarCommonPrefix(const WCHAR* pText1, const WCHAR* pText2, size_t length)
+{
+	size_t index = 0;
+	while (index != length && pText1[index] == pText2[index])
+		++index;
+	return index;
+}
+
+static volatile size_t s_sink;
+
+// The pieces of applying a generation that work on the generated text as a whole - the 
+// line diff against the previous generation, the common prefix and suffix scans it 
+// starts with, and the conversion of every mapping offset to a line and column. Mapping
+// conversion is timed with the walkers Apply uses and with a binary search per offset.
+void RunDiffBenchmark(long cLines, long cPasses)
+{
+	SyntheticView view;
+	view.Build(cLines, 0xD1F7);
+
+	CStringW oldText;
+	CStringW newText(view.GetSecondary());
+	LineTable oldLines;
+	LineTable newLines;
+	newLines.Build(newText, newText.GetLength());
+	PooledArray<TextHunk> hunks;
+
+	LONGLONG ticks = 0;
+	LONGLONG allocations = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		oldText.SetString(newText, newText.GetLength());
+		oldLines.Swap(newLines);
+		view.EditExpression();
+		newText.SetString(view.GetSecondary(), view.GetSecondary().GetLength());
+		newLines.Build(newText, newText.GetLength());
+
+		LONGLONG start = BenchmarkNow();
+		LONGLONG allocationsStart = GetAllocationCount();
+		TextDiff::DiffLines(oldText, oldLines, newText, newLines, hunks);
+		if (pass != 0)
+		{
+			ticks += BenchmarkNow() - start;
+			allocations += GetAllocationCount() - allocationsStart;
+		}
+	}
+	ReportBenchmark("diff lines", cLines, (double)ticks / cPasses / 1000, "us/pass", (double)allocations / cPasses);
+
+	// the whole generated text against a copy of itself, the longest a scan can be
+	CStringW copy(newText);
+	long cch = newText.GetLength();
+	LONGLONG wideTicks = 0;
+	LONGLONG scalarTicks = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		LONGLONG start = BenchmarkNow();
+		s_sink = TextDiff::CommonPrefix(newText, copy, cch);
+		s_sink = TextDiff::CommonSuffix((const WCHAR*)newText + cch, (const WCHAR*)copy + cch, cch);
+		LONGLONG middle = BenchmarkNow();
+		s_sink = ScalarCommonPrefix(newText, copy, cch);
+		s_sink = ScalarCommonPrefix(copy, newText, cch);
+		if (pass != 0)
+		{
+			wideTicks += middle - start;
+			scalarTicks += BenchmarkNow() - middle;
+		}
+	}
+	ReportBenchmark("common prefix+suffix sse2", cLines, (double)wideTicks / cPasses / 1000, "us/pass", 0);
+	ReportBenchmark("common prefix+suffix scalar", cLines, (double)scalarTicks / cPasses / 1000, "us/pass", 0);
+
+	const PooledArray<SourceMapping>& mappings = view.GetMappings();
+	long cMappings = (long)mappings.GetCount();
+	LONGLONG walkTicks = 0;
+	LONGLONG searchTicks = 0;
+	long iLine = 0;
+	long iIndex = 0;
+	long sum = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		LONGLONG start = BenchmarkNow();
+		LineTable::Walker startWalker(newLines);
+		LineTable::Walker endWalker(newLines);
+		for (long index = 0; index != cMappings; ++index)
+		{
+			startWalker.GetLineIndexOfPosition(mappings[index].start2, &iLine, &iIndex);
+			sum += iLine + iIndex;
+			endWalker.GetLineIndexOfPosition(mappings[index].end2, &iLine, &iIndex);
+			sum += iLine + iIndex;
+		}
+		LONGLONG middle = BenchmarkNow();
+		for (long index = 0; index != cMappings; ++index)
+		{
+			newLines.GetLineIndexOfPosition(mappings[index].start2, &iLine, &iIndex);
+			sum += iLine + iIndex;
+			newLines.GetLineIndexOfPosition(mappings[index].end2, &iLine, &iIndex);
+			sum += iLine + iIndex;
+		}
+		if (pass != 0)
+		{
+			walkTicks += middle - start;
+			searchTicks += BenchmarkNow() - middle;
+		}
+	}
+	s_sink = sum;
+	ReportBenchmark("mapping offsets walker", cLines, (double)walkTicks / cPasses / (2 * cMappings), "ns/offset", 0);
+	ReportBenchmark("mapping offsets search", cLines, (double)searchTicks / cPasses / (2 * cMappings), "ns/offset", 0);
+}
@@ -0,0 +1,208 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "GeneratedState.h"
+#include "SupervisorDelta.h"
+#include "SyntheticView.h"
+
+static bool Holds(const GeneratedState& state, const CStringW& text, const PooledArray<SourceMapping>& mappings)
+{
+	if (state.GetTextLength() != text.GetLength() || 
+		memcmp(state.GetText(), (const WCHAR*)text, text.GetLength() * sizeof(WCHAR)) != 0)
+		return false;
+
+	const PooledArray<SourceMapping>& held = state.GetMappings();
+	return held.GetCount() == mappings.GetCount() && 
+		memcmp(held.GetData(), mappings.GetData(), mappings.GetCount() * sizeof(SourceMapping)) == 0;
+}
+
+// delivers a view's generation the way SourceSupervisor.SendDelta does, from whatever is held
+static bool Deliver(GeneratedState& state, long generation, const SyntheticView& view, long previousPrimaryLength, SupervisorDelta& delta)
+{
+	MakeSupervisorDelta(
+		state.GetText(), state.GetTextLength(), state.GetMappings(), previousPrimaryLength, 
+		view.GetSecondary(), view.GetSecondary().GetLength(), view.GetMappings(), view.GetPrimary().GetLength(), 
+		delta);
+	return state.ApplyDelta(
+		generation, state.GetGeneration(), 
+		&delta.edit, 1, delta.inserted, delta.inserted.GetLength(), 
+		&delta.op, 1, delta.mappings.GetData(), (long)delta.mappings.GetCount());
+}
+
+// "abcdef" with three mappings, as generation 1
+static void HoldSample(GeneratedState& state)
+{
+	SourceMapping rgMappings[] = {{0, 1, 0, 1}, {2, 3, 2, 3}, {4, 5, 4, 5}};
+	GeneratedTextEdit edit = {0, 0, 0, 6};
+	SourceDeltaOp op = {0, 0, 3, 0, 0};
+	CHECK(state.ApplyDelta(1, 0, &edit, 1, L"abcdef", 6, &op, 1, rgMappings, 3));
+	CHECK_EQUAL(6, state.GetTextLength());
+}
+
+static bool ApplyEdits(GeneratedState& state, const GeneratedTextEdit* rgEdits, long cEdits, const WCHAR* pInserted, long cchInserted)
+{
+	SourceDeltaOp op = {0, 0, 0, 0, 0};
+	return state.ApplyDelta(2, 1, rgEdits, cEdits, pInserted, cchInserted, &op, 1, NULL, 0);
+}
+
+static bool ApplyOps(GeneratedState& state, const SourceDeltaOp* rgOps, long cOps, long cMappings)
+{
+	SourceMapping rgMappings[] = {{9, 10, 9, 10}, {11, 12, 11, 12}};
+	return state.ApplyDelta(2, 1, NULL, 0, L"", 0, rgOps, cOps, rgMappings, cMappings);
+}
+
+TEST(FirstDeliveryStartsFromEmpty)
+{
+	SyntheticView view;
+	view.Build(300, 0x6E4E);
+
+	GeneratedState state;
+	SupervisorDelta delta;
+	CHECK(Deliver(state, 1, view, 0, delta));
+	CHECK_EQUAL(1, state.GetGeneration());
+	CHECK(Holds(state, view.GetSecondary(), view.GetMappings()));
+}
+
+TEST(SupervisorDeltasRoundTrip)
+{
+	SyntheticView view;
+	view.Build(300, 0x6E4E);
+
+	GeneratedState state;
+	SupervisorDelta delta;
+	CHECK(Deliver(state, 1, view, 0, delta));
+
+	for (long generation = 2; generation != 200; ++generation)
+	{
+		long previousPrimaryLength = view.GetPrimary().GetLength();
+		view.EditExpression();
+		CHECK(Deliver(state, generation, view, previousPrimaryLength, delta));
+		CHECK_EQUAL(generation, state.GetGeneration());
+		CHECK(Holds(state, view.GetSecondary(), view.GetMappings()));
+	}
+}
+
+TEST(NothingChangedIsAnEmptyDelta)
+{
+	SyntheticView view;
+	view.Build(50, 0x6E4E);
+
+	GeneratedState state;
+	SupervisorDelta delta;
+	CHECK(Deliver(state, 1, view, 0, delta));
+	CHECK(Deliver(state, 2, view, view.GetPrimary().GetLength(), delta));
+	CHECK_EQUAL(0, delta.inserted.GetLength());
+	CHECK_EQUAL(0, delta.op.cRemove);
+	CHECK_EQUAL(0, delta.op.cInsert);
+	CHECK(Holds(state, view.GetSecondary(), view.GetMappings()));
+}
+
+TEST(MismatchedBaseIsRejected)
+{
+	GeneratedState state;
+	HoldSample(state);
+
+	GeneratedTextEdit edit = {0, 1, 0, 1};
+	SourceDeltaOp op = {0, 0, 0, 0, 0};
+	CHECK(!state.ApplyDelta(3, 2, &edit, 1, L"x", 1, &op, 1, NULL, 0));
+	CHECK_EQUAL(0, state.GetGeneration());
+	CHECK_EQUAL(0, state.GetTextLength());
+	CHECK_EQUAL(0, state.GetMappings().GetCount());
+
+	// nothing held any more, so only a full delivery fits
+	CHECK(!state.ApplyDelta(3, 1, &edit, 1, L"x", 1, &op, 1, NULL, 0));
+	HoldSample(state);
+	CHECK_EQUAL(1, state.GetGeneration());
+}
+
+TEST(EditsInsideTheTextApply)
+{
+	GeneratedState state;
+	HoldSample(state);
+
+	GeneratedTextEdit rgEdits[] = {{0, 1, 0, 2}, {3, 3, 2, 3}, {5, 6, 3, 3}};
+	CHECK(ApplyEdits(state, rgEdits, 3, L"XYZ", 3));
+	CHECK_EQUAL(7, state.GetTextLength());
+	CHECK(memcmp(state.GetText(), L"XYbcZde", 7 * sizeof(WCHAR)) == 0);
+	CHECK_EQUAL(3, state.GetMappings().GetCount());
+}
+
+TEST(OutOfRangeEditsAreRejected)
+{
+	// past the end, inverted, before the start, and inserting from outside the inserted text
+	GeneratedTextEdit rgBad[][1] = 
+	{
+		{{4, 7, 0, 0}},
+		{{7, 7, 0, 1}},
+		{{3, 2, 0, 0}},
+		{{-1, 2, 0, 0}},
+		{{0, 0, 0, 4}},
+		{{0, 0, -1, 1}},
+		{{0, 0, 2, 1}},
+	};
+	for (size_t index = 0; index != sizeof(rgBad) / sizeof(rgBad[0]); ++index)
+	{
+		GeneratedState state;
+		HoldSample(state);
+		CHECK(!ApplyEdits(state, rgBad[index], 1, L"XYZ", 3));
+		CHECK_EQUAL(0, state.GetGeneration());
+		CHECK_EQUAL(0, state.GetTextLength());
+	}
+}
+
+TEST(OverlappingEditsAreRejected)
+{
+	// a later edit reaching back would have the size worked out smaller than what's copied
+	GeneratedTextEdit rgOverlapping[] = {{0, 0, 0, 3}, {0, 6, 0, 0}, {1, 5, 0, 0}};
+	GeneratedTextEdit rgDescending[] = {{4, 5, 0, 1}, {1, 2, 1, 2}};
+
+	GeneratedState state;
+	HoldSample(state);
+	CHECK(!ApplyEdits(state, rgOverlapping, 3, L"XYZ", 3));
+	CHECK_EQUAL(0, state.GetTextLength());
+
+	HoldSample(state);
+	CHECK(!ApplyEdits(state, rgDescending, 2, L"XYZ", 3));
+	CHECK_EQUAL(0, state.GetTextLength());
+
+	HoldSample(state);
+	CHECK(!ApplyEdits(state, rgDescending, -1, L"XYZ", 3));
+}
+
+TEST(OpsInsideTheMappingsApply)
+{
+	GeneratedState state;
+	HoldSample(state);
+
+	// the first mapping replaced, the second kept and moved, the third removed
+	SourceDeltaOp rgOps[] = {{0, 1, 2, 0, 0}, {2, 1, 0, 1, 1}};
+	CHECK(ApplyOps(state, rgOps, 2, 2));
+	const PooledArray<SourceMapping>& mappings = state.GetMappings();
+	CHECK_EQUAL(3, mappings.GetCount());
+	CHECK_EQUAL(9, mappings[0].start1);
+	CHECK_EQUAL(11, mappings[1].start1);
+	CHECK_EQUAL(2, mappings[2].start1);
+}
+
+TEST(OutOfRangeOpsAreRejected)
+{
+	// past the end, removing past the end, inserting more or fewer than sent, and out of order
+	SourceDeltaOp rgBad[][2] = 
+	{
+		{{4, 0, 0, 0, 0}, {4, 0, 2, 0, 0}},
+		{{2, 2, 0, 0, 0}, {4, 0, 2, 0, 0}},
+		{{0, 0, 2, 0, 0}, {1, 0, 1, 0, 0}},
+		{{0, 0, 1, 0, 0}, {1, 0, 0, 0, 0}},
+		{{2, 0, 1, 0, 0}, {1, 0, 1, 0, 0}},
+		{{0, 2, 1, 0, 0}, {1, 0, 1, 0, 0}},
+		{{-1, 1, 2, 0, 0}, {3, 0, 0, 0, 0}},
+		{{0, -1, 2, 0, 0}, {3, 0, 0, 0, 0}},
+	};
+	for (size_t index = 0; index != sizeof(rgBad) / sizeof(rgBad[0]); ++index)
+	{
+		GeneratedState state;
+		HoldSample(state);
+		CHECK(!ApplyOps(state, rgBad[index], 2, 2));
+		CHECK_EQUAL(0, state.GetGeneration());
+		CHECK_EQUAL(0, state.GetMappings().GetCount());
+	}
+}
@@ -0,0 +1,59 @@
+using System;
+using System.IO;
+using System.Linq;
+using System.Text;
+using Spark.Parser;
+using Spark.Parser.Markup;
+
+namespace Spark
+{
+    // referenced by the markup nodes, defined with the rest of Spark
+    public interface ISparkExtension { }
+}
+
+namespace GrammarPaintDump
+{
+    /// <summary>
+    /// Paints each view with MarkupGrammar, as the supervisor did, and writes what the
+    /// editor would show for it: the view's text as UTF-16 in N.text, one color byte per
+    /// character in N.colors, and a line "N path" per view in manifest.txt. Later paints
+    /// are drawn over earlier ones, and PlainText is the editor's 0 like unpainted text.
+    /// </summary>
+    /// <example>GrammarPaintDump outputDirectory view.spark...</example>
+    class Program
+    {
+        static int Main(string[] args)
+        {
+            if (args.Length < 1)
+            {
+                Console.Error.WriteLine("usage: GrammarPaintDump outputDirectory view.spark...");
+                return 2;
+            }
+
+            var outputDirectory = args[0];
+            Directory.CreateDirectory(outputDirectory);
+
+            var grammar = new MarkupGrammar();
+            var manifest = new StringBuilder();
+            for (var index = 1; index != args.Length; ++index)
+            {
+                var text = File.ReadAllText(args[index]);
+                var result = grammar.Nodes(new Position(new SourceContext(text, 0, args[index])));
+
+                var colors = new byte[text.Length];
+                foreach (var paint in result.Rest.GetPaint().OfType<Paint<SparkTokenType>>())
+                {
+                    for (var offset = paint.Begin.Offset; offset != paint.End.Offset; ++offset)
+                        colors[offset] = (byte)paint.Value;
+                }
+
+                var name = (index - 1).ToString();
+                File.WriteAllBytes(Path.Combine(outputDirectory, name + ".text"), Encoding.Unicode.GetBytes(text));
+                File.WriteAllBytes(Path.Combine(outputDirectory, name + ".colors"), colors);
+                manifest.Append(name).Append(' ').Append(args[index]).Append('\n');
+            }
+            File.WriteAllText(Path.Combine(outputDirectory, "manifest.txt"), manifest.ToString());
+            return 0;
+        }
+    }
+}
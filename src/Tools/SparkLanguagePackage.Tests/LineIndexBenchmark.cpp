@@ -0,0 +1,86 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "SyntheticView.h"
+#include "LineIndex.h"
+
+static volatile long s_sink;
+
+// The primary buffer's line index as typing keeps it - edits of a line or two at random
+// places, each replacing the lines it touched - against building a LineTable of the 
+// whole text again, which is what keeping the lines cost before. Lookups go through 
+// the index either way.
+void RunLineIndexBenchmark(long cLines, long cPasses)
+{
+	SyntheticView view;
+	view.Build(cLines, 0x11DE);
+	const CStringW& text = view.GetPrimary();
+
+	LineIndex index;
+	index.Build(text, text.GetLength());
+
+	const long cEdits = 1000;
+	long rgLengths[3];
+	LONGLONG editTicks = 0;
+	LONGLONG editAllocations = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		LONGLONG start = BenchmarkNow();
+		LONGLONG allocationsStart = GetAllocationCount();
+		for (long edit = 0; edit != cEdits; ++edit)
+		{
+			long cIndexLines = index.GetLineCount();
+			long iFirstLine = view.Random() % cIndexLines;
+			long cOldLines = 1 + view.Random() % 2;
+			if (cOldLines > cIndexLines - iFirstLine)
+				cOldLines = cIndexLines - iFirstLine;
+
+			// as many lines as were taken away on average, so the size stays put
+			long cNewLines = 1 + view.Random() % 2;
+			for (long iLine = 0; iLine != cNewLines; ++iLine)
+				rgLengths[iLine] = 2 + view.Random() % 60;
+			index.ReplaceLines(iFirstLine, cOldLines, rgLengths, cNewLines);
+		}
+		if (pass != 0)
+		{
+			editTicks += BenchmarkNow() - start;
+			editAllocations += GetAllocationCount() - allocationsStart;
+		}
+	}
+	ReportBenchmark("line index edit", cLines, (double)editTicks / cPasses / cEdits, "ns/edit", (double)editAllocations / cPasses);
+
+	LineTable table;
+	LONGLONG rebuildTicks = 0;
+	LONGLONG rebuildAllocations = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		LONGLONG start = BenchmarkNow();
+		LONGLONG allocationsStart = GetAllocationCount();
+		table.Build(text, text.GetLength());
+		if (pass != 0)
+		{
+			rebuildTicks += BenchmarkNow() - start;
+			rebuildAllocations += GetAllocationCount() - allocationsStart;
+		}
+	}
+	ReportBenchmark("line table rebuild", cLines, (double)rebuildTicks / cPasses / 1000, "us/rebuild", (double)rebuildAllocations / cPasses);
+
+	long length = index.GetLength();
+	long iLine = 0;
+	long iIndex = 0;
+	long sum = 0;
+	LONGLONG lookupTicks = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		LONGLONG start = BenchmarkNow();
+		for (long lookup = 0; lookup != cEdits; ++lookup)
+		{
+			index.GetLineIndexOfPosition(view.Random() % length, &iLine, &iIndex);
+			sum += iLine + iIndex;
+			sum += index.GetLineStart(iLine);
+		}
+		if (pass != 0)
+			lookupTicks += BenchmarkNow() - start;
+	}
+	s_sink = sum;
+	ReportBenchmark("line index lookup", cLines, (double)lookupTicks / cPasses / cEdits, "ns/lookup", 0);
+}
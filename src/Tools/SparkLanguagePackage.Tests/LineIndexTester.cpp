@@ -0,0 +1,169 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "LineIndex.h"
+
+static ULONG s_seed = 0x11D3;
+
+static ULONG Random()
+{
+	s_seed ^= s_seed << 13;
+	s_seed ^= s_seed >> 17;
+	s_seed ^= s_seed << 5;
+	return s_seed;
+}
+
+// every answer the index gives, worked out again from a plain array of line lengths
+static bool MatchesLengths(const LineIndex& index, const PooledArray<long>& lengths)
+{
+	long cLines = (long)lengths.GetCount();
+	long length = 0;
+	for (long iLine = 0; iLine != cLines; ++iLine)
+		length += lengths[iLine];
+	if (index.GetLineCount() != cLines || index.GetLength() != length)
+		return false;
+
+	long iStart = 0;
+	for (long iLine = 0; iLine != cLines; ++iLine)
+	{
+		if (index.GetLineStart(iLine) != iStart)
+			return false;
+		if (index.GetPositionOfLineIndex(iLine, lengths[iLine]) != iStart + lengths[iLine])
+			return false;
+
+		for (long iIndex = 0; iIndex < lengths[iLine]; ++iIndex)
+		{
+			long iLineFound = -1;
+			long iIndexFound = -1;
+			index.GetLineIndexOfPosition(iStart + iIndex, &iLineFound, &iIndexFound);
+			if (iLineFound != iLine || iIndexFound != iIndex)
+				return false;
+		}
+		iStart += lengths[iLine];
+	}
+	return index.GetLineStart(cLines) == length;
+}
+
+TEST(BuildFindsEachKindOfLineBreak)
+{
+	const WCHAR* text = L"a\r\nbb\nccc\rd\x2028" L"e\x2029\r\n";
+	LineIndex index;
+	index.Build(text, (long)wcslen(text));
+
+	PooledArray<long> lengths;
+	long rgLengths[] = {3, 3, 4, 2, 2, 2, 0};
+	for (long iLine = 0; iLine != _countof(rgLengths); ++iLine)
+		lengths.Add(rgLengths[iLine]);
+	CHECK(MatchesLengths(index, lengths));
+}
+
+TEST(EndOfTextIsOnTheLastLine)
+{
+	LineIndex index;
+	index.Build(L"ab\r\n", 4);
+
+	long iLine = -1;
+	long iIndex = -1;
+	index.GetLineIndexOfPosition(4, &iLine, &iIndex);
+	CHECK_EQUAL(1, iLine);
+	CHECK_EQUAL(0, iIndex);
+	index.GetLineIndexOfPosition(99, &iLine, &iIndex);
+	CHECK_EQUAL(1, iLine);
+	CHECK_EQUAL(0, iIndex);
+
+	CHECK_EQUAL(4, index.GetPositionOfLineIndex(7, 0));
+	CHECK_EQUAL(4, index.GetPositionOfLineIndex(0, 99));
+	CHECK_EQUAL(0, index.GetPositionOfLineIndex(-1, 2));
+}
+
+TEST(EmptyTextIsOneEmptyLine)
+{
+	LineIndex index;
+	index.Build(L"", 0);
+	CHECK_EQUAL(1, index.GetLineCount());
+	CHECK_EQUAL(0, index.GetLength());
+
+	index.Clear();
+	CHECK_EQUAL(0, index.GetLineCount());
+	long iLine = -1;
+	long iIndex = -1;
+	index.GetLineIndexOfPosition(0, &iLine, &iIndex);
+	CHECK_EQUAL(0, iLine);
+	CHECK_EQUAL(0, iIndex);
+}
+
+// inserts, deletions and replacements anywhere, the index checked after each one 
+// against the same edit made to the array
+TEST(RandomEditsMatchTheLengths)
+{
+	PooledArray<long> lengths;
+	for (long iLine = 0; iLine != 200; ++iLine)
+		lengths.Add(1 + Random() % 40);
+	lengths.Add(0);
+
+	CStringW text;
+	for (long iLine = 0; iLine != 200; ++iLine)
+	{
+		for (long iChar = 1; iChar < lengths[iLine]; ++iChar)
+			text.AppendChar(L'x');
+		text.AppendChar(L'\n');
+	}
+	LineIndex index;
+	index.Build(text, text.GetLength());
+	CHECK(MatchesLengths(index, lengths));
+
+	PooledArray<long> next;
+	PooledArray<long> inserted;
+	for (long round = 0; round != 1000; ++round)
+	{
+		long cLines = (long)lengths.GetCount();
+		long iFirstLine = Random() % (cLines + 1);
+		long cOldLines = Random() % 5;
+		if (cOldLines > cLines - iFirstLine)
+			cOldLines = cLines - iFirstLine;
+		long cNewLines = Random() % 5;
+		inserted.SetCount(cNewLines);
+		for (long iLine = 0; iLine != cNewLines; ++iLine)
+			inserted[iLine] = Random() % 30;
+
+		index.ReplaceLines(iFirstLine, cOldLines, inserted.GetData(), cNewLines);
+
+		next.RemoveAll();
+		for (long iLine = 0; iLine != iFirstLine; ++iLine)
+			next.Add(lengths[iLine]);
+		for (long iLine = 0; iLine != cNewLines; ++iLine)
+			next.Add(inserted[iLine]);
+		for (long iLine = iFirstLine + cOldLines; iLine != cLines; ++iLine)
+			next.Add(lengths[iLine]);
+		lengths.Swap(next);
+
+		if (!MatchesLengths(index, lengths))
+		{
+			printf("  round %ld: replacing %ld lines at %ld with %ld\n", round, cOldLines, iFirstLine, cNewLines);
+			CHECK(false);
+			break;
+		}
+	}
+}
+
+// a million lines added one at a time at the end, then taken away from the front - the 
+// orders a treap built without random priorities would turn into a list
+TEST(LongRunsOfEditsKeepWorking)
+{
+	LineIndex index;
+	index.Build(L"", 0);
+
+	long length = 3;
+	for (long iLine = 0; iLine != 1000000; ++iLine)
+		index.ReplaceLines(index.GetLineCount() - 1, 0, &length, 1);
+	CHECK_EQUAL(1000001, index.GetLineCount());
+	CHECK_EQUAL(3000000, index.GetLength());
+	CHECK_EQUAL(1500000, index.GetLineStart(500000));
+
+	while (index.GetLineCount() > 1)
+		index.ReplaceLines(0, index.GetLineCount() > 1000 ? 1000 : 1, NULL, 0);
+	CHECK_EQUAL(1, index.GetLineCount());
+	CHECK_EQUAL(0, index.GetLength());
+
+	index.ReplaceLines(0, 1, NULL, 0);
+	CHECK_EQUAL(0, index.GetLineCount());
+}
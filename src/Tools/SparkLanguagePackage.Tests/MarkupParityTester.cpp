@@ -0,0 +1,149 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "MarkupTokenizer.h"
+#include "LineTable.h"
+
+// Compares the tokenizer with MarkupGrammar over every view in Samples. GrammarPaintDump
+// writes the grammar's colors for each view into GRAMMAR_PAINT_DIR as the build runs; 
+// each view is colored here line by line, as the editor asks for it, and whole with 
+// Tokenize, and every character must come out the same color as the grammar gave it.
+
+static bool ReadBytes(const char* path, PooledArray<unsigned char>& bytes)
+{
+	bytes.RemoveAll();
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+
+	unsigned char buffer[16384];
+	size_t cRead;
+	while ((cRead = fread(buffer, 1, sizeof(buffer), file)) != 0)
+	{
+		size_t count = bytes.GetCount();
+		bytes.SetCount(count + cRead);
+		memcpy(bytes.GetData() + count, buffer, cRead);
+	}
+	fclose(file);
+	return true;
+}
+
+static void PrintLine(const char* label, const WCHAR* pText, const ULONG* pColors, long cch, bool fText)
+{
+	printf("  %s ", label);
+	for (long index = 0; index != cch; ++index)
+	{
+		if (fText)
+			putchar(pText[index] >= L' ' && pText[index] < 127 ? (char)pText[index] : '?');
+		else
+			putchar("0123456789abcdef"[pColors[index] & 15]);
+	}
+	putchar('\n');
+}
+
+// the line and the colors of both when they differ, for the first few lines of a view
+static long CompareLine(const WCHAR* pText, const ULONG* pExpected, const ULONG* pActual, long cch, long iLine, const char* mode, long& cShown)
+{
+	long cDifferent = 0;
+	for (long index = 0; index != cch; ++index)
+	{
+		if (pExpected[index] != pActual[index])
+			++cDifferent;
+	}
+	if (cDifferent != 0 && cShown++ < 3)
+	{
+		printf(" line %ld, %s:\n", iLine + 1, mode);
+		PrintLine("text   ", pText, NULL, cch, true);
+		PrintLine("grammar", NULL, pExpected, cch, false);
+		PrintLine("native ", NULL, pActual, cch, false);
+	}
+	return cDifferent;
+}
+
+TEST(SamplesColorAsTheGrammarPaintsThem)
+{
+	// room for the directory, a manifest entry and its extension
+	char entry[1200];
+	char path[sizeof(GRAMMAR_PAINT_DIR) + sizeof(entry) + 16];
+	snprintf(path, sizeof(path), "%s/manifest.txt", GRAMMAR_PAINT_DIR);
+	FILE* manifest = fopen(path, "r");
+	CHECK(manifest != NULL);
+	if (manifest == NULL)
+		return;
+
+	PooledArray<unsigned char> textBytes;
+	PooledArray<unsigned char> colorBytes;
+	PooledArray<ULONG> expected;
+	PooledArray<ULONG> lineColors;
+	PooledArray<ULONG> documentColors;
+	PooledArray<SourcePainting> paints;
+	LineTable lines;
+
+	long cViews = 0;
+	LONGLONG cchTotal = 0;
+	LONGLONG cDifferentTotal = 0;
+	while (fgets(entry, sizeof(entry), manifest) != NULL)
+	{
+		char* pSpace = strchr(entry, ' ');
+		if (pSpace == NULL)
+			continue;
+		*pSpace = 0;
+		char* pNewline = strchr(pSpace + 1, '\n');
+		if (pNewline != NULL)
+			*pNewline = 0;
+
+		snprintf(path, sizeof(path), "%s/%s.text", GRAMMAR_PAINT_DIR, entry);
+		bool fRead = ReadBytes(path, textBytes);
+		snprintf(path, sizeof(path), "%s/%s.colors", GRAMMAR_PAINT_DIR, entry);
+		fRead = ReadBytes(path, colorBytes) && fRead;
+		CHECK(fRead && textBytes.GetCount() == colorBytes.GetCount() * sizeof(WCHAR));
+		if (!fRead || textBytes.GetCount() != colorBytes.GetCount() * sizeof(WCHAR))
+			continue;
+
+		const WCHAR* pText = (const WCHAR*)textBytes.GetData();
+		long cch = (long)colorBytes.GetCount();
+		expected.SetCount(cch + 1);
+		for (long index = 0; index != cch; ++index)
+			expected[index] = colorBytes[index];
+		lines.Build(pText, cch);
+
+		// the whole view, painted in order over unpainted text
+		MarkupTokenizer::Tokenize(pText, cch, paints);
+		documentColors.SetCount(cch + 1);
+		MarkupTokenizer::FillAttributes(documentColors.GetData(), cch, 0);
+		for (size_t index = 0; index != paints.GetCount(); ++index)
+		{
+			const SourcePainting& paint = paints[index];
+			MarkupTokenizer::FillAttributes(documentColors.GetData() + paint.start, paint.end - paint.start, paint.color);
+		}
+
+		long cDifferent = 0;
+		long cShown = 0;
+		long state = MarkupStateText;
+		for (long iLine = 0; iLine != lines.GetLineCount(); ++iLine)
+		{
+			long iStart = lines.GetLineStart(iLine);
+			long cchLine = lines.GetLineStart(iLine + 1) - iStart;
+			while (cchLine != 0 && (pText[iStart + cchLine - 1] == L'\r' || pText[iStart + cchLine - 1] == L'\n'))
+				--cchLine;
+
+			lineColors.SetCount(cchLine + 1);
+			long startState = state;
+			state = MarkupTokenizer::ColorizeLine(pText + iStart, cchLine, startState, 0, lineColors.GetData());
+			CHECK_EQUAL(state, MarkupTokenizer::GetStateAtEndOfLine(pText + iStart, cchLine, startState));
+
+			cDifferent += CompareLine(pText + iStart, expected.GetData() + iStart, lineColors.GetData(), cchLine, iLine, "by line", cShown);
+			cDifferent += CompareLine(pText + iStart, expected.GetData() + iStart, documentColors.GetData() + iStart, cchLine, iLine, "whole view", cShown);
+		}
+
+		if (cDifferent != 0)
+			printf("%s: %ld characters colored differently\n", pSpace + 1, cDifferent);
+		++cViews;
+		cchTotal += cch;
+		cDifferentTotal += cDifferent;
+	}
+	fclose(manifest);
+
+	printf("%ld views, %lld characters, %lld colored differently\n", cViews, (long long)cchTotal, (long long)cDifferentTotal);
+	CHECK(cViews != 0);
+	CHECK_EQUAL(0, cDifferentTotal);
+}
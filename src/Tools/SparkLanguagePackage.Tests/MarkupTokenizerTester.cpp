@@ -0,0 +1,217 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "MarkupTokenizer.h"
+#include "LineTable.h"
+
+static const ULONG s_guard = 0xDEADBEEF;
+
+// colors of a text as digits, one per character with line breaks left out, colored a line 
+// at a time as the editor does. checks Tokenize paints the whole text the same way
+static void Colorize(const WCHAR* pText, CStringW& colors, long* pEndState = NULL)
+{
+	long cch = (long)wcslen(pText);
+	LineTable lines;
+	lines.Build(pText, cch);
+
+	PooledArray<ULONG> documentColors;
+	documentColors.SetCount(cch + 1);
+	MarkupTokenizer::FillAttributes(documentColors.GetData(), cch, 0);
+	PooledArray<SourcePainting> paints;
+	MarkupTokenizer::Tokenize(pText, cch, paints);
+	for (size_t index = 0; index != paints.GetCount(); ++index)
+		MarkupTokenizer::FillAttributes(documentColors.GetData() + paints[index].start, paints[index].end - paints[index].start, paints[index].color);
+
+	colors.Empty();
+	long state = MarkupStateText;
+	PooledArray<ULONG> lineColors;
+	long cDifferent = 0;
+	for (long iLine = 0; iLine != lines.GetLineCount(); ++iLine)
+	{
+		long iStart = lines.GetLineStart(iLine);
+		long cchLine = lines.GetLineStart(iLine + 1) - iStart;
+		while (cchLine != 0 && (pText[iStart + cchLine - 1] == L'\r' || pText[iStart + cchLine - 1] == L'\n'))
+			--cchLine;
+		lineColors.SetCount(cchLine + 1);
+		state = MarkupTokenizer::ColorizeLine(pText + iStart, cchLine, state, 0, lineColors.GetData());
+		for (long index = 0; index != cchLine; ++index)
+		{
+			colors.AppendChar(L"0123456789abcdef"[lineColors[index] & 15]);
+			if (lineColors[index] != documentColors[iStart + index])
+				++cDifferent;
+		}
+	}
+	CHECK_EQUAL(0, cDifferent);
+	if (pEndState != NULL)
+		*pEndState = state;
+}
+
+static bool SameText(const CStringW& text, const WCHAR* expected)
+{
+	return text.GetLength() == (long)wcslen(expected) && 
+		memcmp((const WCHAR*)text, expected, text.GetLength() * sizeof(WCHAR)) == 0;
+}
+
+static void PrintColors(const char* label, const WCHAR* colors)
+{
+	printf("  %s ", label);
+	for (; *colors != 0; ++colors)
+		putchar((char)*colors);
+	putchar('\n');
+}
+
+// expected is what MarkupGrammar paints the text, as GrammarPaintDump writes it
+static bool ColorsAre(const WCHAR* pText, const WCHAR* expected)
+{
+	CStringW colors;
+	Colorize(pText, colors);
+	if (SameText(colors, expected))
+		return true;
+	PrintColors("expected", expected);
+	PrintColors("actual  ", colors);
+	return false;
+}
+
+#define CHECK_COLORS(text, expected) CHECK(ColorsAre(text, expected))
+
+TEST(FillAttributesWritesExactlyCount)
+{
+	// a 16 byte aligned block, filled from each of the four ULONG alignments within it 
+	// so the scalar lead-in, the wide stores and the tail are all crossed
+	const long cBase = 128;
+	__m128i block[cBase * sizeof(ULONG) / sizeof(__m128i)];
+	ULONG* pBase = (ULONG*)block;
+
+	for (long alignment = 0; alignment != 4; ++alignment)
+	{
+		for (long count = 0; count <= 100; ++count)
+		{
+			for (long index = 0; index != cBase; ++index)
+				pBase[index] = s_guard;
+
+			ULONG* pAttributes = pBase + 4 + alignment;
+			MarkupTokenizer::FillAttributes(pAttributes, count, 7);
+
+			long cWrong = 0;
+			for (long index = 0; index != cBase; ++index)
+			{
+				bool fInside = pBase + index >= pAttributes && pBase + index < pAttributes + count;
+				if (pBase[index] != (fInside ? 7 : s_guard))
+					++cWrong;
+			}
+			CHECK_EQUAL(0, cWrong);
+		}
+	}
+}
+
+TEST(ColorizeLineWritesLengthPlusOne)
+{
+	// a line long enough for every run on it to take the wide stores
+	CStringW line;
+	for (long index = 0; index != 200; ++index)
+		line.Append(L"<div class=\"a\">plain text ${x}</div>");
+	long length = line.GetLength();
+
+	PooledArray<ULONG> attributes;
+	attributes.SetCount(length + 3);
+	for (long index = 0; index != length + 3; ++index)
+		attributes[index] = s_guard;
+	MarkupTokenizer::ColorizeLine(line, length, MarkupStateText, 16, attributes.GetData() + 1);
+
+	CHECK_EQUAL(s_guard, attributes[0]);
+	CHECK_EQUAL(0, attributes[length + 1]);
+	CHECK_EQUAL(s_guard, attributes[length + 2]);
+
+	long cUnwritten = 0;
+	for (long index = 1; index != length + 2; ++index)
+	{
+		if (attributes[index] == s_guard)
+			++cUnwritten;
+	}
+	CHECK_EQUAL(0, cUnwritten);
+
+	// the same colors as the same text colored one repetition at a time
+	PooledArray<ULONG> piece;
+	long cchPiece = length / 200;
+	piece.SetCount(cchPiece + 1);
+	MarkupTokenizer::ColorizeLine(line, cchPiece, MarkupStateText, 16, piece.GetData());
+	long cDifferent = 0;
+	for (long index = 0; index != length; ++index)
+	{
+		if (attributes[index + 1] != piece[index % cchPiece])
+			++cDifferent;
+	}
+	CHECK_EQUAL(0, cDifferent);
+}
+
+TEST(MarkupColorsMatchTheGrammar)
+{
+	CHECK_COLORS(L"<div class=\"a\">x&amp;${y}</div>", L"133304444425551077777aa0a113331");
+	CHECK_COLORS(L"<!-- c -->", L"6666666666");
+	CHECK_COLORS(L"a <%= b %> c", L"008820008800");
+}
+
+TEST(BracesNestDeeperThanAByte)
+{
+	// a code block 300 braces deep, a line per brace, still closes where it should
+	CStringW text(L"${\n");
+	for (long index = 0; index != 300; ++index)
+		text.Append(L"{\n");
+	for (long index = 0; index != 300; ++index)
+		text.Append(L"}\n");
+	text.Append(L"}<b>");
+
+	CStringW expected(L"aa");
+	for (long index = 0; index != 600; ++index)
+		expected.AppendChar(L'0');
+	expected.Append(L"a131");
+
+	CStringW colors;
+	long state = -1;
+	Colorize(text, colors, &state);
+	CHECK(SameText(colors, expected));
+	CHECK_EQUAL(MarkupStateText, state);
+}
+
+TEST(IgnoreUnlessSelfClosing)
+{
+	// the content of <ignore>, and its end tag, aren't lexed - unless the tag closed itself
+	CHECK_COLORS(L"<ignore>${x}</ignore>", L"133333310000000000000");
+	CHECK_COLORS(L"<ignore/>${x}", L"133333311aa0a");
+
+	// the '/' must touch the '>', or the tag isn't one
+	CHECK_COLORS(L"<ignore/ >${x}</ignore>", L"0000000000aa0a113333331");
+
+	// a line which starts with '>' doesn't look before itself for the '/'
+	long state = MarkupTokenizer::GetStateAtEndOfLine(L"<ignore", 7, MarkupStateText);
+	const WCHAR* pLine = L"/>${x}";
+	CHECK_EQUAL(MarkupStateIgnore, MarkupTokenizer::GetStateAtEndOfLine(pLine + 1, 5, state));
+}
+
+TEST(MalformedTagIsText)
+{
+	// the grammar doesn't take these as tags, and paints none of them
+	CHECK_COLORS(L"<span class=\"a\"\">x", L"000000000000000000");
+	CHECK_COLORS(L"<input disabled>", L"0000000000000000");
+	CHECK_COLORS(L"<a href=x>", L"0000000000");
+
+	// code in a tag that turns out not to be one is still code
+	CHECK_COLORS(L"<a b=\"${c}\"\">", L"000000aa0a000");
+}
+
+TEST(AttributeValueLeavesLessThanAndAmpersand)
+{
+	CHECK_COLORS(L"<a b=\"x<y && z&amp;\"/>", L"1304255055005577777511");
+}
+
+TEST(StatementsAndCodeSkipComments)
+{
+	CHECK_COLORS(L"# var s = \"x\";", L"a0000000009990");
+	CHECK_COLORS(L"# // \"x\" {", L"a000000000");
+	CHECK_COLORS(L"${a // \"x\" }\n}", L"aa0000000000a");
+}
+
+TEST(LateBoundFormatIsntAString)
+{
+	CHECK_COLORS(L"${#price \"0.00\"}", L"aa0000000000000a");
+	CHECK_COLORS(L"${#a.b + \"c\"}", L"aa0000000999a");
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "SecondaryText.h"
+#include "Diagnostics.h"
+
+// Secondary buffer and buffer coordinator held in memory - what SecondaryText::Apply
+// writes to when there's no editor. Lines are tracked with a LineIndex, the text is 
+// copied whole on each replacement. Counts the calls it gets, and the time spent in 
+// them, so a benchmark can tell its own cost apart from the package's.
+class MemoryTextTarget : public SecondaryTextTarget
+{
+	PooledArray<WCHAR> _texts[2];
+	long _current;
+	LineIndex _lines;
+	LineTable _scan;
+	PooledArray<long> _lengths;
+
+public:
+	PooledArray<NewSpanMapping> mappings;
+
+	long getTextCalls;
+	long replaceCalls;
+	long setMappingsCalls;
+	LONGLONG charsRead;
+	LONGLONG charsReplaced;
+	LONGLONG ticks;
+
+	MemoryTextTarget() : _current(0)
+	{
+		ResetCounts();
+	}
+
+	void ResetCounts()
+	{
+		getTextCalls = 0;
+		replaceCalls = 0;
+		setMappingsCalls = 0;
+		charsRead = 0;
+		charsReplaced = 0;
+		ticks = 0;
+	}
+
+	const WCHAR* GetData() const {return _texts[_current].GetData();}
+	long GetLength() const {return (long)_texts[_current].GetCount();}
+	const LineIndex& GetLines() const {return _lines;}
+
+	// an edit made by someone else, as the coordinator makes when the user types
+	void SetText(const WCHAR* pText, long cchText)
+	{
+		PooledArray<WCHAR>& text = _texts[_current];
+		text.SetCount(cchText);
+		if (cchText != 0)
+			CopyMemory(text.GetData(), pText, cchText * sizeof(WCHAR));
+		_lines.Build(text.GetData(), cchText);
+	}
+
+	bool Equals(const WCHAR* pText, long cchText) const
+	{
+		return cchText == GetLength() &&
+			(cchText == 0 || memcmp(GetData(), pText, cchText * sizeof(WCHAR)) == 0);
+	}
+
+	HRESULT GetText(CStringW& text)
+	{
+		LONGLONG start = Diagnostics::Now();
+		++getTextCalls;
+		charsRead += GetLength();
+		text.SetString(GetData(), GetLength());
+		ticks += Diagnostics::Now() - start;
+		return S_OK;
+	}
+
+	HRESULT ReplaceLines(long iStartLine, long iStartIndex, long iEndLine, long iEndIndex, const WCHAR* pText, long cchText)
+	{
+		LONGLONG start = Diagnostics::Now();
+		++replaceCalls;
+		charsReplaced += cchText;
+
+		long iStart = _lines.GetPositionOfLineIndex(iStartLine, iStartIndex);
+		long iEnd = _lines.GetPositionOfLineIndex(iEndLine, iEndIndex);
+		if (iEnd < iStart)
+			return E_INVALIDARG;
+
+		// the whole lines the replacement touches, from the first one's start to past the
+		// last one's line break
+		long iRegionStart = _lines.GetLineStart(iStartLine);
+		long iOldRegionEnd = _lines.GetLineStart(iEndLine + 1);
+		long cchOld = GetLength();
+		long cchNew = cchOld - (iEnd - iStart) + cchText;
+
+		const WCHAR* pOld = GetData();
+		PooledArray<WCHAR>& next = _texts[1 - _current];
+		next.SetCount(cchNew);
+		WCHAR* pNew = next.GetData();
+		CopyMemory(pNew, pOld, iStart * sizeof(WCHAR));
+		CopyMemory(pNew + iStart, pText, cchText * sizeof(WCHAR));
+		CopyMemory(pNew + iStart + cchText, pOld + iEnd, (cchOld - iEnd) * sizeof(WCHAR));
+
+		long iNewRegionEnd = iOldRegionEnd + cchNew - cchOld;
+		long cchRegion = iNewRegionEnd - iRegionStart;
+		_scan.Build(pNew + iRegionStart, cchRegion);
+
+		// unless the region runs to the end of the text, its last entry is where the line 
+		// after it starts
+		long cRegionLines = _scan.GetLineCount();
+		if (iEndLine + 1 < _lines.GetLineCount())
+			--cRegionLines;
+		_lengths.SetCount(cRegionLines);
+		for (long iLine = 0; iLine != cRegionLines; ++iLine)
+			_lengths[iLine] = _scan.GetLineStart(iLine + 1) - _scan.GetLineStart(iLine);
+		_lines.ReplaceLines(iStartLine, iEndLine - iStartLine + 1, _lengths.GetData(), cRegionLines);
+
+		_current = 1 - _current;
+		ticks += Diagnostics::Now() - start;
+		return S_OK;
+	}
+
+	HRESULT SetSpanMappings(long cMappings, const NewSpanMapping* rgMappings)
+	{
+		LONGLONG start = Diagnostics::Now();
+		++setMappingsCalls;
+		mappings.SetCount(cMappings);
+		if (cMappings != 0)
+			CopyMemory(mappings.GetData(), rgMappings, cMappings * sizeof(NewSpanMapping));
+		ticks += Diagnostics::Now() - start;
+		return S_OK;
+	}
+};
@@ -0,0 +1,42 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+
+// Runs every benchmark over synthetic views of 1k, 10k and 100k lines, or of the 
+// sizes given with --lines. --passes sets how many passes each measurement averages.
+int main(int argc, char* argv[])
+{
+	long rgLines[16] = {1000, 10000, 100000};
+	long cSizes = 3;
+	long cPasses = 20;
+
+	bool fSizesGiven = false;
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		if (strcmp(argv[arg], "--lines") == 0 && arg + 1 < argc)
+		{
+			if (!fSizesGiven)
+				cSizes = 0;
+			fSizesGiven = true;
+			if (cSizes != _countof(rgLines))
+				rgLines[cSizes++] = atol(argv[++arg]);
+		}
+		else if (strcmp(argv[arg], "--passes") == 0 && arg + 1 < argc)
+		{
+			cPasses = atol(argv[++arg]);
+		}
+		else
+		{
+			fprintf(stderr, "usage: PackageBenchmark [--lines n]... [--passes n]\n");
+			return 2;
+		}
+	}
+
+	for (long size = 0; size != cSizes; ++size)
+	{
+		RunColorizeBenchmark(rgLines[size], cPasses);
+		RunDiffBenchmark(rgLines[size], cPasses);
+		RunLineIndexBenchmark(rgLines[size], cPasses);
+		RunRegenerationBenchmark(rgLines[size], cPasses);
+	}
+	return 0;
+}
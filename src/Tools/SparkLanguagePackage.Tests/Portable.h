@@ -0,0 +1,597 @@
+#pragma once
+
+// Stand-ins for the parts of Win32, ATL and the compiler intrinsics used by the package
+// classes which don't talk to the editor - the tokenizer, line tables, diffing, secondary
+// text, the source registry and diagnostics - so they build and run with gcc or clang. The package's stdafx.h
+// includes this instead of the Windows headers when SPARK_PORTABLE is defined. Built with
+// -fshort-wchar, so WCHAR and L"" literals are UTF-16 code units as they are on Windows.
+
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <list>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include <emmintrin.h>
+
+// as the Windows compilers define it for 64-bit targets
+#if defined(__LP64__) && !defined(_WIN64)
+#define _WIN64
+#endif
+
+typedef wchar_t WCHAR;
+typedef WCHAR OLECHAR;
+typedef WCHAR* BSTR;
+typedef const WCHAR* LPCWSTR;
+typedef const char* LPCSTR;
+typedef unsigned char BYTE;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef uint32_t DWORD;
+typedef uint32_t UINT;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef uintptr_t UINT_PTR;
+typedef int32_t HRESULT;
+typedef int BOOL;
+typedef void* POSITION;
+
+static_assert(sizeof(WCHAR) == 2, "build with -fshort-wchar");
+
+union LARGE_INTEGER
+{
+	LONGLONG QuadPart;
+};
+
+#define TRUE 1
+#define FALSE 0
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_NOTIMPL ((HRESULT)0x80004001)
+#define E_NOINTERFACE ((HRESULT)0x80004002)
+#define E_POINTER ((HRESULT)0x80004003)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_UNEXPECTED ((HRESULT)0x8000FFFF)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define STDMETHODCALLTYPE
+#define STDMETHODIMP HRESULT STDMETHODCALLTYPE
+#define STDMETHODIMP_(type) type STDMETHODCALLTYPE
+
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+#define CopyMemory(destination, source, length) memcpy((destination), (source), (length))
+#define _countof(array) (sizeof(array) / sizeof((array)[0]))
+
+#define ATLASSERT(expression) assert(expression)
+
+// libc's wide functions work in 32-bit wchar_t, whatever the compiler was told
+inline size_t PortableStringLength(const WCHAR* text)
+{
+	const WCHAR* end = text;
+	while (*end != 0)
+		++end;
+	return end - text;
+}
+#define wcslen PortableStringLength
+
+
+//// exceptions
+
+class CAtlException
+{
+public:
+	HRESULT m_hr;
+	CAtlException(HRESULT hr) : m_hr(hr) {}
+};
+
+inline void AtlThrow(HRESULT hr)
+{
+	throw CAtlException(hr);
+}
+
+
+//// intrinsics
+
+inline unsigned char _BitScanForward(unsigned long* index, unsigned long mask)
+{
+	if (mask == 0)
+		return 0;
+	*index = __builtin_ctzl(mask);
+	return 1;
+}
+
+inline unsigned char _BitScanReverse(unsigned long* index, unsigned long mask)
+{
+	if (mask == 0)
+		return 0;
+	*index = sizeof(unsigned long) * CHAR_BIT - 1 - __builtin_clzl(mask);
+	return 1;
+}
+
+inline LONG InterlockedIncrement(volatile LONG* target) {return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);}
+inline LONG InterlockedDecrement(volatile LONG* target) {return __atomic_sub_fetch(target, 1, __ATOMIC_SEQ_CST);}
+inline LONG InterlockedExchange(volatile LONG* target, LONG value) {return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);}
+inline LONG InterlockedExchangeAdd(volatile LONG* target, LONG value) {return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST);}
+inline LONG InterlockedCompareExchange(volatile LONG* target, LONG value, LONG comparand)
+{
+	__atomic_compare_exchange_n(target, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+
+inline LONGLONG InterlockedIncrement64(volatile LONGLONG* target) {return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);}
+inline LONGLONG InterlockedExchange64(volatile LONGLONG* target, LONGLONG value) {return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);}
+inline LONGLONG InterlockedExchangeAdd64(volatile LONGLONG* target, LONGLONG value) {return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST);}
+inline LONGLONG InterlockedCompareExchange64(volatile LONGLONG* target, LONGLONG value, LONGLONG comparand)
+{
+	__atomic_compare_exchange_n(target, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return comparand;
+}
+
+
+//// threads and time
+
+inline DWORD GetCurrentThreadId()
+{
+	return (DWORD)syscall(SYS_gettid);
+}
+
+inline LONGLONG PortableNanoseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (LONGLONG)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* pCount)
+{
+	pCount->QuadPart = PortableNanoseconds();
+	return TRUE;
+}
+
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* pFrequency)
+{
+	pFrequency->QuadPart = 1000000000;
+	return TRUE;
+}
+
+inline DWORD GetTickCount()
+{
+	return (DWORD)(PortableNanoseconds() / 1000000);
+}
+
+struct SRWLOCK
+{
+	pthread_rwlock_t lock;
+};
+
+inline void InitializeSRWLock(SRWLOCK* pLock) {pthread_rwlock_init(&pLock->lock, NULL);}
+inline void AcquireSRWLockShared(SRWLOCK* pLock) {pthread_rwlock_rdlock(&pLock->lock);}
+inline void ReleaseSRWLockShared(SRWLOCK* pLock) {pthread_rwlock_unlock(&pLock->lock);}
+inline void AcquireSRWLockExclusive(SRWLOCK* pLock) {pthread_rwlock_wrlock(&pLock->lock);}
+inline void ReleaseSRWLockExclusive(SRWLOCK* pLock) {pthread_rwlock_unlock(&pLock->lock);}
+
+// recursive, like a critical section
+class CComCriticalSection
+{
+	pthread_mutex_t _mutex;
+
+	CComCriticalSection(const CComCriticalSection&);
+	CComCriticalSection& operator=(const CComCriticalSection&);
+
+public:
+	CComCriticalSection()
+	{
+		pthread_mutexattr_t attributes;
+		pthread_mutexattr_init(&attributes);
+		pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+		pthread_mutex_init(&_mutex, &attributes);
+		pthread_mutexattr_destroy(&attributes);
+	}
+
+	~CComCriticalSection()
+	{
+		pthread_mutex_destroy(&_mutex);
+	}
+
+	HRESULT Lock() {pthread_mutex_lock(&_mutex); return S_OK;}
+	HRESULT Unlock() {pthread_mutex_unlock(&_mutex); return S_OK;}
+};
+
+class CComAutoCriticalSection : public CComCriticalSection
+{
+};
+
+template<typename T>
+class CComCritSecLock
+{
+	T& _section;
+
+public:
+	CComCritSecLock(T& section) : _section(section) {_section.Lock();}
+	~CComCritSecLock() {_section.Unlock();}
+};
+
+
+//// BSTR
+
+// length-prefixed like the real ones, so SysStringLen needs no scan
+inline BSTR SysAllocStringLen(const OLECHAR* text, UINT length)
+{
+	uint32_t* block = (uint32_t*)malloc(sizeof(uint32_t) + (length + 1) * sizeof(OLECHAR));
+	if (block == NULL)
+		return NULL;
+	block[0] = length * sizeof(OLECHAR);
+	BSTR result = (BSTR)(block + 1);
+	if (text != NULL)
+		memcpy(result, text, length * sizeof(OLECHAR));
+	result[length] = 0;
+	return result;
+}
+
+inline BSTR SysAllocString(const OLECHAR* text)
+{
+	return text == NULL ? NULL : SysAllocStringLen(text, (UINT)wcslen(text));
+}
+
+inline UINT SysStringLen(BSTR text)
+{
+	return text == NULL ? 0 : ((uint32_t*)text)[-1] / sizeof(OLECHAR);
+}
+
+inline void SysFreeString(BSTR text)
+{
+	if (text != NULL)
+		free((uint32_t*)text - 1);
+}
+
+class CComBSTR
+{
+	CComBSTR(const CComBSTR&);
+	CComBSTR& operator=(const CComBSTR&);
+
+public:
+	BSTR m_str;
+
+	CComBSTR() : m_str(NULL) {}
+	CComBSTR(const OLECHAR* text) : m_str(SysAllocString(text)) {}
+	CComBSTR(int length, const OLECHAR* text) : m_str(SysAllocStringLen(text, length)) {}
+	~CComBSTR() {SysFreeString(m_str);}
+
+	operator BSTR() const {return m_str;}
+	BSTR* operator&() {return &m_str;}
+
+	UINT Length() const {return SysStringLen(m_str);}
+	UINT ByteLength() const {return Length() * sizeof(OLECHAR);}
+	BSTR Copy() const {return m_str == NULL ? NULL : SysAllocStringLen(m_str, Length());}
+	void Empty() {SysFreeString(m_str); m_str = NULL;}
+	void Attach(BSTR text) {if (m_str != text) {SysFreeString(m_str); m_str = text;}}
+	BSTR Detach() {BSTR text = m_str; m_str = NULL; return text;}
+};
+
+
+//// CStringW
+
+// over a vector, not std::wstring - the library's wide strings are built for 32-bit wchar_t
+class CStringW
+{
+	std::vector<WCHAR> _text;
+
+	void Assign(const WCHAR* text, size_t length)
+	{
+		_text.assign(text, text + length);
+		_text.push_back(0);
+	}
+
+	void Insert(const WCHAR* text, size_t length)
+	{
+		_text.insert(_text.end() - 1, text, text + length);
+	}
+
+public:
+	CStringW() {_text.push_back(0);}
+	CStringW(const WCHAR* text) {Assign(text, text == NULL ? 0 : wcslen(text));}
+	CStringW(const WCHAR* text, int length) {Assign(text, length);}
+
+	operator const WCHAR*() const {return &_text[0];}
+	WCHAR operator[](int index) const {return _text[index];}
+	bool operator==(const WCHAR* text) const {return wcslen(text) == (size_t)GetLength() && memcmp(&_text[0], text, GetLength() * sizeof(WCHAR)) == 0;}
+	bool operator!=(const WCHAR* text) const {return !(*this == text);}
+
+	int GetLength() const {return (int)_text.size() - 1;}
+	bool IsEmpty() const {return _text.size() == 1;}
+	void Empty() {Assign(NULL, 0);}
+
+	void SetString(const WCHAR* text, int length) {Assign(text, length);}
+	void Append(const WCHAR* text) {Insert(text, wcslen(text));}
+	void Append(const WCHAR* text, int length) {Insert(text, length);}
+	void AppendChar(WCHAR ch) {Insert(&ch, 1);}
+
+	int Find(const WCHAR* text, int start = 0) const
+	{
+		size_t length = wcslen(text);
+		for (int index = start; index + length <= (size_t)GetLength(); ++index)
+		{
+			if (memcmp(&_text[index], text, length * sizeof(WCHAR)) == 0)
+				return index;
+		}
+		return -1;
+	}
+
+	int ReverseFind(WCHAR ch) const
+	{
+		for (int index = GetLength(); index-- != 0; )
+		{
+			if (_text[index] == ch)
+				return index;
+		}
+		return -1;
+	}
+
+	CStringW& MakeLower()
+	{
+		for (size_t index = 0; index != _text.size(); ++index)
+		{
+			if (_text[index] >= L'A' && _text[index] <= L'Z')
+				_text[index] += L'a' - L'A';
+		}
+		return *this;
+	}
+
+	BSTR AllocSysString() const {return SysAllocStringLen(&_text[0], GetLength());}
+
+	// the conversions the package formats with - %s, %d, %ld, %u and %I64d
+	void AppendFormat(const WCHAR* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		for (const WCHAR* pch = format; *pch != 0; ++pch)
+		{
+			if (*pch != L'%')
+			{
+				AppendChar(*pch);
+				continue;
+			}
+
+			char number[32];
+			number[0] = 0;
+			++pch;
+			if (*pch == L's')
+				Append(va_arg(args, const WCHAR*));
+			else if (*pch == L'd')
+				snprintf(number, sizeof(number), "%d", va_arg(args, int));
+			else if (*pch == L'u')
+				snprintf(number, sizeof(number), "%u", va_arg(args, unsigned int));
+			else if (pch[0] == L'l' && pch[1] == L'd')
+				++pch, snprintf(number, sizeof(number), "%ld", va_arg(args, long));
+			else if (pch[0] == L'I' && pch[1] == L'6' && pch[2] == L'4' && pch[3] == L'd')
+				pch += 3, snprintf(number, sizeof(number), "%lld", (long long)va_arg(args, LONGLONG));
+			else if (*pch == L'%')
+				AppendChar(L'%');
+			for (const char* pDigit = number; *pDigit != 0; ++pDigit)
+				AppendChar((WCHAR)*pDigit);
+		}
+		va_end(args);
+	}
+};
+
+
+//// collections
+
+template<typename T>
+class CAtlArray
+{
+	std::vector<T> _items;
+
+	CAtlArray(const CAtlArray&);
+	CAtlArray& operator=(const CAtlArray&);
+
+public:
+	CAtlArray() {}
+
+	size_t GetCount() const {return _items.size();}
+	bool IsEmpty() const {return _items.empty();}
+	T* GetData() {return _items.empty() ? NULL : &_items[0];}
+	const T* GetData() const {return _items.empty() ? NULL : &_items[0];}
+
+	T& operator[](size_t index) {ATLASSERT(index < _items.size()); return _items[index];}
+	const T& operator[](size_t index) const {ATLASSERT(index < _items.size()); return _items[index];}
+
+	bool SetCount(size_t count) {_items.resize(count); return true;}
+	size_t Add(const T& item) {_items.push_back(item); return _items.size() - 1;}
+	void InsertAt(size_t index, const T& item) {_items.insert(_items.begin() + index, item);}
+	void RemoveAt(size_t index, size_t count = 1) {_items.erase(_items.begin() + index, _items.begin() + index + count);}
+	void RemoveAll() {_items.clear();}
+};
+
+// keys hashed by value, iterated in order of insertion
+template<typename K, typename V>
+class CAtlMap
+{
+public:
+	struct CPair
+	{
+		K m_key;
+		V m_value;
+		CPair(const K& key, const V& value) : m_key(key), m_value(value) {}
+	};
+
+private:
+	std::list<CPair> _pairs;
+	std::unordered_map<K, typename std::list<CPair>::iterator> _index;
+
+	CAtlMap(const CAtlMap&);
+	CAtlMap& operator=(const CAtlMap&);
+
+	// a position is the address of a pair, found again through its key
+	POSITION PositionOf(typename std::list<CPair>::iterator it)
+	{
+		return it == _pairs.end() ? NULL : (POSITION)&*it;
+	}
+
+public:
+	CAtlMap() {}
+
+	size_t GetCount() const {return _pairs.size();}
+	bool IsEmpty() const {return _pairs.empty();}
+
+	bool Lookup(const K& key, V& value) const
+	{
+		typename std::unordered_map<K, typename std::list<CPair>::iterator>::const_iterator found = _index.find(key);
+		if (found == _index.end())
+			return false;
+		value = found->second->m_value;
+		return true;
+	}
+
+	CPair* Lookup(const K& key)
+	{
+		typename std::unordered_map<K, typename std::list<CPair>::iterator>::iterator found = _index.find(key);
+		return found == _index.end() ? NULL : &*found->second;
+	}
+
+	void SetAt(const K& key, const V& value)
+	{
+		CPair* existing = Lookup(key);
+		if (existing != NULL)
+		{
+			existing->m_value = value;
+			return;
+		}
+		_pairs.push_back(CPair(key, value));
+		_index[key] = --_pairs.end();
+	}
+
+	bool RemoveKey(const K& key)
+	{
+		typename std::unordered_map<K, typename std::list<CPair>::iterator>::iterator found = _index.find(key);
+		if (found == _index.end())
+			return false;
+		_pairs.erase(found->second);
+		_index.erase(found);
+		return true;
+	}
+
+	void RemoveAll()
+	{
+		_pairs.clear();
+		_index.clear();
+	}
+
+	POSITION GetStartPosition() {return PositionOf(_pairs.begin());}
+
+	CPair* GetNext(POSITION& pos)
+	{
+		CPair* pair = (CPair*)pos;
+		typename std::list<CPair>::iterator it = _index.find(pair->m_key)->second;
+		pos = PositionOf(++it);
+		return pair;
+	}
+
+	V& GetNextValue(POSITION& pos) {return GetNext(pos)->m_value;}
+};
+
+
+//// COM
+
+struct GUID
+{
+	uint32_t Data1;
+	uint16_t Data2;
+	uint16_t Data3;
+	uint8_t Data4[8];
+};
+typedef const GUID& REFIID;
+
+inline bool operator==(const GUID& a, const GUID& b) {return memcmp(&a, &b, sizeof(GUID)) == 0;}
+
+struct IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppv) = 0;
+	virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+	virtual ULONG STDMETHODCALLTYPE Release() = 0;
+};
+
+template<typename T>
+class CComPtr
+{
+public:
+	T* p;
+
+	CComPtr() : p(NULL) {}
+	CComPtr(T* other) : p(other) {if (p != NULL) p->AddRef();}
+	CComPtr(const CComPtr& other) : p(other.p) {if (p != NULL) p->AddRef();}
+	~CComPtr() {if (p != NULL) p->Release();}
+
+	CComPtr& operator=(T* other)
+	{
+		if (other != NULL)
+			other->AddRef();
+		if (p != NULL)
+			p->Release();
+		p = other;
+		return *this;
+	}
+	CComPtr& operator=(const CComPtr& other) {return *this = other.p;}
+
+	operator T*() const {return p;}
+	T* operator->() const {return p;}
+	T** operator&() {ATLASSERT(p == NULL); return &p;}
+
+	void Release() {T* released = p; p = NULL; if (released != NULL) released->Release();}
+	void Attach(T* other) {if (p != NULL) p->Release(); p = other;}
+	T* Detach() {T* detached = p; p = NULL; return detached;}
+};
+
+// holds a reference on each element
+template<typename I>
+class CInterfaceArray : public CAtlArray<CComPtr<I> >
+{
+};
+
+// named by atlutil.h's CComCreatableObject, which no portable code creates
+template<typename T> const GUID& PortableUuidOf();
+#define __uuidof(T) PortableUuidOf<T>()
+template<typename ThreadModel> class CComObjectRootEx {};
+class CComMultiThreadModel;
+template<typename T> class CComObject;
+template<typename T> class CComCreator;
+
+
+//// visual studio sdk - the fields the package reads
+
+struct TextSpan
+{
+	long iStartLine;
+	long iStartIndex;
+	long iEndLine;
+	long iEndIndex;
+};
+
+struct TextSpanPair
+{
+	TextSpan span1;
+	TextSpan span2;
+};
+
+struct NewSpanMapping
+{
+	TextSpanPair tspSpans;
+};
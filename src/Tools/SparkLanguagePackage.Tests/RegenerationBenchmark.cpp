@@ -0,0 +1,93 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "SyntheticView.h"
+#include "MemoryTextTarget.h"
+#include "GeneratedState.h"
+#include "SupervisorDelta.h"
+
+// Source::OnGeneratedDelta as far as the editor-independent classes take it - the delta 
+// applied to the delivered generation, the edited primary line measured, and the 
+// secondary buffer and mapping table brought up to date. The buffer's own time is 
+// reported apart from the package's.
+void RunRegenerationBenchmark(long cLines, long cPasses)
+{
+	SyntheticView view;
+	view.Build(cLines, 0xD1FF);
+
+	GeneratedState delivered;
+	MemoryTextTarget target;
+	SpanMappingTable mappingTable;
+	SecondaryTextBuffers buffers;
+	LineIndex primaryLines;
+	PooledArray<long> lineLength;
+	lineLength.SetCount(1);
+	SupervisorDelta delta;
+
+	long previousPrimaryLength = 0;
+	LONGLONG ticks = 0;
+	LONGLONG targetTicks = 0;
+	LONGLONG allocations = 0;
+	long cReplaced = 0;
+	LONGLONG charsRead = 0;
+	for (long pass = 0; pass <= cPasses; ++pass)
+	{
+		// the first pass delivers the whole generation to an empty buffer, and isn't counted
+		long iEditedLine = -1;
+		if (pass != 0)
+			iEditedLine = view.EditExpression();
+		MakeSupervisorDelta(
+			delivered.GetText(), delivered.GetTextLength(), delivered.GetMappings(), previousPrimaryLength, 
+			view.GetSecondary(), view.GetSecondary().GetLength(), view.GetMappings(), view.GetPrimary().GetLength(), 
+			delta);
+		previousPrimaryLength = view.GetPrimary().GetLength();
+		target.ResetCounts();
+
+		LONGLONG start = BenchmarkNow();
+		LONGLONG allocationsStart = GetAllocationCount();
+
+		const WCHAR* pPrimary = view.GetPrimary();
+		if (iEditedLine == -1)
+		{
+			primaryLines.Build(pPrimary, view.GetPrimary().GetLength());
+		}
+		else
+		{
+			long iLineStart = primaryLines.GetLineStart(iEditedLine);
+			long iNextLine = iLineStart;
+			while (pPrimary[iNextLine] != L'\n')
+				++iNextLine;
+			lineLength[0] = iNextLine + 1 - iLineStart;
+			primaryLines.ReplaceLines(iEditedLine, 1, lineLength.GetData(), 1);
+		}
+
+		delivered.ApplyDelta(
+			pass + 1, pass, 
+			&delta.edit, 1, delta.inserted, delta.inserted.GetLength(), 
+			&delta.op, 1, delta.mappings.GetData(), (long)delta.mappings.GetCount());
+		SecondaryText::Apply(
+			&target, primaryLines, 
+			delivered.GetText(), delivered.GetTextLength(), 
+			delivered.GetMappings().GetData(), (long)delivered.GetMappings().GetCount(), 
+			mappingTable, buffers);
+
+		if (pass != 0)
+		{
+			ticks += BenchmarkNow() - start - target.ticks;
+			targetTicks += target.ticks;
+			allocations += GetAllocationCount() - allocationsStart;
+			cReplaced += target.replaceCalls;
+			charsRead += target.charsRead;
+		}
+
+		if (!target.Equals(view.GetSecondary(), view.GetSecondary().GetLength()))
+		{
+			fprintf(stderr, "regeneration left the secondary buffer different from the generated code\n");
+			exit(1);
+		}
+	}
+
+	ReportBenchmark("regenerate", cLines, (double)ticks / cPasses / 1000, "us/pass", (double)allocations / cPasses);
+	ReportBenchmark("regenerate buffer stand-in", cLines, (double)targetTicks / cPasses / 1000, "us/pass", 0);
+	ReportBenchmark("regenerate replacements", cLines, (double)cReplaced / cPasses, "calls/pass", 0);
+	ReportBenchmark("regenerate buffer read back", cLines, (double)charsRead / cPasses, "chars/pass", 0);
+}
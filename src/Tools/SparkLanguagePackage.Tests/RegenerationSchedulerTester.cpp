@@ -0,0 +1,481 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "RegenerationScheduler.h"
+
+// The UI thread's message loop in miniature - a dispatch the scheduler asked for is
+// delivered when the test pumps, and the clock is moved on by what each generation costs
+class TestDispatcher : public RegenerationDispatcher
+{
+public:
+	RegenerationScheduler scheduler;
+	long requests;
+	bool requested;
+	LONGLONG clock;
+
+	TestDispatcher() : requests(0), requested(false), clock(0)
+	{
+		scheduler.Open(this);
+	}
+
+	void RequestDispatch()
+	{
+		++requests;
+		requested = true;
+	}
+
+	// delivers one dispatch, if one was asked for
+	bool PumpOne()
+	{
+		if (!requested)
+			return false;
+		requested = false;
+		return scheduler.RunNext();
+	}
+
+	// delivers dispatches until there are none, or as many jobs as allowed have run
+	long Pump(long maximum = 1000)
+	{
+		long ran = 0;
+		while (ran != maximum && requested)
+		{
+			if (PumpOne())
+				++ran;
+		}
+		return ran;
+	}
+};
+
+// An open document - generation takes as long as it's scripted to, and while it
+// runs it can do what a supervisor calling back into the package might
+class TestSource : public IUnknown, public RegenerationJob
+{
+	LONG _references;
+
+public:
+	TestDispatcher& dispatcher;
+	CAtlArray<TestSource*>* log;
+	long cost;
+	long runs;
+	LONGLONG scheduledAt;
+	LONGLONG longestWait;
+
+	// scripted behaviour while running
+	long editsWhileRunning;
+	bool cancelWhileRunning;
+	bool pumpWhileRunning;
+	bool immediateWhileRunning;
+	bool closeWhileRunning;
+	bool immediateRefused;
+	TestSource* otherWhileRunning;
+
+	TestSource(TestDispatcher& dispatcher, CAtlArray<TestSource*>* log, long cost) :
+		_references(1), dispatcher(dispatcher), log(log), cost(cost), runs(0), scheduledAt(-1), longestWait(0),
+		editsWhileRunning(0), cancelWhileRunning(false), pumpWhileRunning(false),
+		immediateWhileRunning(false), closeWhileRunning(false), immediateRefused(false), otherWhileRunning(NULL)
+	{
+	}
+
+	// Release deletes through the most derived type, but the scheduler holds it by its bases
+	virtual ~TestSource()
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** ppv)
+	{
+		*ppv = NULL;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef()
+	{
+		return ++_references;
+	}
+
+	ULONG STDMETHODCALLTYPE Release()
+	{
+		LONG references = --_references;
+		if (references == 0)
+			delete this;
+		return references;
+	}
+
+	LONG GetReferences() const {return _references;}
+
+	bool Schedule(RegenerationPriority priority)
+	{
+		if (scheduledAt == -1)
+			scheduledAt = dispatcher.clock;
+		return dispatcher.scheduler.Schedule(this, this, priority);
+	}
+
+	void RunRegeneration()
+	{
+		if (scheduledAt != -1 && dispatcher.clock - scheduledAt > longestWait)
+			longestWait = dispatcher.clock - scheduledAt;
+		scheduledAt = -1;
+
+		++runs;
+		if (log != NULL)
+			log->Add(this);
+		dispatcher.clock += cost;
+
+		if (editsWhileRunning != 0)
+		{
+			--editsWhileRunning;
+			Schedule(RegenerationPriorityFocused);
+		}
+		if (cancelWhileRunning)
+			dispatcher.scheduler.Cancel(this);
+		if (pumpWhileRunning)
+			dispatcher.Pump();
+		if (otherWhileRunning != NULL && dispatcher.scheduler.BeginInline(otherWhileRunning))
+		{
+			otherWhileRunning->RunRegeneration();
+			dispatcher.scheduler.EndInline(otherWhileRunning);
+		}
+		if (immediateWhileRunning && !dispatcher.scheduler.BeginInline(this))
+		{
+			immediateRefused = true;
+			Schedule(RegenerationPriorityFocused);
+		}
+		if (closeWhileRunning)
+			dispatcher.scheduler.Close();
+	}
+};
+
+TEST(FocusedThenVisibleThenBackground)
+{
+	TestDispatcher dispatcher;
+	CAtlArray<TestSource*> log;
+	CComPtr<TestSource> background1;
+	CComPtr<TestSource> visible;
+	CComPtr<TestSource> focused;
+	CComPtr<TestSource> background2;
+	background1.Attach(new TestSource(dispatcher, &log, 10));
+	visible.Attach(new TestSource(dispatcher, &log, 10));
+	focused.Attach(new TestSource(dispatcher, &log, 10));
+	background2.Attach(new TestSource(dispatcher, &log, 10));
+
+	CHECK(background1->Schedule(RegenerationPriorityBackground));
+	CHECK(visible->Schedule(RegenerationPriorityVisible));
+	CHECK(focused->Schedule(RegenerationPriorityFocused));
+	CHECK(background2->Schedule(RegenerationPriorityBackground));
+	CHECK_EQUAL(1, dispatcher.requests);
+
+	CHECK_EQUAL(4, dispatcher.Pump());
+	CHECK_EQUAL(4, log.GetCount());
+	CHECK(log[0] == focused);
+	CHECK(log[1] == visible);
+	CHECK(log[2] == background1);
+	CHECK(log[3] == background2);
+
+	// the owners were held while queued, and let go once run
+	CHECK_EQUAL(1, focused->GetReferences());
+	CHECK_EQUAL(1, background2->GetReferences());
+}
+
+TEST(OneJobPerDispatch)
+{
+	TestDispatcher dispatcher;
+	CComPtr<TestSource> first;
+	CComPtr<TestSource> second;
+	first.Attach(new TestSource(dispatcher, NULL, 10));
+	second.Attach(new TestSource(dispatcher, NULL, 10));
+
+	first->Schedule(RegenerationPriorityVisible);
+	second->Schedule(RegenerationPriorityVisible);
+
+	// input is handled between the two - the second waits for a dispatch of its own
+	CHECK(dispatcher.PumpOne());
+	CHECK_EQUAL(1, first->runs);
+	CHECK_EQUAL(0, second->runs);
+	CHECK(dispatcher.requested);
+
+	CHECK(dispatcher.PumpOne());
+	CHECK_EQUAL(1, second->runs);
+	CHECK(!dispatcher.requested);
+	CHECK(!dispatcher.scheduler.RunNext());
+}
+
+TEST(SchedulingAWaitingJobCoalesces)
+{
+	TestDispatcher dispatcher;
+	CAtlArray<TestSource*> log;
+	CComPtr<TestSource> visible;
+	CComPtr<TestSource> edited;
+	visible.Attach(new TestSource(dispatcher, &log, 10));
+	edited.Attach(new TestSource(dispatcher, &log, 10));
+
+	visible->Schedule(RegenerationPriorityVisible);
+	for (int edit = 0; edit != 5; ++edit)
+		edited->Schedule(RegenerationPriorityBackground);
+	CHECK_EQUAL(2, edited->GetReferences());
+	CHECK_EQUAL(1, dispatcher.requests);
+
+	// focus came to it while it waited
+	edited->Schedule(RegenerationPriorityFocused);
+
+	CHECK_EQUAL(2, dispatcher.Pump());
+	CHECK_EQUAL(1, edited->runs);
+	CHECK(log[0] == edited);
+	CHECK(log[1] == visible);
+}
+
+TEST(PriorityChangesWhileWaiting)
+{
+	TestDispatcher dispatcher;
+	CAtlArray<TestSource*> log;
+	CComPtr<TestSource> first;
+	CComPtr<TestSource> second;
+	first.Attach(new TestSource(dispatcher, &log, 10));
+	second.Attach(new TestSource(dispatcher, &log, 10));
+
+	first->Schedule(RegenerationPriorityFocused);
+	second->Schedule(RegenerationPriorityBackground);
+	dispatcher.scheduler.SetPriority(first, RegenerationPriorityBackground);
+	dispatcher.scheduler.SetPriority(second, RegenerationPriorityFocused);
+
+	dispatcher.Pump();
+	CHECK_EQUAL(2, log.GetCount());
+	CHECK(log[0] == second);
+	CHECK(log[1] == first);
+}
+
+TEST(ScheduledWhileRunningRunsOnceMore)
+{
+	TestDispatcher dispatcher;
+	CAtlArray<TestSource*> log;
+	CComPtr<TestSource> edited;
+	CComPtr<TestSource> background;
+	edited.Attach(new TestSource(dispatcher, &log, 10));
+	background.Attach(new TestSource(dispatcher, &log, 10));
+	edited->editsWhileRunning = 1;
+
+	edited->Schedule(RegenerationPriorityFocused);
+	background->Schedule(RegenerationPriorityBackground);
+
+	CHECK_EQUAL(3, dispatcher.Pump());
+	CHECK_EQUAL(2, edited->runs);
+	CHECK_EQUAL(1, background->runs);
+	CHECK(log[0] == edited);
+	CHECK(log[1] == edited);
+	CHECK(log[2] == background);
+	CHECK_EQUAL(1, edited->GetReferences());
+}
+
+TEST(CancelledJobsDontRun)
+{
+	TestDispatcher dispatcher;
+	CComPtr<TestSource> waiting;
+	CComPtr<TestSource> running;
+	waiting.Attach(new TestSource(dispatcher, NULL, 10));
+	running.Attach(new TestSource(dispatcher, NULL, 10));
+
+	waiting->Schedule(RegenerationPriorityFocused);
+	dispatcher.scheduler.Cancel(waiting);
+	CHECK_EQUAL(1, waiting->GetReferences());
+
+	// edited while it ran, then closed before it returned
+	running->editsWhileRunning = 1;
+	running->cancelWhileRunning = true;
+	running->Schedule(RegenerationPriorityFocused);
+
+	dispatcher.Pump();
+	CHECK_EQUAL(0, waiting->runs);
+	CHECK_EQUAL(1, running->runs);
+	CHECK_EQUAL(1, running->GetReferences());
+
+	// a job that isn't queued has nothing to cancel
+	dispatcher.scheduler.Cancel(waiting);
+	CHECK_EQUAL(1, waiting->GetReferences());
+}
+
+TEST(LargeFocusedViewDoesntStarveTheOthers)
+{
+	// a view taking nearly a second to generate, edited all the while, and three small
+	// ones a layout change queued behind it
+	const long largeCost = 800;
+	const long smallCost = 20;
+	TestDispatcher dispatcher;
+	CAtlArray<TestSource*> log;
+	CComPtr<TestSource> large;
+	CComPtr<TestSource> small[3];
+	large.Attach(new TestSource(dispatcher, &log, largeCost));
+	large->editsWhileRunning = 1000;
+	large->Schedule(RegenerationPriorityFocused);
+	for (int index = 0; index != 3; ++index)
+	{
+		small[index].Attach(new TestSource(dispatcher, &log, smallCost));
+		small[index]->Schedule(RegenerationPriorityBackground);
+	}
+
+	CHECK_EQUAL(40, dispatcher.Pump(40));
+
+	// each small view waits out no more than a bounded number of the large one's
+	// generations, and the large one still has most of the time
+	for (int index = 0; index != 3; ++index)
+	{
+		CHECK_EQUAL(1, small[index]->runs);
+		CHECK(small[index]->longestWait <= 5 * largeCost);
+	}
+	CHECK_EQUAL(37, large->runs);
+	CHECK(log[0] == large);
+
+	// nothing small was waiting after that, so the large view had every turn since
+	for (size_t index = 7; index != log.GetCount(); ++index)
+		CHECK(log[index] == large);
+}
+
+TEST(ViewsAllEditedAtOnceTakeTurns)
+{
+	// more views than the fairness bound, all of them edited without a pause
+	TestDispatcher dispatcher;
+	CComPtr<TestSource> sources[6];
+	long totalCost = 0;
+	for (int index = 0; index != 6; ++index)
+	{
+		sources[index].Attach(new TestSource(dispatcher, NULL, 10 + index * 50));
+		sources[index]->editsWhileRunning = 1000;
+		sources[index]->Schedule(index == 0 ? RegenerationPriorityFocused : RegenerationPriorityBackground);
+		totalCost += sources[index]->cost;
+	}
+
+	CHECK_EQUAL(600, dispatcher.Pump(600));
+
+	// each waits no longer than the others take to generate once, and the focused view as
+	// many more times as the bound lets it go first - however long it takes itself
+	for (int index = 0; index != 6; ++index)
+	{
+		CHECK(sources[index]->runs >= 600 / 6 - 1);
+		CHECK(sources[index]->longestWait <= totalCost - sources[index]->cost + 4 * sources[0]->cost);
+	}
+}
+
+TEST(ImmediateRequestTakesTheJobOutOfTheQueue)
+{
+	TestDispatcher dispatcher;
+	CComPtr<TestSource> source;
+	source.Attach(new TestSource(dispatcher, NULL, 10));
+
+	source->Schedule(RegenerationPriorityBackground);
+	CHECK(dispatcher.scheduler.BeginInline(source));
+	source->RunRegeneration();
+
+	// a dispatch while the caller runs it leaves it alone
+	CHECK(!dispatcher.scheduler.RunNext());
+	dispatcher.scheduler.EndInline(source);
+
+	CHECK_EQUAL(0, dispatcher.Pump());
+	CHECK_EQUAL(1, source->runs);
+	CHECK_EQUAL(1, source->GetReferences());
+}
+
+TEST(ImmediateRequestForAnotherSourceRunsInsideARegeneration)
+{
+	TestDispatcher dispatcher;
+	CComPtr<TestSource> source;
+	CComPtr<TestSource> other;
+	source.Attach(new TestSource(dispatcher, NULL, 10));
+	other.Attach(new TestSource(dispatcher, NULL, 10));
+	source->otherWhileRunning = other;
+
+	other->Schedule(RegenerationPriorityBackground);
+	source->Schedule(RegenerationPriorityFocused);
+
+	CHECK_EQUAL(1, dispatcher.Pump());
+	CHECK_EQUAL(1, source->runs);
+	CHECK_EQUAL(1, other->runs);
+	CHECK_EQUAL(1, other->GetReferences());
+}
+
+TEST(ImmediateRequestWhileRunningRunsOnceMoreAfter)
+{
+	TestDispatcher dispatcher;
+	CComPtr<TestSource> source;
+	source.Attach(new TestSource(dispatcher, NULL, 10));
+	source->immediateWhileRunning = true;
+
+	source->Schedule(RegenerationPriorityBackground);
+	CHECK(dispatcher.PumpOne());
+	CHECK(source->immediateRefused);
+	CHECK_EQUAL(1, source->runs);
+
+	source->immediateWhileRunning = false;
+	CHECK_EQUAL(1, dispatcher.Pump());
+	CHECK_EQUAL(2, source->runs);
+	CHECK_EQUAL(1, source->GetReferences());
+}
+
+TEST(DispatchWaitsForTheRunningJob)
+{
+	TestDispatcher dispatcher;
+	CAtlArray<TestSource*> log;
+	CComPtr<TestSource> pumping;
+	CComPtr<TestSource> other;
+	pumping.Attach(new TestSource(dispatcher, &log, 10));
+	other.Attach(new TestSource(dispatcher, &log, 10));
+
+	// messages pumped while the supervisor generates reach the dispatcher
+	pumping->pumpWhileRunning = true;
+	pumping->Schedule(RegenerationPriorityFocused);
+	other->Schedule(RegenerationPriorityBackground);
+	dispatcher.requested = true;
+
+	CHECK(dispatcher.PumpOne());
+	CHECK_EQUAL(1, log.GetCount());
+
+	CHECK_EQUAL(1, dispatcher.Pump());
+	CHECK_EQUAL(2, log.GetCount());
+	CHECK(log[1] == other);
+}
+
+TEST(CloseForgetsWaitingJobs)
+{
+	TestDispatcher dispatcher;
+	CComPtr<TestSource> first;
+	CComPtr<TestSource> second;
+	first.Attach(new TestSource(dispatcher, NULL, 10));
+	second.Attach(new TestSource(dispatcher, NULL, 10));
+
+	first->Schedule(RegenerationPriorityFocused);
+	second->Schedule(RegenerationPriorityVisible);
+	dispatcher.scheduler.Close();
+	CHECK(!dispatcher.scheduler.IsOpen());
+	CHECK_EQUAL(1, first->GetReferences());
+	CHECK_EQUAL(1, second->GetReferences());
+
+	CHECK_EQUAL(0, dispatcher.Pump());
+	CHECK(!first->Schedule(RegenerationPriorityFocused));
+	CHECK_EQUAL(1, first->GetReferences());
+}
+
+TEST(CloseWhileRunningFinishesTheRunningJob)
+{
+	TestDispatcher dispatcher;
+	CComPtr<TestSource> closing;
+	CComPtr<TestSource> waiting;
+	closing.Attach(new TestSource(dispatcher, NULL, 10));
+	waiting.Attach(new TestSource(dispatcher, NULL, 10));
+	closing->editsWhileRunning = 1;
+	closing->closeWhileRunning = true;
+
+	closing->Schedule(RegenerationPriorityFocused);
+	waiting->Schedule(RegenerationPriorityBackground);
+
+	CHECK_EQUAL(1, dispatcher.Pump());
+	CHECK_EQUAL(1, closing->runs);
+	CHECK_EQUAL(0, waiting->runs);
+	CHECK_EQUAL(1, closing->GetReferences());
+	CHECK_EQUAL(1, waiting->GetReferences());
+}
+
+TEST(OwnerHeldUntilTheJobFinishes)
+{
+	TestDispatcher dispatcher;
+	TestSource* source = new TestSource(dispatcher, NULL, 10);
+	source->Schedule(RegenerationPriorityFocused);
+
+	// the document closed - the queue holds the last reference
+	CHECK_EQUAL(1, source->Release());
+	CHECK_EQUAL(1, dispatcher.Pump());
+}
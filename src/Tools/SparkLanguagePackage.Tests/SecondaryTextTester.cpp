@@ -0,0 +1,266 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "SyntheticView.h"
+#include "MemoryTextTarget.h"
+
+// A buffer whose next replacement fails, as one can when the editor refuses an edit
+class FailingTextTarget : public MemoryTextTarget
+{
+public:
+	bool failNextReplace;
+
+	FailingTextTarget() : failNextReplace(false)
+	{
+	}
+
+	HRESULT ReplaceLines(long iStartLine, long iStartIndex, long iEndLine, long iEndIndex, const WCHAR* pText, long cchText)
+	{
+		if (failNextReplace)
+		{
+			failNextReplace = false;
+			return E_FAIL;
+		}
+		return MemoryTextTarget::ReplaceLines(iStartLine, iStartIndex, iEndLine, iEndIndex, pText, cchText);
+	}
+};
+
+struct SecondaryTextFixture
+{
+	SyntheticView view;
+	FailingTextTarget target;
+	LineIndex primaryLines;
+	SpanMappingTable mappingTable;
+	SecondaryTextBuffers buffers;
+
+	SecondaryTextFixture(long cLines)
+	{
+		view.Build(cLines, 0x5EC0);
+	}
+
+	HRESULT Apply()
+	{
+		target.ResetCounts();
+		primaryLines.Build(view.GetPrimary(), view.GetPrimary().GetLength());
+		return SecondaryText::Apply(
+			&target, primaryLines, 
+			view.GetSecondary(), view.GetSecondary().GetLength(), 
+			view.GetMappings().GetData(), (long)view.GetMappings().GetCount(), 
+			mappingTable, buffers);
+	}
+
+	bool TargetCurrent() const
+	{
+		return target.Equals(view.GetSecondary(), view.GetSecondary().GetLength()) &&
+			target.mappings.GetCount() == view.GetMappings().GetCount();
+	}
+};
+
+TEST(FirstApplyReadsTheBuffer)
+{
+	SecondaryTextFixture fixture(200);
+	CHECK_EQUAL(S_OK, fixture.Apply());
+	CHECK_EQUAL(1, fixture.target.getTextCalls);
+	CHECK(fixture.TargetCurrent());
+	CHECK(fixture.buffers.existingValid);
+}
+
+TEST(LaterAppliesDiffAgainstTheKeptText)
+{
+	SecondaryTextFixture fixture(200);
+	fixture.Apply();
+	for (long pass = 0; pass != 20; ++pass)
+	{
+		fixture.view.EditExpression();
+		CHECK_EQUAL(S_OK, fixture.Apply());
+		CHECK_EQUAL(0, fixture.target.getTextCalls);
+		CHECK_EQUAL(0, fixture.target.charsRead);
+		CHECK(fixture.target.replaceCalls != 0);
+		CHECK(fixture.TargetCurrent());
+	}
+}
+
+TEST(UnchangedGenerationLeavesTheBufferAlone)
+{
+	SecondaryTextFixture fixture(50);
+	fixture.Apply();
+	CHECK_EQUAL(S_OK, fixture.Apply());
+	CHECK_EQUAL(0, fixture.target.getTextCalls);
+	CHECK_EQUAL(0, fixture.target.replaceCalls);
+	CHECK(fixture.TargetCurrent());
+}
+
+TEST(ReportedOutsideEditIsReadBack)
+{
+	SecondaryTextFixture fixture(100);
+	fixture.Apply();
+
+	// typing the coordinator carried across, which the next generation may or may not keep
+	CStringW edited(fixture.view.GetSecondary());
+	edited.Append(L"// typed\r\n");
+	fixture.target.SetText(edited, edited.GetLength());
+	fixture.buffers.existingValid = false;
+
+	fixture.view.EditExpression();
+	CHECK_EQUAL(S_OK, fixture.Apply());
+	CHECK_EQUAL(1, fixture.target.getTextCalls);
+	CHECK(fixture.TargetCurrent());
+
+	fixture.view.EditExpression();
+	CHECK_EQUAL(S_OK, fixture.Apply());
+	CHECK_EQUAL(0, fixture.target.getTextCalls);
+	CHECK(fixture.TargetCurrent());
+}
+
+TEST(FailedReplacementReadsBackNextTime)
+{
+	SecondaryTextFixture fixture(100);
+	fixture.Apply();
+
+	fixture.view.EditExpression();
+	fixture.target.failNextReplace = true;
+	CHECK(FAILED(fixture.Apply()));
+	CHECK(!fixture.buffers.existingValid);
+
+	CHECK_EQUAL(S_OK, fixture.Apply());
+	CHECK_EQUAL(1, fixture.target.getTextCalls);
+	CHECK(fixture.TargetCurrent());
+}
+
+// the coordinator's mappings, worked out again from line tables of both texts
+static bool MappingsMatch(const MemoryTextTarget& target, const CStringW& primary, const CStringW& secondary, const PooledArray<SourceMapping>& spans)
+{
+	LineTable primaryLines;
+	primaryLines.Build(primary, primary.GetLength());
+	LineTable secondaryLines;
+	secondaryLines.Build(secondary, secondary.GetLength());
+	if (target.mappings.GetCount() != spans.GetCount())
+		return false;
+
+	for (size_t index = 0; index != spans.GetCount(); ++index)
+	{
+		TextSpan expected1;
+		TextSpan expected2;
+		primaryLines.GetLineIndexOfPosition(spans[index].start1, &expected1.iStartLine, &expected1.iStartIndex);
+		primaryLines.GetLineIndexOfPosition(spans[index].end1, &expected1.iEndLine, &expected1.iEndIndex);
+		secondaryLines.GetLineIndexOfPosition(spans[index].start2, &expected2.iStartLine, &expected2.iStartIndex);
+		secondaryLines.GetLineIndexOfPosition(spans[index].end2, &expected2.iEndLine, &expected2.iEndIndex);
+
+		const TextSpanPair& actual = target.mappings[index].tspSpans;
+		if (memcmp(&actual.span1, &expected1, sizeof(TextSpan)) != 0 ||
+			memcmp(&actual.span2, &expected2, sizeof(TextSpan)) != 0)
+		{
+			printf("  mapping %d: secondary %ld,%ld-%ld,%ld expected %ld,%ld-%ld,%ld\n", (int)index,
+				actual.span2.iStartLine, actual.span2.iStartIndex, actual.span2.iEndLine, actual.span2.iEndIndex,
+				expected2.iStartLine, expected2.iStartIndex, expected2.iEndLine, expected2.iEndIndex);
+			return false;
+		}
+	}
+	return true;
+}
+
+// generated code gaining lines ahead of every mapping moves them all down
+TEST(MappingsFollowTheNewSecondaryLines)
+{
+	SecondaryTextFixture fixture(100);
+	fixture.Apply();
+	CHECK(MappingsMatch(fixture.target, fixture.view.GetPrimary(), fixture.view.GetSecondary(), fixture.view.GetMappings()));
+
+	CStringW secondary(L"using System;\r\nusing System.Linq;\r\n");
+	secondary.Append(fixture.view.GetSecondary());
+	PooledArray<SourceMapping> spans;
+	for (size_t index = 0; index != fixture.view.GetMappings().GetCount(); ++index)
+	{
+		SourceMapping span = fixture.view.GetMappings()[index];
+		span.start2 += 34;
+		span.end2 += 34;
+		spans.Add(span);
+	}
+
+	const CStringW& primary = fixture.view.GetPrimary();
+	fixture.primaryLines.Build(primary, primary.GetLength());
+	CHECK_EQUAL(S_OK, SecondaryText::Apply(
+		&fixture.target, fixture.primaryLines, 
+		secondary, secondary.GetLength(), 
+		spans.GetData(), (long)spans.GetCount(), 
+		fixture.mappingTable, fixture.buffers));
+	CHECK(fixture.target.Equals(secondary, secondary.GetLength()));
+	CHECK(MappingsMatch(fixture.target, primary, secondary, spans));
+}
+
+static long GetFirstMappedLine(const MemoryTextTarget& target)
+{
+	long iFirstLine = -1;
+	for (size_t index = 0; index != target.mappings.GetCount(); ++index)
+	{
+		long iLine = target.mappings[index].tspSpans.span1.iStartLine;
+		if (iFirstLine == -1 || iLine < iFirstLine)
+			iFirstLine = iLine;
+	}
+	return iFirstLine;
+}
+
+TEST(RecolorsFromTheFirstMappedLine)
+{
+	SecondaryTextFixture fixture(200);
+	fixture.Apply();
+	long iFirstLine = GetFirstMappedLine(fixture.target);
+	CHECK(iFirstLine != -1);
+	CHECK_EQUAL(iFirstLine, fixture.buffers.recolorFirstLine);
+}
+
+TEST(UnchangedGenerationRecolorsNothing)
+{
+	SecondaryTextFixture fixture(50);
+	fixture.Apply();
+	CHECK_EQUAL(S_OK, fixture.Apply());
+	CHECK_EQUAL(-1, fixture.buffers.recolorFirstLine);
+	CHECK_EQUAL(0, fixture.target.setMappingsCalls);
+}
+
+// an expression replaced by another colors differently, even where its mapping doesn't move
+TEST(RecolorsFromTheEditedExpression)
+{
+	SecondaryTextFixture fixture(200);
+	fixture.Apply();
+	for (long pass = 0; pass != 20; ++pass)
+	{
+		long iEditedLine = fixture.view.EditExpression();
+		CHECK_EQUAL(S_OK, fixture.Apply());
+		CHECK(fixture.buffers.recolorFirstLine != -1);
+		CHECK(fixture.buffers.recolorFirstLine <= iEditedLine);
+	}
+}
+
+// lines moved by an edit above the mappings, with the generated code the same - the 
+// coordinator's mappings moved with the edit, but the table's rows have to follow
+TEST(MappingsMovedWithoutNewCodeRecolorFromTheMove)
+{
+	SecondaryTextFixture fixture(100);
+	fixture.Apply();
+
+	const CStringW& secondary = fixture.view.GetSecondary();
+	CStringW primary(L"<!-- added -->\r\n");
+	primary.Append(fixture.view.GetPrimary());
+	PooledArray<SourceMapping> spans;
+	for (size_t index = 0; index != fixture.view.GetMappings().GetCount(); ++index)
+	{
+		SourceMapping span = fixture.view.GetMappings()[index];
+		span.start1 += 16;
+		span.end1 += 16;
+		spans.Add(span);
+	}
+
+	fixture.target.ResetCounts();
+	fixture.primaryLines.Build(primary, primary.GetLength());
+	CHECK_EQUAL(S_OK, SecondaryText::Apply(
+		&fixture.target, fixture.primaryLines, 
+		secondary, secondary.GetLength(), 
+		spans.GetData(), (long)spans.GetCount(), 
+		fixture.mappingTable, fixture.buffers));
+	CHECK_EQUAL(0, fixture.target.replaceCalls);
+	CHECK_EQUAL(1, fixture.target.setMappingsCalls);
+	CHECK(MappingsMatch(fixture.target, primary, secondary, spans));
+
+	// where the first mapping was before the added line pushed it down
+	CHECK_EQUAL(GetFirstMappedLine(fixture.target) - 1, fixture.buffers.recolorFirstLine);
+}
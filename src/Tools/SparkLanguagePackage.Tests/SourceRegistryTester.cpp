@@ -0,0 +1,342 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "SourceRegistry.h"
+
+static volatile LONG s_liveObjects = 0;
+
+// a buffer key or a source - counts its references, and how many are alive
+class TestObject : public IUnknown
+{
+	volatile LONG _references;
+
+public:
+	Diagnostics diagnostics;
+	volatile LONG discarded;
+	volatile LONG closed;
+
+	TestObject() : _references(1), discarded(0), closed(0)
+	{
+		InterlockedIncrement(&s_liveObjects);
+	}
+
+	virtual ~TestObject()
+	{
+		InterlockedDecrement(&s_liveObjects);
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** ppv)
+	{
+		*ppv = NULL;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef()
+	{
+		return InterlockedIncrement(&_references);
+	}
+
+	ULONG STDMETHODCALLTYPE Release()
+	{
+		LONG references = InterlockedDecrement(&_references);
+		if (references == 0)
+			delete this;
+		return references;
+	}
+};
+
+static TestObject* AsTestObject(IUnknown* pObject)
+{
+	return static_cast<TestObject*>(pObject);
+}
+
+// makes a source, calling back into the registry while it does - as Source's creation 
+// and the supervisor's OnSourceAssociated may - when given a registry to call
+class TestFactory : public SourceFactory
+{
+	SourceRegistry* _reentered;
+	IUnknown* _otherKey;
+
+public:
+	volatile LONG created;
+	volatile LONG discards;
+
+	TestFactory(SourceRegistry* pReentered, IUnknown* pOtherKey) : 
+		_reentered(pReentered), _otherKey(pOtherKey), created(0), discards(0)
+	{
+	}
+
+	HRESULT CreateSource(IUnknown* pKey, IUnknown** ppSource, Diagnostics** ppDiagnostics)
+	{
+		if (_reentered != NULL)
+		{
+			CComPtr<IUnknown> existing;
+			_reentered->Lookup(pKey, &existing);
+
+			Diagnostics::Block block;
+			_reentered->ReadDiagnostics(block);
+
+			if (_otherKey != NULL)
+			{
+				TestFactory plain(NULL, NULL);
+				CComPtr<IUnknown> other;
+				_reentered->GetOrCreate(_otherKey, &plain, &other);
+			}
+		}
+
+		TestObject* source = new TestObject();
+		InterlockedIncrement(&created);
+		*ppSource = source;
+		*ppDiagnostics = &source->diagnostics;
+		return S_OK;
+	}
+
+	void DiscardSource(IUnknown* pSource)
+	{
+		InterlockedIncrement(&discards);
+		InterlockedExchange(&AsTestObject(pSource)->discarded, 1);
+	}
+};
+
+// made for the same key from inside its own creation, so the outer one loses the race
+class RacingFactory : public TestFactory
+{
+	SourceRegistry& _registry;
+
+public:
+	IUnknown* winner;
+
+	RacingFactory(SourceRegistry& registry) : TestFactory(NULL, NULL), _registry(registry), winner(NULL)
+	{
+	}
+
+	HRESULT CreateSource(IUnknown* pKey, IUnknown** ppSource, Diagnostics** ppDiagnostics)
+	{
+		TestFactory plain(NULL, NULL);
+		CComPtr<IUnknown> first;
+		_registry.GetOrCreate(pKey, &plain, &first);
+		winner = first;
+		return TestFactory::CreateSource(pKey, ppSource, ppDiagnostics);
+	}
+};
+
+TEST(OneSourcePerKey)
+{
+	{
+		SourceRegistry registry;
+		CComPtr<IUnknown> key;
+		key.Attach(new TestObject());
+		TestFactory factory(NULL, NULL);
+
+		CComPtr<IUnknown> first;
+		CComPtr<IUnknown> second;
+		CHECK_EQUAL(S_OK, registry.GetOrCreate(key, &factory, &first));
+		CHECK_EQUAL(S_OK, registry.GetOrCreate(key, &factory, &second));
+		CHECK(first == second);
+		CHECK_EQUAL(1, factory.created);
+
+		CComPtr<IUnknown> found;
+		CHECK_EQUAL(S_OK, registry.Lookup(key, &found));
+		CHECK(found == first);
+
+		CComPtr<IUnknown> removed;
+		CHECK_EQUAL(S_OK, registry.Remove(key, &removed));
+		CHECK(removed == first);
+		CComPtr<IUnknown> missing;
+		CHECK_EQUAL(S_FALSE, registry.Lookup(key, &missing));
+		CHECK(missing == NULL);
+		CComPtr<IUnknown> removedAgain;
+		CHECK_EQUAL(S_FALSE, registry.Remove(key, &removedAgain));
+	}
+	CHECK_EQUAL(0, s_liveObjects);
+}
+
+TEST(CreationMayCallBackIntoTheRegistry)
+{
+	{
+		SourceRegistry registry;
+		CComPtr<IUnknown> key;
+		key.Attach(new TestObject());
+		CComPtr<IUnknown> otherKey;
+		otherKey.Attach(new TestObject());
+		TestFactory factory(&registry, otherKey);
+
+		CComPtr<IUnknown> source;
+		CHECK_EQUAL(S_OK, registry.GetOrCreate(key, &factory, &source));
+		CComPtr<IUnknown> other;
+		CHECK_EQUAL(S_OK, registry.Lookup(otherKey, &other));
+
+		CInterfaceArray<IUnknown> sources;
+		registry.GetSources(sources);
+		CHECK_EQUAL(2, sources.GetCount());
+	}
+	CHECK_EQUAL(0, s_liveObjects);
+}
+
+TEST(LoserOfARaceIsDiscarded)
+{
+	{
+		SourceRegistry registry;
+		CComPtr<IUnknown> key;
+		key.Attach(new TestObject());
+		RacingFactory factory(registry);
+
+		CComPtr<IUnknown> source;
+		CHECK_EQUAL(S_OK, registry.GetOrCreate(key, &factory, &source));
+		CHECK(source == factory.winner);
+		CHECK_EQUAL(1, factory.discards);
+		CHECK_EQUAL(0, AsTestObject(source)->discarded);
+	}
+	CHECK_EQUAL(0, s_liveObjects);
+}
+
+TEST(FiguresOfRemovedSourcesStayInTheTotals)
+{
+	SourceRegistry registry;
+	CComPtr<IUnknown> key;
+	key.Attach(new TestObject());
+	TestFactory factory(NULL, NULL);
+
+	CComPtr<IUnknown> source;
+	registry.GetOrCreate(key, &factory, &source);
+	AsTestObject(source)->diagnostics.Add(SparkCounterRegenerations, 4);
+
+	CComPtr<IUnknown> removed;
+	registry.Remove(key, &removed);
+	CComPtr<IUnknown> replacement;
+	registry.GetOrCreate(key, &factory, &replacement);
+	AsTestObject(replacement)->diagnostics.Add(SparkCounterRegenerations, 1);
+
+	Diagnostics::Block block;
+	registry.ReadDiagnostics(block);
+	CHECK_EQUAL(5, block.counters[SparkCounterRegenerations]);
+
+	registry.ResetDiagnostics();
+	registry.ReadDiagnostics(block);
+	CHECK_EQUAL(0, block.counters[SparkCounterRegenerations]);
+
+	CInterfaceArray<IUnknown> sources;
+	registry.RemoveAll(sources);
+	CHECK_EQUAL(1, sources.GetCount());
+	CHECK(sources[0] == replacement);
+}
+
+struct StressArguments
+{
+	SourceRegistry* registry;
+	IUnknown** rgKeys;
+	long cKeys;
+	long cRounds;
+	ULONG seed;
+	LONGLONG adds;
+	bool fHandedOutDiscarded;
+	bool fHandedOutClosed;
+};
+
+// documents opened, closed and read at random - as views open, the running document
+// table unlocks and diagnostics are read, all on different threads
+static void* OpenAndCloseDocuments(void* pArguments)
+{
+	StressArguments& arguments = *(StressArguments*)pArguments;
+	SourceRegistry& registry = *arguments.registry;
+	ULONG seed = arguments.seed;
+
+	for (long round = 0; round != arguments.cRounds; ++round)
+	{
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		IUnknown* key = arguments.rgKeys[seed % arguments.cKeys];
+		IUnknown* otherKey = arguments.rgKeys[(seed >> 8) % arguments.cKeys];
+
+		switch ((seed >> 20) % 8)
+		{
+		case 0:
+		case 1:
+		case 2:
+			{
+				TestFactory factory(&registry, (seed & 0x100) ? otherKey : NULL);
+				CComPtr<IUnknown> source;
+				registry.GetOrCreate(key, &factory, &source);
+				if (AsTestObject(source)->discarded)
+					arguments.fHandedOutDiscarded = true;
+				if (AsTestObject(source)->closed)
+					arguments.fHandedOutClosed = true;
+				AsTestObject(source)->diagnostics.Add(SparkCounterRegenerations, 1);
+				++arguments.adds;
+			}
+			break;
+		case 3:
+		case 4:
+			{
+				CComPtr<IUnknown> source;
+				if (registry.Remove(key, &source) == S_OK)
+					InterlockedExchange(&AsTestObject(source)->closed, 1);
+			}
+			break;
+		case 5:
+			{
+				CComPtr<IUnknown> source;
+				registry.Lookup(key, &source);
+			}
+			break;
+		case 6:
+			{
+				Diagnostics::Block block;
+				registry.ReadDiagnostics(block);
+			}
+			break;
+		case 7:
+			{
+				CInterfaceArray<IUnknown> sources;
+				registry.GetSources(sources);
+			}
+			break;
+		}
+	}
+	return NULL;
+}
+
+TEST(HundredsOfDocumentsOpenAndCloseAtOnce)
+{
+	const long cKeys = 300;
+	const long cThreads = 8;
+	IUnknown* rgKeys[cKeys];
+	for (long index = 0; index != cKeys; ++index)
+		rgKeys[index] = new TestObject();
+
+	{
+		SourceRegistry registry;
+		StressArguments arguments[cThreads];
+		pthread_t threads[cThreads];
+		for (long thread = 0; thread != cThreads; ++thread)
+		{
+			StressArguments initial = {&registry, rgKeys, cKeys, 10000, 0x5EED + 977 * (ULONG)thread, 0, false, false};
+			arguments[thread] = initial;
+			pthread_create(&threads[thread], NULL, OpenAndCloseDocuments, &arguments[thread]);
+		}
+
+		LONGLONG adds = 0;
+		for (long thread = 0; thread != cThreads; ++thread)
+		{
+			pthread_join(threads[thread], NULL);
+			adds += arguments[thread].adds;
+			CHECK(!arguments[thread].fHandedOutDiscarded);
+		}
+
+		// a source may be closed by one thread just after another was handed it, and 
+		// its later figures go with it - so the totals can only fall short
+		Diagnostics::Block block;
+		registry.ReadDiagnostics(block);
+		CHECK(block.counters[SparkCounterRegenerations] > 0);
+		CHECK(block.counters[SparkCounterRegenerations] <= adds);
+
+		CInterfaceArray<IUnknown> sources;
+		registry.RemoveAll(sources);
+		for (size_t index = 0; index != sources.GetCount(); ++index)
+			CHECK(!AsTestObject(sources[index])->discarded && !AsTestObject(sources[index])->closed);
+	}
+
+	for (long index = 0; index != cKeys; ++index)
+		rgKeys[index]->Release();
+	CHECK_EQUAL(0, s_liveObjects);
+}
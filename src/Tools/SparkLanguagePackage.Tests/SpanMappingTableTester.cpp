@@ -0,0 +1,98 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "SpanMappingTable.h"
+
+static NewSpanMapping Mapping(long iStartLine, long iStartIndex, long iEndLine, long iEndIndex)
+{
+	NewSpanMapping mapping;
+	ZeroMemory(&mapping, sizeof(mapping));
+	mapping.tspSpans.span1.iStartLine = iStartLine;
+	mapping.tspSpans.span1.iStartIndex = iStartIndex;
+	mapping.tspSpans.span1.iEndLine = iEndLine;
+	mapping.tspSpans.span1.iEndIndex = iEndIndex;
+	return mapping;
+}
+
+TEST(MappingsSpanningLinesContinueToTheEnd)
+{
+	NewSpanMapping rgMappings[] = {Mapping(1, 4, 3, 2)};
+	SpanMappingTable table;
+	table.Build(rgMappings, 1);
+
+	long cFragments = 0;
+	CHECK(table.GetLine(0, &cFragments) == NULL);
+	CHECK_EQUAL(0, cFragments);
+
+	const SpanMappingTable::Fragment* rgFragments = table.GetLine(1, &cFragments);
+	CHECK_EQUAL(1, cFragments);
+	CHECK_EQUAL(4, rgFragments[0].iStartIndex);
+	CHECK_EQUAL(-1, rgFragments[0].iEndIndex);
+
+	rgFragments = table.GetLine(2, &cFragments);
+	CHECK_EQUAL(1, cFragments);
+	CHECK_EQUAL(0, rgFragments[0].iStartIndex);
+	CHECK_EQUAL(-1, rgFragments[0].iEndIndex);
+
+	rgFragments = table.GetLine(3, &cFragments);
+	CHECK_EQUAL(1, cFragments);
+	CHECK_EQUAL(0, rgFragments[0].iStartIndex);
+	CHECK_EQUAL(2, rgFragments[0].iEndIndex);
+
+	CHECK(table.GetLine(4, &cFragments) == NULL);
+	CHECK(table.GetLine(-1, &cFragments) == NULL);
+}
+
+TEST(TouchingFragmentsMergeIntoOneRun)
+{
+	NewSpanMapping rgMappings[] = {Mapping(0, 10, 0, 14), Mapping(0, 2, 0, 6), Mapping(0, 6, 0, 8), Mapping(0, 12, 0, 20)};
+	SpanMappingTable table;
+	table.Build(rgMappings, 4);
+
+	long cFragments = 0;
+	const SpanMappingTable::Fragment* rgFragments = table.GetLine(0, &cFragments);
+	CHECK_EQUAL(2, cFragments);
+	CHECK_EQUAL(2, rgFragments[0].iStartIndex);
+	CHECK_EQUAL(8, rgFragments[0].iEndIndex);
+	CHECK_EQUAL(10, rgFragments[1].iStartIndex);
+	CHECK_EQUAL(20, rgFragments[1].iEndIndex);
+}
+
+TEST(ClampKeepsFragmentsToTheLine)
+{
+	SpanMappingTable::Fragment fragment;
+	long iStart = 0;
+	long iEnd = 0;
+
+	fragment.iStartIndex = 3;
+	fragment.iEndIndex = 7;
+	CHECK(SpanMappingTable::ClampToLine(fragment, 10, &iStart, &iEnd));
+	CHECK_EQUAL(3, iStart);
+	CHECK_EQUAL(7, iEnd);
+
+	// continuing past the line, and a line an edit has shortened since the table was built
+	fragment.iEndIndex = -1;
+	CHECK(SpanMappingTable::ClampToLine(fragment, 10, &iStart, &iEnd));
+	CHECK_EQUAL(10, iEnd);
+
+	fragment.iEndIndex = 40;
+	CHECK(SpanMappingTable::ClampToLine(fragment, 5, &iStart, &iEnd));
+	CHECK_EQUAL(3, iStart);
+	CHECK_EQUAL(5, iEnd);
+
+	// nothing left of it on the line
+	fragment.iStartIndex = 12;
+	CHECK(!SpanMappingTable::ClampToLine(fragment, 5, &iStart, &iEnd));
+	fragment.iStartIndex = 5;
+	CHECK(!SpanMappingTable::ClampToLine(fragment, 5, &iStart, &iEnd));
+	fragment.iStartIndex = 0;
+	CHECK(!SpanMappingTable::ClampToLine(fragment, 0, &iStart, &iEnd));
+
+	// inverted, and starting before the line
+	fragment.iStartIndex = 6;
+	fragment.iEndIndex = 4;
+	CHECK(!SpanMappingTable::ClampToLine(fragment, 10, &iStart, &iEnd));
+	fragment.iStartIndex = -3;
+	CHECK(SpanMappingTable::ClampToLine(fragment, 10, &iStart, &iEnd));
+	CHECK_EQUAL(0, iStart);
+	CHECK_EQUAL(4, iEnd);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// The types of SparkLanguagePackage.idl the portable classes use, as MIDL would declare 
+// them. Keep in step with the idl - the interfaces themselves aren't needed here.
+
+typedef struct _SOURCEMAPPING
+{
+	long start1;
+	long end1;
+	long start2;
+	long end2;
+} SourceMapping;
+
+typedef struct _SOURCEPAINTING
+{
+	long start;
+	long end;
+	int color;
+} SourcePainting;
+
+typedef struct _GENERATEDTEXTEDIT
+{
+	long start;
+	long end;
+	long insertStart;
+	long insertEnd;
+} GeneratedTextEdit;
+
+typedef struct _SOURCEDELTAOP
+{
+	long index;
+	long cRemove;
+	long cInsert;
+	long shift1;
+	long shift2;
+} SourceDeltaOp;
+
+typedef enum _SPARKCOUNTER
+{
+	SparkCounterRegenerations,
+	SparkCounterCoalescedRegenerations,
+	SparkCounterCancelledRegenerations,
+	SparkCounterMappingCount,
+	SparkCounterBytesCopied,
+	SparkCounterDeferredRegenerations,
+	SparkCounterMaximum
+} SparkCounter;
+
+typedef enum _SPARKTIMING
+{
+	SparkTimingEnsureSecondaryBufferReady,
+	SparkTimingOnGenerated,
+	SparkTimingBeginColorization,
+	SparkTimingColorizePass,
+	SparkTimingMaximum
+} SparkTiming;
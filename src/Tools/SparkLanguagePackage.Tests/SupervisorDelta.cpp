@@ -0,0 +1,41 @@
+#include "stdafx.h"
+#include "SupervisorDelta.h"
+#include "TextDiff.h"
+
+static bool SameShifted(const SourceMapping& a, const SourceMapping& b, long shift1, long shift2)
+{
+	return a.start1 + shift1 == b.start1 && a.end1 + shift1 == b.end1 && 
+		a.start2 + shift2 == b.start2 && a.end2 + shift2 == b.end2;
+}
+
+void MakeSupervisorDelta(
+	const WCHAR* pPrevious, long cchPrevious, const PooledArray<SourceMapping>& previousMappings, long previousPrimaryLength,
+	const WCHAR* pCurrent, long cchCurrent, const PooledArray<SourceMapping>& currentMappings, long currentPrimaryLength,
+	SupervisorDelta& delta)
+{
+	long shorter = std::min(cchPrevious, cchCurrent);
+	long prefix = (long)TextDiff::CommonPrefix(pPrevious, pCurrent, shorter);
+	long suffix = (long)TextDiff::CommonSuffix(pPrevious + cchPrevious, pCurrent + cchCurrent, shorter - prefix);
+	delta.inserted.SetString(pCurrent + prefix, cchCurrent - prefix - suffix);
+	GeneratedTextEdit edit = {prefix, cchPrevious - suffix, 0, delta.inserted.GetLength()};
+	delta.edit = edit;
+
+	// mappings before the change are untouched, mappings after it are only moved
+	long shift1 = currentPrimaryLength - previousPrimaryLength;
+	long shift2 = cchCurrent - cchPrevious;
+	long cPrevious = (long)previousMappings.GetCount();
+	long cCurrent = (long)currentMappings.GetCount();
+	long first = 0;
+	while (first != cPrevious && first != cCurrent && SameShifted(previousMappings[first], currentMappings[first], 0, 0))
+		++first;
+	long last = 0;
+	while (last != cPrevious - first && last != cCurrent - first && 
+		SameShifted(previousMappings[cPrevious - last - 1], currentMappings[cCurrent - last - 1], shift1, shift2))
+		++last;
+
+	SourceDeltaOp op = {first, cPrevious - first - last, cCurrent - first - last, shift1, shift2};
+	delta.op = op;
+	delta.mappings.SetCount(op.cInsert);
+	for (long index = 0; index != op.cInsert; ++index)
+		delta.mappings[index] = currentMappings[first + index];
+}
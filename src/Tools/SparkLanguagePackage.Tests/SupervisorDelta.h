@@ -0,0 +1,20 @@
+#pragma once
+
+#include "SparkLanguagePackage_i.h"
+#include "PooledArray.h"
+
+// The delta SourceSupervisor.SendDelta sends for a generation - the generated code between 
+// its common prefix and suffix as one edit, and the mappings between theirs as one op, 
+// found the way DiffItems finds them
+struct SupervisorDelta
+{
+	GeneratedTextEdit edit;
+	CStringW inserted;
+	SourceDeltaOp op;
+	PooledArray<SourceMapping> mappings;
+};
+
+void MakeSupervisorDelta(
+	const WCHAR* pPrevious, long cchPrevious, const PooledArray<SourceMapping>& previousMappings, long previousPrimaryLength,
+	const WCHAR* pCurrent, long cchCurrent, const PooledArray<SourceMapping>& currentMappings, long currentPrimaryLength,
+	SupervisorDelta& delta);
@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "SyntheticView.h"
+
+// each kind of line in the view, and the C# it generates - $ marks the expression
+static const WCHAR* s_markup[] =
+{
+	L"<div class=\"row ${$}\">",
+	L"  <p class=\"name\">${$}</p>",
+	L"# var total = $;",
+	L"<for each=\"var item in $\">",
+	L"  <!-- shown for each product in the list -->",
+	L"  <span if=\"$\">Active &amp; ready</span>",
+	L"  plain text with a few words in it",
+	L"</for>",
+	L"  <a href=\"${Url.Action(\"Details\", $)}\">Details</a>",
+	L"<viewdata model=\"$\"/>",
+	L"</div>",
+	L"<use content=\"main\"/>",
+};
+
+static const WCHAR* s_generated[] =
+{
+	L"Output.Write(\"<div class=\\\"row \"); Output.Write($); Output.Write(\"\\\">\");",
+	L"Output.Write(\"  <p class=\\\"name\\\">\"); Output.Write($); Output.Write(\"</p>\");",
+	L"var total = $;",
+	L"foreach (var item in $) {",
+	L"Output.Write(\"  <!-- shown for each product in the list -->\");",
+	L"if ($) { Output.Write(\"<span>Active &amp; ready</span>\"); }",
+	L"Output.Write(\"  plain text with a few words in it\");",
+	L"}",
+	L"Output.Write(\"  <a href=\\\"\"); Output.Write(Url.Action(\"Details\", $)); Output.Write(\"\\\">Details</a>\");",
+	L"ViewData.Model = ($)null;",
+	L"Output.Write(\"</div>\");",
+	L"Output.Write(Content[\"main\"]);",
+};
+
+static const WCHAR* s_expressions[] =
+{
+	L"item.Name",
+	L"Model.Items",
+	L"item.Id",
+	L"rowClass",
+	L"H(item.Title)",
+	L"item.IsActive && item.Price > 10",
+	L"ProductList",
+	L"new { id = item.Id }",
+};
+
+static bool HasExpression(const WCHAR* pattern)
+{
+	for (const WCHAR* pch = pattern; *pch != 0; ++pch)
+	{
+		if (*pch == L'$' && pch[1] != L'{')
+			return true;
+	}
+	return false;
+}
+
+ULONG SyntheticView::Random()
+{
+	_seed ^= _seed << 13;
+	_seed ^= _seed >> 17;
+	_seed ^= _seed << 5;
+	return _seed;
+}
+
+void SyntheticView::Build(long cLines, ULONG seed)
+{
+	_seed = seed == 0 ? 1 : seed;
+	_lines.SetCount(cLines);
+	for (long iLine = 0; iLine != cLines; ++iLine)
+	{
+		_lines[iLine].kind = Random() % _countof(s_markup);
+		_lines[iLine].expression = Random() % _countof(s_expressions);
+	}
+	Generate();
+}
+
+long SyntheticView::EditExpression()
+{
+	for (;;)
+	{
+		long iLine = Random() % GetLineCount();
+		if (!HasExpression(s_markup[_lines[iLine].kind]))
+			continue;
+
+		long expression = _lines[iLine].expression;
+		while (_lines[iLine].expression == expression)
+			_lines[iLine].expression = Random() % _countof(s_expressions);
+		Generate();
+		return iLine;
+	}
+}
+
+// appends pattern with the expression in place of the first $ not part of "${", and 
+// returns the offset the expression went to, or -1
+static long Expand(CStringW& text, const WCHAR* pattern, const WCHAR* expression)
+{
+	long iExpression = -1;
+	for (const WCHAR* pch = pattern; *pch != 0; ++pch)
+	{
+		if (*pch != L'$' || pch[1] == L'{')
+		{
+			text.AppendChar(*pch);
+			continue;
+		}
+		iExpression = text.GetLength();
+		text.Append(expression);
+	}
+	return iExpression;
+}
+
+void SyntheticView::Generate()
+{
+	_primary.Empty();
+	_secondary.Empty();
+	_mappings.RemoveAll();
+
+	_secondary.Append(L"public class View : SparkView\r\n{\r\n  public override void RenderView(TextWriter writer)\r\n  {\r\n");
+	for (size_t iLine = 0; iLine != _lines.GetCount(); ++iLine)
+	{
+		const WCHAR* expression = s_expressions[_lines[iLine].expression];
+		long cchExpression = (long)wcslen(expression);
+
+		long start1 = Expand(_primary, s_markup[_lines[iLine].kind], expression);
+		long start2 = Expand(_secondary, s_generated[_lines[iLine].kind], expression);
+		if (start1 != -1)
+		{
+			SourceMapping mapping = {start1, start1 + cchExpression, start2, start2 + cchExpression};
+			_mappings.Add(mapping);
+		}
+
+		_primary.Append(L"\r\n");
+		_secondary.Append(L"\r\n");
+	}
+	_secondary.Append(L"  }\r\n}\r\n");
+}
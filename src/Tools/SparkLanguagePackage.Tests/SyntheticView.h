@@ -0,0 +1,42 @@
+#pragma once
+
+#include "SparkLanguagePackage_i.h"
+#include "PooledArray.h"
+
+// A made-up .spark view of any size, with the C# and span mappings a supervisor would 
+// generate for it. Lines are drawn from a mix of markup, code and expressions close to 
+// what the Samples hold - about one mapping for every other line.
+class SyntheticView
+{
+	struct Line
+	{
+		long kind;
+		long expression;
+	};
+
+	PooledArray<Line> _lines;
+	ULONG _seed;
+	CStringW _primary;
+	CStringW _secondary;
+	PooledArray<SourceMapping> _mappings;
+
+public:
+	SyntheticView() : _seed(1)
+	{
+	}
+
+	void Build(long cLines, ULONG seed);
+
+	// replaces the expression of one line with another, and generates again. returns the line
+	long EditExpression();
+
+	long GetLineCount() const {return (long)_lines.GetCount();}
+	const CStringW& GetPrimary() const {return _primary;}
+	const CStringW& GetSecondary() const {return _secondary;}
+	const PooledArray<SourceMapping>& GetMappings() const {return _mappings;}
+
+	ULONG Random();
+
+private:
+	void Generate();
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+// Just enough of a test framework for the portable testers. Each *Tester.cpp is its
+// own executable, linked with TestMain.cpp, and defines its cases with TEST. A failed
+// CHECK is reported and the case goes on; the executable fails if any check did.
+//
+//   TEST(EmptyTextHasOneLine)
+//   {
+//       LineTable lines;
+//       lines.Build(L"", 0);
+//       CHECK_EQUAL(1, lines.GetLineCount());
+//   }
+
+typedef void (*TestFunction)();
+
+class TestRegistration
+{
+public:
+	TestRegistration(const char* name, TestFunction function);
+};
+
+void TestFailed(const char* file, int line, const char* expression);
+void TestFailedEqual(const char* file, int line, const char* expression, LONGLONG expected, LONGLONG actual);
+
+#define TEST(name) \
+	static void Test_##name(); \
+	static TestRegistration TestRegistration_##name(#name, Test_##name); \
+	static void Test_##name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) TestFailed(__FILE__, __LINE__, #expression); } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { \
+		LONGLONG checkExpected = (LONGLONG)(expected); \
+		LONGLONG checkActual = (LONGLONG)(actual); \
+		if (checkExpected != checkActual) \
+			TestFailedEqual(__FILE__, __LINE__, #actual, checkExpected, checkActual); \
+	} while (0)
@@ -0,0 +1,61 @@
+#include "stdafx.h"
+#include "Test.h"
+
+struct TestCase
+{
+	const char* name;
+	TestFunction function;
+};
+
+// filled by the static TestRegistrations, before main runs
+static TestCase* s_rgCases;
+static long s_cCases;
+static long s_cFailures;
+
+TestRegistration::TestRegistration(const char* name, TestFunction function)
+{
+	s_rgCases = (TestCase*)realloc(s_rgCases, (s_cCases + 1) * sizeof(TestCase));
+	s_rgCases[s_cCases].name = name;
+	s_rgCases[s_cCases].function = function;
+	++s_cCases;
+}
+
+void TestFailed(const char* file, int line, const char* expression)
+{
+	fprintf(stderr, "%s(%d): CHECK(%s) failed\n", file, line, expression);
+	++s_cFailures;
+}
+
+void TestFailedEqual(const char* file, int line, const char* expression, LONGLONG expected, LONGLONG actual)
+{
+	fprintf(stderr, "%s(%d): %s was %lld, expected %lld\n", file, line, expression, (long long)actual, (long long)expected);
+	++s_cFailures;
+}
+
+// Runs every case, or those whose names are given
+int main(int argc, char* argv[])
+{
+	long cRun = 0;
+	long cFailedCases = 0;
+	for (long index = 0; index != s_cCases; ++index)
+	{
+		const TestCase& test = s_rgCases[index];
+		bool fSelected = argc == 1;
+		for (int arg = 1; arg < argc; ++arg)
+			fSelected = fSelected || strcmp(argv[arg], test.name) == 0;
+		if (!fSelected)
+			continue;
+
+		long cFailuresBefore = s_cFailures;
+		test.function();
+		++cRun;
+		if (s_cFailures != cFailuresBefore)
+		{
+			fprintf(stderr, "FAILED %s\n", test.name);
+			++cFailedCases;
+		}
+	}
+
+	printf("%ld cases, %ld failed\n", cRun, cFailedCases);
+	return cFailedCases == 0 && cRun != 0 ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+#include "stdafx.h"
+#include "Test.h"
+#include "TextDiff.h"
+
+static ULONG s_seed = 0x7E47;
+
+static ULONG Random()
+{
+	s_seed ^= s_seed << 13;
+	s_seed ^= s_seed >> 17;
+	s_seed ^= s_seed << 5;
+	return s_seed;
+}
+
+// lines drawn from a small set, so the same line turns up in many places and a diff 
+// has more than one way to match them. each kind of line break is among them
+static const WCHAR* s_lines[] =
+{
+	L"{\r\n",
+	L"}\r\n",
+	L"Output.Write(item.Name);\r\n",
+	L"\r\n",
+	L"var total = 0;\n",
+	L"if (x) {\r",
+	L"text\x2028",
+};
+
+static void AppendRandomLines(CStringW& text, long cLines)
+{
+	for (long iLine = 0; iLine != cLines; ++iLine)
+		text.Append(s_lines[Random() % _countof(s_lines)]);
+}
+
+static void AppendNumberedLines(CStringW& text, long iFirst, long cLines, const WCHAR* prefix)
+{
+	for (long iLine = iFirst; iLine != iFirst + cLines; ++iLine)
+		text.AppendFormat(L"%s line %d\r\n", prefix, iLine);
+}
+
+static void GetLine(const CStringW& text, const LineTable& lines, long iLine, CStringW& line)
+{
+	long iStart = lines.GetLineStart(iLine);
+	line.SetString((const WCHAR*)text + iStart, lines.GetLineStart(iLine + 1) - iStart);
+}
+
+// the old text with each hunk's lines replaced by the new text's - what the secondary 
+// buffer ends up holding
+static void ApplyHunks(
+	const CStringW& oldText, const LineTable& oldLines, 
+	const CStringW& newText, const LineTable& newLines, 
+	const PooledArray<TextHunk>& hunks, CStringW& result)
+{
+	result.Empty();
+	CStringW line;
+	long iOld = 0;
+	for (size_t index = 0; index != hunks.GetCount(); ++index)
+	{
+		const TextHunk& hunk = hunks[index];
+		for (; iOld < hunk.iOldFirst; ++iOld)
+			GetLine(oldText, oldLines, iOld, line), result.Append(line);
+		for (long iNew = hunk.iNewFirst; iNew < hunk.iNewEnd; ++iNew)
+			GetLine(newText, newLines, iNew, line), result.Append(line);
+		iOld = hunk.iOldEnd;
+	}
+	for (; iOld < oldLines.GetLineCount(); ++iOld)
+		GetLine(oldText, oldLines, iOld, line), result.Append(line);
+}
+
+static bool SameText(const CStringW& text1, const CStringW& text2)
+{
+	return text1.GetLength() == text2.GetLength() && 
+		memcmp((const WCHAR*)text1, (const WCHAR*)text2, text1.GetLength() * sizeof(WCHAR)) == 0;
+}
+
+// diffs the texts and checks the hunks are in order, each changes something, and 
+// together they turn the old text into the new
+static void CheckDiff(const CStringW& oldText, const CStringW& newText, PooledArray<TextHunk>& hunks)
+{
+	LineTable oldLines;
+	oldLines.Build(oldText, oldText.GetLength());
+	LineTable newLines;
+	newLines.Build(newText, newText.GetLength());
+
+	TextDiff::DiffLines(oldText, oldLines, newText, newLines, hunks);
+
+	long iOldEnd = 0;
+	long iNewEnd = 0;
+	for (size_t index = 0; index != hunks.GetCount(); ++index)
+	{
+		const TextHunk& hunk = hunks[index];
+		CHECK(hunk.iOldFirst >= iOldEnd && hunk.iNewFirst >= iNewEnd);
+		CHECK(hunk.iOldFirst - iOldEnd == hunk.iNewFirst - iNewEnd);
+		CHECK(hunk.iOldFirst <= hunk.iOldEnd && hunk.iNewFirst <= hunk.iNewEnd);
+		CHECK(hunk.iOldFirst != hunk.iOldEnd || hunk.iNewFirst != hunk.iNewEnd);
+		CHECK(hunk.iOldEnd <= oldLines.GetLineCount() && hunk.iNewEnd <= newLines.GetLineCount());
+		iOldEnd = hunk.iOldEnd;
+		iNewEnd = hunk.iNewEnd;
+	}
+
+	CStringW result;
+	ApplyHunks(oldText, oldLines, newText, newLines, hunks, result);
+	CHECK(SameText(result, newText));
+}
+
+TEST(CommonPrefixMatchesScalar)
+{
+	WCHAR rgText1[64 + 1];
+	WCHAR rgText2[64 + 1];
+	for (long length = 0; length <= 40; ++length)
+	{
+		// the first character of the arrays is skipped for half the cases, so the 
+		// blocks compared are aligned differently
+		for (long skew = 0; skew != 2; ++skew)
+		{
+			for (long iDifferent = 0; iDifferent <= length; ++iDifferent)
+			{
+				WCHAR* pText1 = rgText1 + skew;
+				WCHAR* pText2 = rgText2 + skew;
+				for (long index = 0; index != length; ++index)
+					pText1[index] = pText2[index] = (WCHAR)(L'a' + Random() % 26);
+				if (iDifferent != length)
+					pText2[iDifferent] = (WCHAR)(pText1[iDifferent] ^ 0x100);
+
+				long suffix = iDifferent == length ? length : length - iDifferent - 1;
+				CHECK_EQUAL(iDifferent, TextDiff::CommonPrefix(pText1, pText2, length));
+				CHECK_EQUAL(suffix, TextDiff::CommonSuffix(pText1 + length, pText2 + length, length));
+			}
+		}
+	}
+}
+
+TEST(CommonPrefixComparesBothBytes)
+{
+	// differences in either half of a character must count, not just the low byte
+	WCHAR rgText1[16];
+	WCHAR rgText2[16];
+	for (long index = 0; index != 16; ++index)
+		rgText1[index] = rgText2[index] = L'x';
+	rgText2[11] = (WCHAR)(L'x' | 0x4100);
+	CHECK_EQUAL(11, TextDiff::CommonPrefix(rgText1, rgText2, 16));
+	CHECK_EQUAL(4, TextDiff::CommonSuffix(rgText1 + 16, rgText2 + 16, 16));
+	rgText2[11] = L'x';
+	rgText2[3] = (WCHAR)(L'x' ^ 0x0100);
+	CHECK_EQUAL(3, TextDiff::CommonPrefix(rgText1, rgText2, 16));
+	CHECK_EQUAL(12, TextDiff::CommonSuffix(rgText1 + 16, rgText2 + 16, 16));
+}
+
+TEST(LineTableRecognizesEveryLineBreak)
+{
+	CStringW text(L"a\rb\r\nc\nd\x2028" L"e\x2029\r\n");
+	LineTable lines;
+	lines.Build(text, text.GetLength());
+	CHECK_EQUAL(7, lines.GetLineCount());
+	CHECK_EQUAL(0, lines.GetLineStart(0));
+	CHECK_EQUAL(2, lines.GetLineStart(1));
+	CHECK_EQUAL(5, lines.GetLineStart(2));
+	CHECK_EQUAL(7, lines.GetLineStart(3));
+	CHECK_EQUAL(9, lines.GetLineStart(4));
+	CHECK_EQUAL(11, lines.GetLineStart(5));
+	CHECK_EQUAL(13, lines.GetLineStart(6));
+	CHECK_EQUAL(13, lines.GetLineStart(7));
+}
+
+TEST(WalkerMatchesBinarySearch)
+{
+	CStringW text;
+	AppendRandomLines(text, 2000);
+	LineTable lines;
+	lines.Build(text, text.GetLength());
+
+	// mostly small steps forward, as mappings in document order give, with jumps 
+	// forward and back and positions outside the text
+	LineTable::Walker walker(lines);
+	long iPosition = 0;
+	for (long step = 0; step != 20000; ++step)
+	{
+		ULONG choice = Random() % 16;
+		if (choice == 0)
+			iPosition = (long)(Random() % (text.GetLength() + 20)) - 10;
+		else
+			iPosition += (long)(Random() % (choice < 12 ? 30 : 1000));
+
+		long iLine = -1, iIndex = -1, iExpectedLine = -1, iExpectedIndex = -1;
+		walker.GetLineIndexOfPosition(iPosition, &iLine, &iIndex);
+		lines.GetLineIndexOfPosition(iPosition, &iExpectedLine, &iExpectedIndex);
+		CHECK_EQUAL(iExpectedLine, iLine);
+		CHECK_EQUAL(iExpectedIndex, iIndex);
+
+		if (iPosition > text.GetLength())
+			iPosition = 0;
+	}
+}
+
+TEST(SameTextHasNoHunks)
+{
+	CStringW text;
+	AppendRandomLines(text, 100);
+	PooledArray<TextHunk> hunks;
+	CheckDiff(text, text, hunks);
+	CHECK_EQUAL(0, hunks.GetCount());
+}
+
+TEST(OneChangedLineIsOneHunk)
+{
+	CStringW oldText;
+	AppendNumberedLines(oldText, 0, 1000, L"old");
+	CStringW newText;
+	AppendNumberedLines(newText, 0, 500, L"old");
+	newText.Append(L"changed\r\n");
+	AppendNumberedLines(newText, 501, 499, L"old");
+
+	PooledArray<TextHunk> hunks;
+	CheckDiff(oldText, newText, hunks);
+	CHECK_EQUAL(1, hunks.GetCount());
+	CHECK_EQUAL(500, hunks[0].iOldFirst);
+	CHECK_EQUAL(501, hunks[0].iOldEnd);
+	CHECK_EQUAL(500, hunks[0].iNewFirst);
+	CHECK_EQUAL(501, hunks[0].iNewEnd);
+}
+
+TEST(CarriageReturnBecomingCrLfIsAChange)
+{
+	// the common prefix ends between "\r" and "\n" - the line before it isn't common
+	CStringW oldText(L"first\r\nsecond\rthird\r\n");
+	CStringW newText(L"first\r\nsecond\r\nthird\r\n");
+	PooledArray<TextHunk> hunks;
+	CheckDiff(oldText, newText, hunks);
+	CHECK_EQUAL(1, hunks.GetCount());
+	CHECK_EQUAL(1, hunks[0].iOldFirst);
+	CHECK_EQUAL(2, hunks[0].iOldEnd);
+
+	CheckDiff(newText, oldText, hunks);
+	CHECK_EQUAL(1, hunks.GetCount());
+}
+
+TEST(RandomEditsReproduceTheNewText)
+{
+	PooledArray<TextHunk> hunks;
+	for (long round = 0; round != 500; ++round)
+	{
+		CStringW oldText;
+		AppendRandomLines(oldText, Random() % 60);
+
+		// a few runs of lines inserted, removed or replaced, the rest copied
+		LineTable oldLines;
+		oldLines.Build(oldText, oldText.GetLength());
+		CStringW newText;
+		CStringW line;
+		for (long iLine = 0; iLine < oldLines.GetLineCount(); ++iLine)
+		{
+			ULONG choice = Random() % 10;
+			if (choice == 0)
+				AppendRandomLines(newText, 1 + Random() % 3);
+			if (choice == 1)
+				continue;
+			if (choice == 2)
+			{
+				AppendRandomLines(newText, 1);
+				continue;
+			}
+			GetLine(oldText, oldLines, iLine, line);
+			newText.Append(line);
+		}
+		if (Random() % 4 == 0)
+			newText.Append(L"no line break at the end");
+
+		CheckDiff(oldText, newText, hunks);
+		CheckDiff(newText, oldText, hunks);
+	}
+}
+
+TEST(TooManyEditsIsOneHunk)
+{
+	// every line differs, more than MaximumEdits of them
+	CStringW oldText;
+	AppendNumberedLines(oldText, 0, TextDiff::MaximumEdits, L"old");
+	CStringW newText;
+	AppendNumberedLines(newText, 0, TextDiff::MaximumEdits, L"new");
+
+	PooledArray<TextHunk> hunks;
+	CheckDiff(oldText, newText, hunks);
+	CHECK_EQUAL(1, hunks.GetCount());
+	CHECK_EQUAL(0, hunks[0].iOldFirst);
+	CHECK_EQUAL(TextDiff::MaximumEdits, hunks[0].iOldEnd);
+	CHECK_EQUAL(TextDiff::MaximumEdits, hunks[0].iNewEnd);
+}
+
+TEST(TooManyHunksIsOneHunk)
+{
+	// every other line changed - far more separate hunks than MaximumHunks
+	CStringW oldText;
+	CStringW newText;
+	for (long iLine = 0; iLine != 2 * TextDiff::MaximumHunks + 10; ++iLine)
+	{
+		oldText.AppendFormat(L"line %d\r\n", iLine);
+		newText.AppendFormat(iLine % 2 == 0 ? L"line %d\r\n" : L"changed %d\r\n", iLine);
+	}
+
+	PooledArray<TextHunk> hunks;
+	CheckDiff(oldText, newText, hunks);
+	CHECK_EQUAL(1, hunks.GetCount());
+}
@@ -0,0 +1,169 @@
+
+#include "stdafx.h"
+#include "Diagnostics.h"
+
+static const WCHAR* s_counterNames[SparkCounterMaximum] = 
+{
+	L"Regenerations",
+	L"CoalescedRegenerations",
+	L"CancelledRegenerations",
+	L"MappingCount",
+	L"BytesCopied",
+	L"DeferredRegenerations",
+};
+
+static const WCHAR* s_timingNames[SparkTimingMaximum] = 
+{
+	L"EnsureSecondaryBufferReady",
+	L"OnGenerated",
+	L"BeginColorization",
+	L"ColorizePass",
+};
+
+// fields are written by one thread and read by any. 64-bit loads and stores are only 
+// whole on 64-bit targets - elsewhere they take an interlocked operation
+static inline LONGLONG LoadWhole(const LONGLONG* pValue)
+{
+#ifdef _WIN64
+	return *(const volatile LONGLONG*)pValue;
+#else
+	return InterlockedCompareExchange64((volatile LONGLONG*)pValue, 0, 0);
+#endif
+}
+
+static inline void StoreWhole(LONGLONG* pValue, LONGLONG value)
+{
+#ifdef _WIN64
+	*(volatile LONGLONG*)pValue = value;
+#else
+	InterlockedExchange64(pValue, value);
+#endif
+}
+
+Diagnostics::Diagnostics()
+{
+	_ownerThreadId = GetCurrentThreadId();
+	Clear(_owner);
+	Clear(_shared);
+	Clear(_baseline);
+	ZeroMemory(_sizes, sizeof(_sizes));
+}
+
+void Diagnostics::Add(SparkCounter counter, LONGLONG value)
+{
+	// only the owner writes its block, so its own plain read is current
+	if (IsOwner())
+		StoreWhole(&_owner.counters[counter], _owner.counters[counter] + value);
+	else
+		InterlockedExchangeAdd64(&_shared.counters[counter], value);
+}
+
+void Diagnostics::Set(SparkCounter counter, LONGLONG value)
+{
+	InterlockedExchange64(&_sizes[counter], value);
+}
+
+void Diagnostics::Record(SparkTiming timing, LONGLONG ticks)
+{
+	LONGLONG microseconds = ticks * 1000000 / GetFrequency();
+
+	long bucket = 0;
+	while (bucket != HistogramBuckets - 1 && (microseconds >> bucket) != 0)
+		++bucket;
+
+	if (IsOwner())
+		StoreWhole(&_owner.histograms[timing][bucket], _owner.histograms[timing][bucket] + 1);
+	else
+		InterlockedIncrement64(&_shared.histograms[timing][bucket]);
+}
+
+void Diagnostics::Reset()
+{
+	// every field of a block is a LONGLONG, so neither this nor the merge needs to know
+	// the layout. totals only grow, so one read after the baseline never falls below it
+	const LONGLONG* owner = (const LONGLONG*)&_owner;
+	const LONGLONG* shared = (const LONGLONG*)&_shared;
+	LONGLONG* baseline = (LONGLONG*)&_baseline;
+	for (long index = 0; index != sizeof(Block) / sizeof(LONGLONG); ++index)
+		StoreWhole(&baseline[index], LoadWhole(&owner[index]) + LoadWhole(&shared[index]));
+}
+
+void Diagnostics::Read(Block& block) const
+{
+	const LONGLONG* owner = (const LONGLONG*)&_owner;
+	const LONGLONG* shared = (const LONGLONG*)&_shared;
+	const LONGLONG* baseline = (const LONGLONG*)&_baseline;
+	LONGLONG* total = (LONGLONG*)&block;
+	for (long index = 0; index != sizeof(Block) / sizeof(LONGLONG); ++index)
+	{
+		LONGLONG since = LoadWhole(&baseline[index]);
+		total[index] += LoadWhole(&owner[index]) + LoadWhole(&shared[index]) - since;
+	}
+	for (long counter = 0; counter != SparkCounterMaximum; ++counter)
+		block.counters[counter] += LoadWhole(&_sizes[counter]);
+}
+
+LONGLONG Diagnostics::Now()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+}
+
+LONGLONG Diagnostics::GetFrequency()
+{
+	static LONGLONG s_frequency = 0;
+	if (s_frequency == 0)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		s_frequency = frequency.QuadPart;
+	}
+	return s_frequency;
+}
+
+HRESULT Diagnostics::GetCounter(const Block& block, SparkCounter counter, LONGLONG* pValue)
+{
+	if (counter < 0 || counter >= SparkCounterMaximum)
+		return E_INVALIDARG;
+
+	*pValue = block.counters[counter];
+	return S_OK;
+}
+
+HRESULT Diagnostics::GetHistogram(const Block& block, SparkTiming timing, long cBuckets, LONGLONG* rgCounts, long* pcBuckets)
+{
+	if (timing < 0 || timing >= SparkTimingMaximum)
+		return E_INVALIDARG;
+
+	long cCopy = cBuckets;
+	if (cCopy > HistogramBuckets)
+		cCopy = HistogramBuckets;
+	for (long bucket = 0; bucket < cCopy; ++bucket)
+		rgCounts[bucket] = block.histograms[timing][bucket];
+	*pcBuckets = cCopy;
+	return S_OK;
+}
+
+HRESULT Diagnostics::Dump(const Block& block, BSTR* pText)
+{
+	// one "name value" line per counter, then one line per timing of "bucket:count" 
+	// pairs for the buckets in use, each labelled with its upper bound in microseconds
+	CStringW text;
+	for (long counter = 0; counter != SparkCounterMaximum; ++counter)
+		text.AppendFormat(L"%s %I64d\r\n", s_counterNames[counter], block.counters[counter]);
+
+	for (long timing = 0; timing != SparkTimingMaximum; ++timing)
+	{
+		text.Append(s_timingNames[timing]);
+		for (long bucket = 0; bucket != HistogramBuckets; ++bucket)
+		{
+			if (block.histograms[timing][bucket] != 0)
+				text.AppendFormat(L" <%I64dus:%I64d", (LONGLONG)1 << bucket, block.histograms[timing][bucket]);
+		}
+		text.Append(L"\r\n");
+	}
+
+	*pText = text.AllocSysString();
+	return S_OK;
+}
@@ -0,0 +1,77 @@
+
+#pragma once
+
+#include "SparkLanguagePackage_i.h"
+
+// Counters and latency histograms kept by each source, cheap enough to leave on. The 
+// thread that owns the source (the UI thread) is the only one to write a block of its 
+// own, and adds to it without a lock; any other thread adds to a shared block with 
+// interlocked operations. The two are merged when read, on any thread. A reset moves a
+// baseline up to the totals rather than clearing fields another thread is writing.
+class Diagnostics
+{
+public:
+	enum {HistogramBuckets = 24};
+
+	struct Block
+	{
+		LONGLONG counters[SparkCounterMaximum];
+		LONGLONG histograms[SparkTimingMaximum][HistogramBuckets];
+	};
+
+private:
+	DWORD _ownerThreadId;
+	Block _owner;
+	Block _shared;
+	Block _baseline;
+
+	// sizes given to Set, which a reset leaves alone
+	LONGLONG _sizes[SparkCounterMaximum];
+
+public:
+	Diagnostics();
+
+	void SetOwnerThread(DWORD dwThreadId) {_ownerThreadId = dwThreadId;}
+
+	void Add(SparkCounter counter, LONGLONG value);
+
+	// for counters that hold a current size rather than a total - never Add to them
+	void Set(SparkCounter counter, LONGLONG value);
+	void Record(SparkTiming timing, LONGLONG ticks);
+	void Reset();
+
+	// adds this object's totals since the last reset into block, which starts out 
+	// zeroed by Clear. each field is read whole, though not all at the same instant
+	void Read(Block& block) const;
+
+	static void Clear(Block& block) {ZeroMemory(&block, sizeof(block));}
+	static LONGLONG Now();
+
+	// the ISparkDiagnostics methods, answered from a block that has been read
+	static HRESULT GetCounter(const Block& block, SparkCounter counter, LONGLONG* pValue);
+	static HRESULT GetHistogram(const Block& block, SparkTiming timing, long cBuckets, LONGLONG* rgCounts, long* pcBuckets);
+	static HRESULT Dump(const Block& block, BSTR* pText);
+
+private:
+	bool IsOwner() const {return GetCurrentThreadId() == _ownerThreadId;}
+	static LONGLONG GetFrequency();
+};
+
+// Records the time between construction and destruction
+class DiagnosticsTimer
+{
+	Diagnostics& _diagnostics;
+	SparkTiming _timing;
+	LONGLONG _start;
+
+public:
+	DiagnosticsTimer(Diagnostics& diagnostics, SparkTiming timing) :
+		_diagnostics(diagnostics), _timing(timing), _start(Diagnostics::Now())
+	{
+	}
+
+	~DiagnosticsTimer()
+	{
+		_diagnostics.Record(_timing, Diagnostics::Now() - _start);
+	}
+};
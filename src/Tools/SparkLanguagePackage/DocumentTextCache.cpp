@@ -0,0 +1,116 @@
+
+#include "stdafx.h"
+#include "DocumentTextCache.h"
+
+HRESULT DocumentText::CopyText(BSTR* pText)
+{
+	HRESULT hr = S_OK;
+
+	// cleared before reading, so an edit made meanwhile is picked up next time
+	if (InterlockedExchange(&_stale, FALSE))
+	{
+		long iLine = 0;
+		long iIndex = 0;
+		CComBSTR text;
+		_HR(_buffer->GetLastLineIndex(&iLine, &iIndex));
+		_HR(_buffer->GetLineText(0, 0, iLine, iIndex, &text));
+
+		if (FAILED(hr))
+		{
+			InterlockedExchange(&_stale, TRUE);
+			return hr;
+		}
+		_text.Attach(text.Detach());
+	}
+
+	return _text.CopyTo(pText);
+}
+
+HRESULT DocumentTextCache::GetText(IVsRunningDocumentTable* pRunningDocumentTable, BSTR canonicalName, BSTR* pText)
+{
+	*pText = NULL;
+
+	// the read lock keeps the document open while it's read, and is always given back
+	CComPtr<IVsHierarchy> hierarchy;
+	VSITEMID itemid = VSITEMID_NIL;
+	CComPtr<IUnknown> punkDocument;
+	VSCOOKIE docCookie = 0;
+	HRESULT hrFind = pRunningDocumentTable->FindAndLockDocument(RDT_ReadLock, canonicalName, &hierarchy, &itemid, &punkDocument, &docCookie);
+	if (hrFind != S_OK)
+	{
+		// return (string)null
+		return S_OK;
+	}
+
+	HRESULT hr = S_OK;
+	CComPtr<IVsTextLines> textLines;
+	if (itemid != VSITEMID_NIL && punkDocument != NULL)
+		_HR(punkDocument->QueryInterface(&textLines));
+
+	if (SUCCEEDED(hr) && textLines != NULL)
+	{
+		CComCritSecLock<CComCriticalSection> lock(_lock);
+
+		CStringW key(canonicalName);
+		DocumentText* entry = NULL;
+		_entries.Lookup(key, entry);
+
+		// the name may have been closed and opened again in a new buffer
+		if (entry != NULL && (entry->GetBuffer() != textLines || entry->GetDocCookie() != docCookie))
+		{
+			_entries.RemoveKey(key);
+			entry->Close();
+			entry->Release();
+			entry = NULL;
+		}
+
+		if (entry == NULL)
+		{
+			CComPtr<IVsTextLinesEvents> created;
+			DocumentTextInit init;
+			init._buffer = textLines;
+			init._docCookie = docCookie;
+			_HR(DocumentText::CreateInstance(init, &created));
+			if (SUCCEEDED(hr))
+			{
+				entry = static_cast<DocumentText*>(created.Detach());
+				_entries.SetAt(key, entry);
+			}
+		}
+
+		if (entry != NULL)
+			_HR(entry->CopyText(pText));
+	}
+
+	pRunningDocumentTable->UnlockDocument(RDT_ReadLock, docCookie);
+	return hr;
+}
+
+void DocumentTextCache::Remove(VSCOOKIE docCookie)
+{
+	CComCritSecLock<CComCriticalSection> lock(_lock);
+	POSITION pos = _entries.GetStartPosition();
+	while (pos != NULL)
+	{
+		POSITION current = pos;
+		DocumentText* entry = _entries.GetNextValue(pos);
+		if (entry->GetDocCookie() == docCookie)
+		{
+			_entries.RemoveAtPos(current);
+			entry->Close();
+			entry->Release();
+		}
+	}
+}
+
+void DocumentTextCache::Clear()
+{
+	CComCritSecLock<CComCriticalSection> lock(_lock);
+	for (POSITION pos = _entries.GetStartPosition(); pos != NULL; )
+	{
+		DocumentText* entry = _entries.GetNextValue(pos);
+		entry->Close();
+		entry->Release();
+	}
+	_entries.RemoveAll();
+}
@@ -0,0 +1,90 @@
+
+#pragma once
+
+#include "atlutil.h"
+
+class DocumentTextInit
+{
+public:
+	CComPtr<IVsTextLines> _buffer;
+	VSCOOKIE _docCookie;
+};
+
+// Text of one running document as last read, marked stale by the buffer's own events
+class ATL_NO_VTABLE DocumentText :
+	public CComCreatableObject<DocumentText, DocumentTextInit>,
+	public IVsTextLinesEvents
+{
+	DWORD _bufferAdvise;
+	volatile LONG _stale;
+	CComBSTR _text;
+
+public:
+	DocumentText()
+	{
+		_bufferAdvise = 0;
+		_stale = TRUE;
+	}
+
+	BEGIN_COM_MAP(DocumentText)
+		COM_INTERFACE_ENTRY(IVsTextLinesEvents)
+	END_COM_MAP()
+
+	DECLARE_PROTECT_FINAL_CONSTRUCT();
+
+	HRESULT FinalConstruct()
+	{
+		return AtlAdvise(_buffer, static_cast<IVsTextLinesEvents*>(this), __uuidof(IVsTextLinesEvents), &_bufferAdvise);
+	}
+
+	void Close()
+	{
+		if (_bufferAdvise != 0)
+		{
+			AtlUnadvise(_buffer, __uuidof(IVsTextLinesEvents), _bufferAdvise);
+			_bufferAdvise = 0;
+		}
+	}
+
+	IVsTextLines* GetBuffer() const {return _buffer;}
+	VSCOOKIE GetDocCookie() const {return _docCookie;}
+
+	// copy of the text, read again from the buffer only when it changed since last time
+	HRESULT CopyText(BSTR* pText);
+
+	/**** IVsTextLinesEvents ****/
+	STDMETHODIMP_(void) OnChangeLineText( 
+		/* [in] */ __RPC__in const TextLineChange *pTextLineChange,
+		/* [in] */ BOOL fLast)
+	{
+		InterlockedExchange(&_stale, TRUE);
+	}
+
+	STDMETHODIMP_(void) OnChangeLineAttributes( 
+		/* [in] */ long iFirstLine,
+		/* [in] */ long iLastLine)
+	{
+	}
+};
+
+// Running document texts by canonical name, shared by every source - a layout or partial 
+// used by many views is copied out of its buffer once per change instead of once per
+// generation of each view
+class DocumentTextCache
+{
+	CComAutoCriticalSection _lock;
+	CAtlMap<CStringW, DocumentText*, CStringElementTraitsI<CStringW> > _entries;
+
+public:
+	~DocumentTextCache()
+	{
+		Clear();
+	}
+
+	// text of the named document, or NULL when it isn't open
+	HRESULT GetText(IVsRunningDocumentTable* pRunningDocumentTable, BSTR canonicalName, BSTR* pText);
+
+	// forgets the entry of a document leaving the running document table
+	void Remove(VSCOOKIE docCookie);
+	void Clear();
+};
@@ -0,0 +1,180 @@
+
+#include "stdafx.h"
+#include "GeneratedState.h"
+
+static void Shift(SourceMapping& mapping, long shift1, long shift2)
+{
+	mapping.start1 += shift1;
+	mapping.end1 += shift1;
+	mapping.start2 += shift2;
+	mapping.end2 += shift2;
+}
+
+// every op in order of index, inside the previous items and the inserted ones, checked
+// before anything is copied - the ops come across from the supervisor as they are
+static bool CountOps(long cPrevious, const SourceDeltaOp* rgOps, long cOps, long cInsert, long* pcNext)
+{
+	if (cOps < 0 || cInsert < 0)
+		return false;
+
+	long iPrevious = 0;
+	long iInsert = 0;
+	long cRemoved = 0;
+	for (long op = 0; op != cOps; ++op)
+	{
+		const SourceDeltaOp& delta = rgOps[op];
+		if (delta.index < iPrevious || delta.cRemove < 0 || delta.cRemove > cPrevious - delta.index ||
+			delta.cInsert < 0 || delta.cInsert > cInsert - iInsert)
+			return false;
+
+		iPrevious = delta.index + delta.cRemove;
+		iInsert += delta.cInsert;
+		cRemoved += delta.cRemove;
+	}
+
+	// every inserted item is used, once
+	if (iInsert != cInsert)
+		return false;
+	*pcNext = cPrevious - cRemoved + cInsert;
+	return true;
+}
+
+template<typename T>
+static bool ApplyOps(
+	const PooledArray<T>& previous, PooledArray<T>& next, 
+	const SourceDeltaOp* rgOps, long cOps, 
+	const T* rgInsert, long cInsert)
+{
+	long cPrevious = (long)previous.GetCount();
+	long cNext = 0;
+	if (!CountOps(cPrevious, rgOps, cOps, cInsert, &cNext))
+		return false;
+	next.SetCount(cNext);
+
+	long iPrevious = 0;
+	long iNext = 0;
+	long iInsert = 0;
+	long shift1 = 0;
+	long shift2 = 0;
+	for (long op = 0; op <= cOps; ++op)
+	{
+		// the last stretch runs to the end
+		long index = op == cOps ? cPrevious : rgOps[op].index;
+		for (; iPrevious != index; ++iPrevious, ++iNext)
+		{
+			next[iNext] = previous[iPrevious];
+			Shift(next[iNext], shift1, shift2);
+		}
+		if (op == cOps)
+			break;
+
+		const SourceDeltaOp& delta = rgOps[op];
+		iPrevious += delta.cRemove;
+		for (long insert = 0; insert != delta.cInsert; ++insert)
+			next[iNext++] = rgInsert[iInsert++];
+
+		shift1 = delta.shift1;
+		shift2 = delta.shift2;
+	}
+	return true;
+}
+
+// the same for text edits, whose inserted ranges may be anywhere in the inserted text
+static bool CountTextEdits(long cchPrevious, const GeneratedTextEdit* rgEdits, long cEdits, long cchInserted, long* pcchNext)
+{
+	if (cEdits < 0 || cchInserted < 0)
+		return false;
+
+	LONGLONG cchNext = cchPrevious;
+	long iPrevious = 0;
+	for (long edit = 0; edit != cEdits; ++edit)
+	{
+		const GeneratedTextEdit& change = rgEdits[edit];
+		if (change.start < iPrevious || change.end < change.start || change.end > cchPrevious || 
+			change.insertStart < 0 || change.insertEnd < change.insertStart || change.insertEnd > cchInserted)
+			return false;
+
+		cchNext += (change.insertEnd - change.insertStart) - (change.end - change.start);
+		iPrevious = change.end;
+	}
+
+	if (cchNext > LONG_MAX)
+		return false;
+	*pcchNext = (long)cchNext;
+	return true;
+}
+
+static bool ApplyTextEdits(
+	const PooledArray<WCHAR>& previous, PooledArray<WCHAR>& next, 
+	const GeneratedTextEdit* rgEdits, long cEdits, 
+	const WCHAR* pInserted, long cchInserted)
+{
+	long cchPrevious = (long)previous.GetCount();
+	long cchNext = 0;
+	if (!CountTextEdits(cchPrevious, rgEdits, cEdits, cchInserted, &cchNext))
+		return false;
+	next.SetCount(cchNext);
+
+	long iPrevious = 0;
+	long iNext = 0;
+	for (long edit = 0; edit <= cEdits; ++edit)
+	{
+		long start = edit == cEdits ? cchPrevious : rgEdits[edit].start;
+		CopyMemory(next.GetData() + iNext, previous.GetData() + iPrevious, (start - iPrevious) * sizeof(WCHAR));
+		iNext += start - iPrevious;
+		if (edit == cEdits)
+			break;
+
+		const GeneratedTextEdit& change = rgEdits[edit];
+		CopyMemory(next.GetData() + iNext, pInserted + change.insertStart, (change.insertEnd - change.insertStart) * sizeof(WCHAR));
+		iNext += change.insertEnd - change.insertStart;
+		iPrevious = change.end;
+	}
+	return true;
+}
+
+void GeneratedState::Clear()
+{
+	_generation = 0;
+	_text[_current].RemoveAll();
+	_mappings[_current].RemoveAll();
+}
+
+bool GeneratedState::ApplyDelta(
+	long generation, long baseGeneration, 
+	const GeneratedTextEdit* rgTextEdits, long cTextEdits, const WCHAR* pInserted, long cchInserted, 
+	const SourceDeltaOp* rgMappingOps, long cMappingOps, const SourceMapping* rgMappings, long cMappings)
+{
+	if (baseGeneration == 0)
+	{
+		Clear();
+	}
+	else if (baseGeneration != _generation)
+	{
+		Clear();
+		return false;
+	}
+
+	long next = 1 - _current;
+	if (!ApplyTextEdits(_text[_current], _text[next], rgTextEdits, cTextEdits, pInserted, cchInserted) ||
+		!ApplyOps(_mappings[_current], _mappings[next], rgMappingOps, cMappingOps, rgMappings, cMappings))
+	{
+		Clear();
+		return false;
+	}
+
+	_current = next;
+	_generation = generation;
+	return true;
+}
+
+ULONG GeneratedState::HashText(const WCHAR* pText, long cchText)
+{
+	ULONG hash = 2166136261;
+	for (long index = 0; index != cchText; ++index)
+	{
+		hash ^= pText[index];
+		hash *= 16777619;
+	}
+	return hash;
+}
@@ -0,0 +1,41 @@
+
+#pragma once
+
+#include "SparkLanguagePackage_i.h"
+#include "PooledArray.h"
+
+// The generation a supervisor last delivered, kept so the next one can arrive as 
+// changes to it. Deltas are applied by copying between two sets of buffers which 
+// then trade places, so neither grows once it has reached the document's size.
+class GeneratedState
+{
+	long _generation;
+	long _current;
+	PooledArray<WCHAR> _text[2];
+	PooledArray<SourceMapping> _mappings[2];
+
+public:
+	GeneratedState() : _generation(0), _current(0)
+	{
+	}
+
+	// 0 when empty
+	long GetGeneration() const {return _generation;}
+
+	const WCHAR* GetText() const {return _text[_current].GetData();}
+	long GetTextLength() const {return (long)_text[_current].GetCount();}
+	const PooledArray<SourceMapping>& GetMappings() const {return _mappings[_current];}
+
+	void Clear();
+
+	// a base generation of 0 starts again from empty, any other has to be the one held. 
+	// false, with the state cleared, when the delta doesn't fit what is held - nothing 
+	// is copied until every edit and op has been checked against it
+	bool ApplyDelta(
+		long generation, long baseGeneration, 
+		const GeneratedTextEdit* rgTextEdits, long cTextEdits, const WCHAR* pInserted, long cchInserted, 
+		const SourceDeltaOp* rgMappingOps, long cMappingOps, const SourceMapping* rgMappings, long cMappings);
+
+	// identifies a primary text without keeping a copy - FNV-1a over the UTF-16 code units
+	static ULONG HashText(const WCHAR* pText, long cchText);
+};
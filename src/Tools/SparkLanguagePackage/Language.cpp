@@ -1,133 +1,482 @@
-
-#include "stdafx.h"
-#include "Language.h"
-#include "CodeWindowManager.h"
-#include "Colorizer.h"
-#include "Source.h"
-#include "ColorableItem.h"
-
-
-STDMETHODIMP Language::GetSource(IVsTextBuffer* pBuffer, ISparkSource** ppSource)
-{
-	HRESULT hr = S_OK;
-
-	CComCritSecLock<CComCriticalSection> lock(_sourcesLock);
-
-	CComPtr<IUnknown> key;
-	_HR(pBuffer->QueryInterface(&key));
-
-	int index = _sources.FindKey(key);
-
-	if (index == -1)
-	{
-		CComPtr<ISparkSource> source;
-		
-		SourceInit init = {_site};
-		_HR(pBuffer->QueryInterface(&init._primaryBuffer));
-		_HR(Source::CreateInstance(init, &source));
-		
-		_HR(_supervisor->OnSourceAssociated(source));
-
-		_HR(source->QueryInterface(ppSource));
-
-		if (SUCCEEDED(hr))
-			_sources.Add(key.Detach(), source.Detach());
-	}
-	else
-	{
-		_sources.GetValueAt(index)->QueryInterface(ppSource);
-	}
-	return hr;
-}
-
-STDMETHODIMP Language::GetColorizer( 
-    /* [in] */ __RPC__in_opt IVsTextLines *pBuffer,
-    /* [out] */ __RPC__deref_out_opt IVsColorizer **ppColorizer)
-{
-	HRESULT hr = S_OK;
-
-	CComPtr<IVsProvideColorableItems> csharpItems;
-	_HR(_site->QueryService(__uuidof(CSharp), &csharpItems));
-	int csharpItemCount;
-	_HR(csharpItems->GetItemCount(&csharpItemCount));
-
-	ColorizerInit init = {this, pBuffer, csharpItemCount};
-	_HR(Colorizer::CreateInstance(init, ppColorizer));
-	return hr;
-}
-
-STDMETHODIMP Language::GetCodeWindowManager( 
-    /* [in] */ __RPC__in_opt IVsCodeWindow *pCodeWin,
-    /* [out] */ __RPC__deref_out_opt IVsCodeWindowManager **ppCodeWinMgr)
-{
-	HRESULT hr = S_OK;
-	CodeWindowManagerInit init = {this, pCodeWin};
-	_HR(CodeWindowManager::CreateInstance(init, ppCodeWinMgr));
-	return hr;
-}
-
-
-STDMETHODIMP Language::GetItemCount( 
-    /* [out] */ __RPC__out int *piCount)
-{
-	HRESULT hr = S_OK;
-
-	CComPtr<IVsProvideColorableItems> csharpItems;
-	_HR(_site->QueryService(__uuidof(CSharp), &csharpItems));
-	int csharpItemCount;
-	_HR(csharpItems->GetItemCount(&csharpItemCount));
-
-	CComPtr<IVsProvideColorableItems> sparkItems;
-	_HR(_supervisor->QueryInterface(&sparkItems));
-	int sparkItemCount;
-	_HR(sparkItems->GetItemCount(&sparkItemCount));
-	
-	*piCount = csharpItemCount + sparkItemCount;
-	return hr;
-}
-
-STDMETHODIMP Language::GetColorableItem( 
-    /* [in] */ int iIndex,
-    /* [out] */ __RPC__deref_out_opt IVsColorableItem **ppItem)
-{
-	HRESULT hr = S_OK;
-
-	// return csharp color info for lower band
-	CComPtr<IVsProvideColorableItems> csharpItems;
-	_HR(_site->QueryService(__uuidof(CSharp), &csharpItems));
-
-	// default@[0] : reserved
-	// csharpItemCount@[1..csharpItemCount] : contained language colors
-	// sparkItemCount@[csharpItemCount+1..csharpItemCount+sparkItemCount] : spark language colors
-
-	int csharpItemCount;
-	_HR(csharpItems->GetItemCount(&csharpItemCount));
-
-	if (SUCCEEDED(hr) && iIndex <= csharpItemCount)
-	{
-		_HR(csharpItems->GetColorableItem(iIndex, ppItem));
-		
-		CComBSTR name;
-		_HR((*ppItem)->GetDisplayName(&name));
-
-		return hr;
-	}
-
-	// return spark color info for upper band
-	CComPtr<IVsProvideColorableItems> sparkItems;
-	_HR(_supervisor->QueryInterface(&sparkItems));
-
-	int sparkItemCount;
-	_HR(sparkItems->GetItemCount(&sparkItemCount));
-
-	if (SUCCEEDED(hr) && iIndex <= csharpItemCount + sparkItemCount)
-	{
-		_HR(sparkItems->GetColorableItem(iIndex - csharpItemCount, ppItem));
-
-		CComBSTR name;
-		_HR((*ppItem)->GetDisplayName(&name));
-
-		return hr;
-	}
-	return E_INVALIDARG;
-}
+
+#include "stdafx.h"
+#include "Language.h"
+#include "CodeWindowManager.h"
+#include "Colorizer.h"
+#include "Source.h"
+#include "ColorableItem.h"
+#include "ProjectContext.h"
+
+
+static void CloseSource(IUnknown* pSource)
+{
+	CComQIPtr<ISparkSourceNative> sourceNative(pSource);
+	if (sourceNative != NULL)
+		sourceNative->Close();
+}
+
+HRESULT Language::FinalConstruct()
+{
+	switch (SupervisorLoader::ReadStartup(_site))
+	{
+	case SupervisorStartupBackground:
+		_supervisorLoader.BeginLoad(GetUnknown());
+		break;
+	case SupervisorStartupImmediate:
+		EnsureSupervisor();
+		break;
+	}
+
+	_largeDocumentThresholds = LanguageSettings::ReadLargeDocumentThresholds(_site);
+	if (SUCCEEDED(_regenerationDispatchWindow.Open(&_regenerationScheduler)))
+		_regenerationScheduler.Open(&_regenerationDispatchWindow);
+
+	// without the running document table sources simply live as long as the language
+	if (SUCCEEDED(_site->QueryService(SID_SVsRunningDocumentTable, &_runningDocumentTable)))
+	{
+		if (FAILED(_runningDocumentTable->AdviseRunningDocTableEvents(this, &_runningDocumentTableAdvise)))
+			_runningDocumentTableAdvise = 0;
+	}
+
+	// without the text manager the colorable items are built once
+	if (SUCCEEDED(_site->QueryService(SID_SVsTextManager, &_textManager)))
+	{
+		if (FAILED(AtlAdvise(_textManager, static_cast<IVsTextManagerEvents*>(this), __uuidof(IVsTextManagerEvents), &_textManagerAdvise)))
+			_textManagerAdvise = 0;
+	}
+
+	// without selection events every view counts as visible
+	if (SUCCEEDED(_site->QueryService(SID_SVsShellMonitorSelection, &_monitorSelection)))
+	{
+		if (FAILED(_monitorSelection->AdviseSelectionEvents(this, &_selectionEventsAdvise)))
+			_selectionEventsAdvise = 0;
+	}
+	return S_OK;
+}
+
+void Language::FinalRelease()
+{
+	Close();
+}
+
+STDMETHODIMP Language::Close()
+{
+	// waiting regenerations are dropped. one is only running here when a message pumped
+	// while it generates closed the language, and it finishes against sources closed below
+	_regenerationScheduler.Close();
+	_regenerationDispatchWindow.Close();
+
+	if (_selectionEventsAdvise != 0)
+	{
+		_monitorSelection->UnadviseSelectionEvents(_selectionEventsAdvise);
+		_selectionEventsAdvise = 0;
+	}
+	_monitorSelection.Release();
+	_focusedDocData.Release();
+
+	if (_runningDocumentTableAdvise != 0)
+	{
+		_runningDocumentTable->UnadviseRunningDocTableEvents(_runningDocumentTableAdvise);
+		_runningDocumentTableAdvise = 0;
+	}
+	_runningDocumentTable.Release();
+
+	if (_textManagerAdvise != 0)
+	{
+		AtlUnadvise(_textManager, __uuidof(IVsTextManagerEvents), _textManagerAdvise);
+		_textManagerAdvise = 0;
+	}
+	_textManager.Release();
+	InvalidateColorableItems();
+	_documentTexts.Clear();
+
+	CInterfaceArray<IUnknown> sources;
+	_sources.RemoveAll(sources);
+	for (size_t index = 0; index != sources.GetCount(); ++index)
+		CloseSource(sources[index]);
+
+	CComCritSecLock<CComCriticalSection> lock(_projectsLock);
+	for (POSITION pos = _projects.GetStartPosition(); pos != NULL; )
+	{
+		CAtlMap<IUnknown*, ISparkProjectContext*>::CPair* pair = _projects.GetNext(pos);
+		pair->m_value->Close();
+		pair->m_value->Release();
+		pair->m_key->Release();
+	}
+	_projects.RemoveAll();
+
+	return S_OK;
+}
+
+STDMETHODIMP Language::GetProjectContext(IVsHierarchy* pHierarchy, ISparkProjectContext** ppContext)
+{
+	HRESULT hr = S_OK;
+
+	CComPtr<IUnknown> key;
+	_HR(pHierarchy->QueryInterface(&key));
+	if (FAILED(hr))
+		return hr;
+
+	CComCritSecLock<CComCriticalSection> lock(_projectsLock);
+
+	ISparkProjectContext* existing = NULL;
+	if (_projects.Lookup(key, existing))
+		return existing->QueryInterface(ppContext);
+
+	CComPtr<ISparkProjectContext> context;
+
+	ProjectContextInit init;
+	init._site = _site;
+	init._hierarchy = pHierarchy;
+	_HR(ProjectContext::CreateInstance(init, &context));
+
+	_HR(context->QueryInterface(ppContext));
+
+	if (SUCCEEDED(hr))
+		_projects.SetAt(key.Detach(), context.Detach());
+	return hr;
+}
+
+STDMETHODIMP Language::GetRunningDocumentText(BSTR canonicalName, BSTR* pText)
+{
+	*pText = NULL;
+
+	HRESULT hr = S_OK;
+	CComPtr<IVsRunningDocumentTable> runningDocumentTable(_runningDocumentTable);
+	if (runningDocumentTable == NULL)
+		_HR(_site->QueryService(SID_SVsRunningDocumentTable, &runningDocumentTable));
+
+	_HR(_documentTexts.GetText(runningDocumentTable, canonicalName, pText));
+	return hr;
+}
+
+void Language::RemoveProjectContext(IUnknown* pHierarchy)
+{
+	CComPtr<IUnknown> key;
+	if (pHierarchy == NULL || FAILED(pHierarchy->QueryInterface(&key)))
+		return;
+
+	CComCritSecLock<CComCriticalSection> lock(_projectsLock);
+	CAtlMap<IUnknown*, ISparkProjectContext*>::CPair* pair = _projects.Lookup(key);
+	if (pair != NULL)
+	{
+		IUnknown* registeredKey = pair->m_key;
+		ISparkProjectContext* context = pair->m_value;
+		_projects.RemoveKey(key);
+
+		context->Close();
+		context->Release();
+		registeredKey->Release();
+	}
+}
+
+HRESULT Language::EnsureSupervisor()
+{
+	if (_supervisor != NULL)
+		return S_OK;
+
+	HRESULT hr = S_OK;
+	CComPtr<ILanguageSupervisor> supervisor;
+	_HR(_supervisorLoader.GetSupervisor(&supervisor));
+
+	if (SUCCEEDED(hr) && _supervisor == NULL)
+		SetSupervisor(supervisor);
+	return hr;
+}
+
+// a Source associated with the supervisor, made outside the registry's lock
+class LanguageSourceFactory : public SourceFactory
+{
+	IServiceProvider* _site;
+	ISparkLanguageNative* _language;
+	ILanguageSupervisor* _supervisor;
+	bool _focused;
+
+public:
+	LanguageSourceFactory(IServiceProvider* pSite, ISparkLanguageNative* pLanguage, ILanguageSupervisor* pSupervisor, bool fFocused) :
+		_site(pSite), _language(pLanguage), _supervisor(pSupervisor), _focused(fFocused)
+	{
+	}
+
+	HRESULT CreateSource(IUnknown* pKey, IUnknown** ppSource, Diagnostics** ppDiagnostics)
+	{
+		HRESULT hr = S_OK;
+		CComPtr<ISparkSource> source;
+
+		SourceInit init = {_site};
+		init._language = _language;
+		_HR(pKey->QueryInterface(&init._primaryBuffer));
+		_HR(Source::CreateInstance(init, &source));
+
+		_HR(_supervisor->OnSourceAssociated(source));
+
+		CComQIPtr<ISparkSourceNative> sourceNative(source);
+		if (sourceNative == NULL)
+			_HR(E_NOINTERFACE);
+		_HR(sourceNative->GetDiagnostics(ppDiagnostics));
+
+		// opened by the frame being activated, before the source existed to hear of it
+		if (SUCCEEDED(hr) && _focused)
+			sourceNative->SetRegenerationPriority(RegenerationPriorityFocused);
+
+		_HR(source->QueryInterface(ppSource));
+
+		if (FAILED(hr) && source != NULL)
+			CloseSource(source);
+		return hr;
+	}
+
+	void DiscardSource(IUnknown* pSource)
+	{
+		CloseSource(pSource);
+	}
+};
+
+STDMETHODIMP Language::GetSource(IVsTextBuffer* pBuffer, ISparkSource** ppSource)
+{
+	HRESULT hr = S_OK;
+
+	CComPtr<IUnknown> key;
+	_HR(pBuffer->QueryInterface(&key));
+
+	// may wait on a background load
+	_HR(EnsureSupervisor());
+	if (FAILED(hr))
+		return hr;
+
+	// every view, filter and colorizer of an open document finds its source here
+	CComPtr<IUnknown> source;
+	LanguageSourceFactory factory(_site, this, _supervisor, _focusedDocData != NULL && _focusedDocData == key);
+	_HR(_sources.GetOrCreate(key, &factory, &source));
+	_HR(source->QueryInterface(ppSource));
+	return hr;
+}
+
+void Language::RemoveSource(IUnknown* pBuffer)
+{
+	CComPtr<IUnknown> key;
+	if (pBuffer == NULL || FAILED(pBuffer->QueryInterface(&key)))
+		return;
+
+	// the figures of a closed document stay in the language's totals
+	CComPtr<IUnknown> source;
+	if (_sources.Remove(key, &source) == S_OK)
+		CloseSource(source);
+}
+
+STDMETHODIMP Language::ScheduleDependentRegenerations(ISparkSource* pChanged, LPCWSTR canonicalName)
+{
+	// copied under the lock, asked and scheduled outside it
+	CInterfaceArray<IUnknown> sources;
+	_sources.GetSources(sources);
+
+	for (size_t index = 0; index != sources.GetCount(); ++index)
+	{
+		CComQIPtr<ISparkSourceNative> sourceNative(sources[index]);
+		if (sourceNative != NULL && 
+			!sourceNative.IsEqualObject(pChanged) && 
+			sourceNative->ReferencesDocument(canonicalName) == S_OK)
+			sourceNative->ScheduleRegeneration();
+	}
+	return S_OK;
+}
+
+void Language::SetFramePriority(IVsWindowFrame* pFrame, RegenerationPriority priority)
+{
+	CComVariant docData;
+	if (pFrame == NULL || FAILED(pFrame->GetProperty(VSFPROPID_DocData, &docData)) || V_VT(&docData) != VT_UNKNOWN)
+		return;
+	SetDocDataPriority(V_UNKNOWN(&docData), priority);
+}
+
+void Language::SetDocDataPriority(IUnknown* pDocData, RegenerationPriority priority)
+{
+	CComPtr<IUnknown> key;
+	if (pDocData == NULL || FAILED(pDocData->QueryInterface(&key)))
+		return;
+
+	CComPtr<IUnknown> source;
+	if (_sources.Lookup(key, &source) != S_OK)
+		return;
+
+	CComQIPtr<ISparkSourceNative> sourceNative(source);
+	if (sourceNative != NULL)
+		sourceNative->SetRegenerationPriority(priority);
+}
+
+STDMETHODIMP Language::OnBeforeDocumentWindowShow( 
+    /* [in] */ VSCOOKIE docCookie,
+    /* [in] */ BOOL fFirstShow,
+    /* [in] */ __RPC__in_opt IVsWindowFrame *pFrame)
+{
+	// shown again behind the active frame - the active one hears of it through selection
+	CComVariant docData;
+	if (pFrame == NULL || FAILED(pFrame->GetProperty(VSFPROPID_DocData, &docData)) || V_VT(&docData) != VT_UNKNOWN)
+		return S_OK;
+
+	CComPtr<IUnknown> key;
+	if (V_UNKNOWN(&docData) == NULL || FAILED(V_UNKNOWN(&docData)->QueryInterface(&key)))
+		return S_OK;
+	if (key != _focusedDocData)
+		SetDocDataPriority(key, RegenerationPriorityVisible);
+	return S_OK;
+}
+
+STDMETHODIMP Language::OnElementValueChanged( 
+    /* [in] */ VSSELELEMID elementid,
+    /* [in] */ VARIANT varValueOld,
+    /* [in] */ VARIANT varValueNew)
+{
+	if (elementid != SEID_DocumentFrame)
+		return S_OK;
+
+	CComQIPtr<IVsWindowFrame> oldFrame(V_VT(&varValueOld) == VT_UNKNOWN ? V_UNKNOWN(&varValueOld) : NULL);
+	CComQIPtr<IVsWindowFrame> newFrame(V_VT(&varValueNew) == VT_UNKNOWN ? V_UNKNOWN(&varValueNew) : NULL);
+
+	// the frame losing focus may still be showing in another tab group
+	if (oldFrame != NULL)
+		SetFramePriority(oldFrame, oldFrame->IsVisible() == S_OK ? RegenerationPriorityVisible : RegenerationPriorityBackground);
+
+	_focusedDocData.Release();
+	CComVariant docData;
+	if (newFrame != NULL && SUCCEEDED(newFrame->GetProperty(VSFPROPID_DocData, &docData)) && 
+		V_VT(&docData) == VT_UNKNOWN && V_UNKNOWN(&docData) != NULL)
+	{
+		V_UNKNOWN(&docData)->QueryInterface(&_focusedDocData);
+		SetDocDataPriority(_focusedDocData, RegenerationPriorityFocused);
+	}
+	return S_OK;
+}
+
+STDMETHODIMP Language::OnBeforeLastDocumentUnlock( 
+    /* [in] */ VSCOOKIE docCookie,
+    /* [in] */ VSRDTFLAGS dwRDTLockType,
+    /* [in] */ DWORD dwReadLocksRemaining,
+    /* [in] */ DWORD dwEditLocksRemaining)
+{
+	if (dwReadLocksRemaining != 0 || dwEditLocksRemaining != 0 || _runningDocumentTable == NULL)
+		return S_OK;
+
+	_documentTexts.Remove(docCookie);
+
+	// the document is going away - its buffer is the key its source was registered under
+	CComPtr<IVsHierarchy> hierarchy;
+	VSITEMID itemid = VSITEMID_NIL;
+	CComPtr<IUnknown> punkDocData;
+	HRESULT hr = _runningDocumentTable->GetDocumentInfo(docCookie, NULL, NULL, NULL, NULL, &hierarchy, &itemid, &punkDocData);
+	if (SUCCEEDED(hr))
+	{
+		RemoveSource(punkDocData);
+
+		// the project file itself closing means the project is unloading
+		if (itemid == VSITEMID_ROOT)
+			RemoveProjectContext(hierarchy);
+	}
+
+	return S_OK;
+}
+
+STDMETHODIMP Language::GetColorizer( 
+    /* [in] */ __RPC__in_opt IVsTextLines *pBuffer,
+    /* [out] */ __RPC__deref_out_opt IVsColorizer **ppColorizer)
+{
+	HRESULT hr = S_OK;
+	_HR(EnsureColorableItems());
+
+	ColorizerInit init = {this, pBuffer, _containedItemCount};
+	_HR(Colorizer::CreateInstance(init, ppColorizer));
+	return hr;
+}
+
+STDMETHODIMP Language::GetCodeWindowManager( 
+    /* [in] */ __RPC__in_opt IVsCodeWindow *pCodeWin,
+    /* [out] */ __RPC__deref_out_opt IVsCodeWindowManager **ppCodeWinMgr)
+{
+	HRESULT hr = S_OK;
+	CodeWindowManagerInit init = {this, pCodeWin};
+	_HR(CodeWindowManager::CreateInstance(init, ppCodeWinMgr));
+	return hr;
+}
+
+
+void Language::InvalidateColorableItems()
+{
+	CComCritSecLock<CComCriticalSection> lock(_colorableItemsLock);
+	_colorableItemsKnown = false;
+	_colorableItems.RemoveAll();
+}
+
+HRESULT Language::EnsureColorableItems()
+{
+	CComCritSecLock<CComCriticalSection> lock(_colorableItemsLock);
+	if (_colorableItemsKnown)
+		return S_OK;
+
+	HRESULT hr = S_OK;
+
+	CComPtr<IVsProvideColorableItems> csharpItems;
+	_HR(_site->QueryService(__uuidof(CSharp), &csharpItems));
+	int csharpItemCount = 0;
+	_HR(csharpItems->GetItemCount(&csharpItemCount));
+
+	CComPtr<IVsProvideColorableItems> sparkItems;
+	_HR(EnsureSupervisor());
+	_HR(_supervisor->QueryInterface(&sparkItems));
+	int sparkItemCount = 0;
+	_HR(sparkItems->GetItemCount(&sparkItemCount));
+
+	if (FAILED(hr))
+		return hr;
+
+	// [0] stays empty - it is reserved for plain text
+	CInterfaceArray<IVsColorableItem> items;
+	items.SetCount(1 + csharpItemCount + sparkItemCount);
+
+	for (int iIndex = 1; SUCCEEDED(hr) && iIndex <= csharpItemCount; ++iIndex)
+		_HR(csharpItems->GetColorableItem(iIndex, &items[iIndex]));
+
+	for (int iIndex = 1; SUCCEEDED(hr) && iIndex <= sparkItemCount; ++iIndex)
+		_HR(sparkItems->GetColorableItem(iIndex, &items[csharpItemCount + iIndex]));
+
+	if (SUCCEEDED(hr))
+	{
+		_colorableItems.RemoveAll();
+		_colorableItems.Append(items);
+		_containedItemCount = csharpItemCount;
+		_colorableItemsKnown = true;
+	}
+	return hr;
+}
+
+STDMETHODIMP Language::GetItemCount( 
+    /* [out] */ __RPC__out int *piCount)
+{
+	HRESULT hr = S_OK;
+	_HR(EnsureColorableItems());
+	if (FAILED(hr))
+		return hr;
+
+	CComCritSecLock<CComCriticalSection> lock(_colorableItemsLock);
+	*piCount = (int)_colorableItems.GetCount() - 1;
+	return hr;
+}
+
+STDMETHODIMP Language::GetColorableItem( 
+    /* [in] */ int iIndex,
+    /* [out] */ __RPC__deref_out_opt IVsColorableItem **ppItem)
+{
+	HRESULT hr = S_OK;
+	_HR(EnsureColorableItems());
+	if (FAILED(hr))
+		return hr;
+
+	// default@[0] : reserved
+	// csharpItemCount@[1..csharpItemCount] : contained language colors
+	// sparkItemCount@[csharpItemCount+1..csharpItemCount+sparkItemCount] : spark language colors
+
+	CComCritSecLock<CComCriticalSection> lock(_colorableItemsLock);
+	if (iIndex < 1 || iIndex >= (int)_colorableItems.GetCount())
+		return E_INVALIDARG;
+
+	return _colorableItems[iIndex].CopyTo(ppItem);
+}
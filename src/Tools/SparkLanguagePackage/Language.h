@@ -1,70 +1,258 @@
-
-#pragma once
-#include "atlutil.h"
-#include "SparkLanguagePackage_i.h"
-
-class LanguageInit
-{
-public:
-	CComPtr<IServiceProvider> _site;
-};
-
-class ATL_NO_VTABLE Language : 
-	public CComCreatableObject<Language, LanguageInit>,
-	public ISparkLanguage,
-	public IVsLanguageInfo,
-	public IVsProvideColorableItems
-{
-	CComAutoCriticalSection _sourcesLock;
-	CSimpleMap<IUnknown*, IUnknown*> _sources;
-	CComPtr<ILanguageSupervisor> _supervisor;
-
-public:
-	Language()
-	{
-	}
-
-	BEGIN_COM_MAP(Language)
-		COM_INTERFACE_ENTRY(ISparkLanguage)
-		COM_INTERFACE_ENTRY(IVsLanguageInfo)
-		COM_INTERFACE_ENTRY(IVsProvideColorableItems)
-	END_COM_MAP()
-
-	/********** ISparkLanguage **********/
-	STDMETHODIMP GetSupervisor(ILanguageSupervisor** ppSupervisor) 	{return _supervisor == NULL ? *ppSupervisor = NULL, S_OK : _supervisor->QueryInterface(ppSupervisor);}
-	STDMETHODIMP SetSupervisor(ILanguageSupervisor* pSupervisor) {_supervisor = pSupervisor; return S_OK;}
-	STDMETHODIMP GetSource(IVsTextBuffer* pBuffer, ISparkSource** ppSource);
-
-	/********** IVsLanguageInfo **********/
-    STDMETHODIMP GetLanguageName( 
-        /* [out] */ __RPC__deref_out_opt BSTR *bstrName)
-	{
-		*bstrName = SysAllocString(L"Spark");
-		return S_OK;
-	}
-    
-    STDMETHODIMP GetFileExtensions( 
-        /* [out] */ __RPC__deref_out_opt BSTR *pbstrExtensions)
-	{
-		*pbstrExtensions = SysAllocString(L".spark");
-		return S_OK;
-	}
-    
-    STDMETHODIMP GetColorizer( 
-        /* [in] */ __RPC__in_opt IVsTextLines *pBuffer,
-        /* [out] */ __RPC__deref_out_opt IVsColorizer **ppColorizer);
-    
-    STDMETHODIMP GetCodeWindowManager( 
-        /* [in] */ __RPC__in_opt IVsCodeWindow *pCodeWin,
-        /* [out] */ __RPC__deref_out_opt IVsCodeWindowManager **ppCodeWinMgr);
-
-
-	/********** IVsProvideColorableItems **********/
-    STDMETHODIMP GetItemCount( 
-        /* [out] */ __RPC__out int *piCount);
-    
-    STDMETHODIMP GetColorableItem( 
-        /* [in] */ int iIndex,
-        /* [out] */ __RPC__deref_out_opt IVsColorableItem **ppItem);
-};
-
+
+#pragma once
+#include "atlutil.h"
+#include "SparkLanguagePackage_i.h"
+#include "LanguageNative.h"
+#include "DocumentTextCache.h"
+#include "SupervisorLoader.h"
+#include "Diagnostics.h"
+#include "SourceRegistry.h"
+#include "RegenerationWindow.h"
+
+class LanguageInit
+{
+public:
+	CComPtr<IServiceProvider> _site;
+};
+
+class ATL_NO_VTABLE Language : 
+	public CComCreatableObject<Language, LanguageInit>,
+	public ISparkLanguage,
+	public IVsLanguageInfo,
+	public IVsProvideColorableItems,
+	public IVsRunningDocTableEvents,
+	public IVsTextManagerEvents,
+	public IVsSelectionEvents,
+	public ISparkLanguageNative,
+	public ISparkDiagnostics
+{
+	// entries are removed when the running document table unlocks the buffer
+	SourceRegistry _sources;
+
+	// loaded when first needed unless configured to start sooner
+	CComPtr<ILanguageSupervisor> _supervisor;
+	SupervisorLoader _supervisorLoader;
+
+	// project contexts keyed by the IUnknown of their hierarchy, dropped when the project closes
+	CComAutoCriticalSection _projectsLock;
+	CAtlMap<IUnknown*, ISparkProjectContext*> _projects;
+
+	CComPtr<IVsRunningDocumentTable> _runningDocumentTable;
+	VSCOOKIE _runningDocumentTableAdvise;
+	DocumentTextCache _documentTexts;
+
+	// c# band followed by spark band, see GetColorableItem. built on first use and
+	// again after fonts and colors change
+	CComAutoCriticalSection _colorableItemsLock;
+	bool _colorableItemsKnown;
+	int _containedItemCount;
+	CInterfaceArray<IVsColorableItem> _colorableItems;
+
+	CComPtr<IVsTextManager> _textManager;
+	DWORD _textManagerAdvise;
+
+	LargeDocumentThresholds _largeDocumentThresholds;
+
+	// every source's regeneration waits in the one queue, the document in the active frame first
+	RegenerationScheduler _regenerationScheduler;
+	RegenerationDispatchWindow _regenerationDispatchWindow;
+	CComPtr<IVsMonitorSelection> _monitorSelection;
+	VSCOOKIE _selectionEventsAdvise;
+	CComPtr<IUnknown> _focusedDocData;
+
+public:
+	Language()
+	{
+		_runningDocumentTableAdvise = 0;
+		_colorableItemsKnown = false;
+		_containedItemCount = 0;
+		_textManagerAdvise = 0;
+		_largeDocumentThresholds.cchSize = 0;
+		_largeDocumentThresholds.cLines = 0;
+		_selectionEventsAdvise = 0;
+	}
+
+	BEGIN_COM_MAP(Language)
+		COM_INTERFACE_ENTRY(ISparkLanguage)
+		COM_INTERFACE_ENTRY(IVsLanguageInfo)
+		COM_INTERFACE_ENTRY(IVsProvideColorableItems)
+		COM_INTERFACE_ENTRY(IVsRunningDocTableEvents)
+		COM_INTERFACE_ENTRY(IVsTextManagerEvents)
+		COM_INTERFACE_ENTRY(IVsSelectionEvents)
+		COM_INTERFACE_ENTRY(ISparkLanguageNative)
+		COM_INTERFACE_ENTRY(ISparkDiagnostics)
+	END_COM_MAP()
+
+	DECLARE_PROTECT_FINAL_CONSTRUCT();
+
+	HRESULT FinalConstruct();
+	void FinalRelease();
+
+	/********** ISparkLanguage **********/
+	STDMETHODIMP GetSupervisor(ILanguageSupervisor** ppSupervisor) 	{EnsureSupervisor(); return _supervisor == NULL ? *ppSupervisor = NULL, S_OK : _supervisor->QueryInterface(ppSupervisor);}
+	STDMETHODIMP SetSupervisor(ILanguageSupervisor* pSupervisor) {_supervisor = pSupervisor; InvalidateColorableItems(); return S_OK;}
+	STDMETHODIMP GetSource(IVsTextBuffer* pBuffer, ISparkSource** ppSource);
+
+	/********** IVsLanguageInfo **********/
+    STDMETHODIMP GetLanguageName( 
+        /* [out] */ __RPC__deref_out_opt BSTR *bstrName)
+	{
+		*bstrName = SysAllocString(L"Spark");
+		return S_OK;
+	}
+    
+    STDMETHODIMP GetFileExtensions( 
+        /* [out] */ __RPC__deref_out_opt BSTR *pbstrExtensions)
+	{
+		*pbstrExtensions = SysAllocString(L".spark");
+		return S_OK;
+	}
+    
+    STDMETHODIMP GetColorizer( 
+        /* [in] */ __RPC__in_opt IVsTextLines *pBuffer,
+        /* [out] */ __RPC__deref_out_opt IVsColorizer **ppColorizer);
+    
+    STDMETHODIMP GetCodeWindowManager( 
+        /* [in] */ __RPC__in_opt IVsCodeWindow *pCodeWin,
+        /* [out] */ __RPC__deref_out_opt IVsCodeWindowManager **ppCodeWinMgr);
+
+
+	/********** IVsProvideColorableItems **********/
+    STDMETHODIMP GetItemCount( 
+        /* [out] */ __RPC__out int *piCount);
+    
+    STDMETHODIMP GetColorableItem( 
+        /* [in] */ int iIndex,
+        /* [out] */ __RPC__deref_out_opt IVsColorableItem **ppItem);
+
+
+	/********** IVsRunningDocTableEvents **********/
+    STDMETHODIMP OnAfterFirstDocumentLock( 
+        /* [in] */ VSCOOKIE docCookie,
+        /* [in] */ VSRDTFLAGS dwRDTLockType,
+        /* [in] */ DWORD dwReadLocksRemaining,
+        /* [in] */ DWORD dwEditLocksRemaining) {return S_OK;}
+    
+    STDMETHODIMP OnBeforeLastDocumentUnlock( 
+        /* [in] */ VSCOOKIE docCookie,
+        /* [in] */ VSRDTFLAGS dwRDTLockType,
+        /* [in] */ DWORD dwReadLocksRemaining,
+        /* [in] */ DWORD dwEditLocksRemaining);
+    
+    STDMETHODIMP OnAfterSave( 
+        /* [in] */ VSCOOKIE docCookie) {return S_OK;}
+    
+    STDMETHODIMP OnAfterAttributeChange( 
+        /* [in] */ VSCOOKIE docCookie,
+        /* [in] */ VSRDTATTRIB grfAttribs) {return S_OK;}
+    
+    STDMETHODIMP OnBeforeDocumentWindowShow( 
+        /* [in] */ VSCOOKIE docCookie,
+        /* [in] */ BOOL fFirstShow,
+        /* [in] */ __RPC__in_opt IVsWindowFrame *pFrame);
+    
+    STDMETHODIMP OnAfterDocumentWindowHide( 
+        /* [in] */ VSCOOKIE docCookie,
+        /* [in] */ __RPC__in_opt IVsWindowFrame *pFrame)
+	{
+		SetFramePriority(pFrame, RegenerationPriorityBackground);
+		return S_OK;
+	}
+
+
+	/********** IVsTextManagerEvents **********/
+    STDMETHODIMP_(void) OnRegisterMarkerType( 
+        /* [in] */ long iMarkerType) {}
+    
+    STDMETHODIMP_(void) OnRegisterView( 
+        /* [in] */ __RPC__in_opt IVsTextView *pView) {}
+    
+    STDMETHODIMP_(void) OnUnregisterView( 
+        /* [in] */ __RPC__in_opt IVsTextView *pView) {}
+    
+    STDMETHODIMP_(void) OnUserPreferencesChanged( 
+        /* [in] */ __RPC__in const VIEWPREFERENCES *pViewPrefs,
+        /* [in] */ __RPC__in const FRAMEPREFERENCES *pFramePrefs,
+        /* [in] */ __RPC__in const LANGPREFERENCES *pLangPrefs,
+        /* [in] */ __RPC__in const FONTCOLORPREFERENCES *pColorPrefs)
+	{
+		if (pColorPrefs != NULL)
+			InvalidateColorableItems();
+	}
+
+
+	/********** IVsSelectionEvents **********/
+    STDMETHODIMP OnSelectionChanged( 
+        /* [in] */ __RPC__in_opt IVsHierarchy *pHierOld,
+        /* [in] */ VSITEMID itemidOld,
+        /* [in] */ __RPC__in_opt IVsMultiItemSelect *pMISOld,
+        /* [in] */ __RPC__in_opt ISelectionContainer *pSCOld,
+        /* [in] */ __RPC__in_opt IVsHierarchy *pHierNew,
+        /* [in] */ VSITEMID itemidNew,
+        /* [in] */ __RPC__in_opt IVsMultiItemSelect *pMISNew,
+        /* [in] */ __RPC__in_opt ISelectionContainer *pSCNew) {return S_OK;}
+    
+    STDMETHODIMP OnElementValueChanged( 
+        /* [in] */ VSSELELEMID elementid,
+        /* [in] */ VARIANT varValueOld,
+        /* [in] */ VARIANT varValueNew);
+    
+    STDMETHODIMP OnCmdUIContextChanged( 
+        /* [in] */ VSCOOKIE dwCmdUICookie,
+        /* [in] */ BOOL fActive) {return S_OK;}
+
+
+	/********** ISparkLanguageNative **********/
+	STDMETHODIMP Close();
+	STDMETHODIMP GetProjectContext(IVsHierarchy* pHierarchy, ISparkProjectContext** ppContext);
+	STDMETHODIMP GetRunningDocumentText(BSTR canonicalName, BSTR* pText);
+	STDMETHODIMP GetLargeDocumentThresholds(LargeDocumentThresholds* pThresholds)
+	{
+		*pThresholds = _largeDocumentThresholds;
+		return S_OK;
+	}
+	STDMETHODIMP GetRegenerationScheduler(RegenerationScheduler** ppScheduler)
+	{
+		*ppScheduler = &_regenerationScheduler;
+		return S_OK;
+	}
+	STDMETHODIMP ScheduleDependentRegenerations(ISparkSource* pChanged, LPCWSTR canonicalName);
+
+	/********** ISparkDiagnostics **********/
+	STDMETHODIMP GetCounter(SparkCounter counter, LONGLONG* pValue)
+	{
+		Diagnostics::Block block;
+		_sources.ReadDiagnostics(block);
+		return Diagnostics::GetCounter(block, counter, pValue);
+	}
+
+	STDMETHODIMP GetHistogram(SparkTiming timing, long cBuckets, LONGLONG* rgCounts, long* pcBuckets)
+	{
+		Diagnostics::Block block;
+		_sources.ReadDiagnostics(block);
+		return Diagnostics::GetHistogram(block, timing, cBuckets, rgCounts, pcBuckets);
+	}
+
+	STDMETHODIMP Dump(BSTR* pText)
+	{
+		Diagnostics::Block block;
+		_sources.ReadDiagnostics(block);
+		return Diagnostics::Dump(block, pText);
+	}
+
+	STDMETHODIMP Reset()
+	{
+		_sources.ResetDiagnostics();
+		return S_OK;
+	}
+
+private:
+	void RemoveSource(IUnknown* pBuffer);
+	void RemoveProjectContext(IUnknown* pHierarchy);
+	HRESULT EnsureSupervisor();
+	void InvalidateColorableItems();
+	HRESULT EnsureColorableItems();
+	void SetFramePriority(IVsWindowFrame* pFrame, RegenerationPriority priority);
+	void SetDocDataPriority(IUnknown* pDocData, RegenerationPriority priority);
+};
+
@@ -0,0 +1,44 @@
+
+#pragma once
+
+#include "LanguageSettings.h"
+#include "RegenerationScheduler.h"
+
+// Project-level facts shared by every source in one hierarchy. Not part of the type library.
+interface __declspec(uuid("235a7259-5571-411b-a066-49625b1e1388")) __declspec(novtable) 
+ISparkProjectContext : public IUnknown
+{
+	// resolved through the item context of the first document asking for it
+	STDMETHOD(GetIntellisenseProjectManager)(VSITEMID itemid, IVsIntellisenseProjectManager** ppProjectManager) PURE;
+
+	// remembered until the project's references change
+	STDMETHOD(GetDefaultPageBaseType)(BSTR* pPageBaseType) PURE;
+
+	// stops listening to the project
+	STDMETHOD(Close)() PURE;
+};
+
+// In-process view of the Language used by the package and sources. Not part of the type library.
+interface __declspec(uuid("a0827409-8124-44e6-80d0-324df7ad5ddd")) __declspec(novtable) 
+ISparkLanguageNative : public IUnknown
+{
+	// stops listening to the environment and releases every registered source
+	STDMETHOD(Close)() PURE;
+
+	// the shared context of a project, created on first use
+	STDMETHOD(GetProjectContext)(IVsHierarchy* pHierarchy, ISparkProjectContext** ppContext) PURE;
+
+	// text of an open document, copied out of its buffer only when it has changed
+	STDMETHOD(GetRunningDocumentText)(BSTR canonicalName, BSTR* pText) PURE;
+
+	// read from the registry once, when the language is created
+	STDMETHOD(GetLargeDocumentThresholds)(LargeDocumentThresholds* pThresholds) PURE;
+
+	// the queue every source regenerates from, alive as long as the language. closed
+	// when there's no window to dispatch it - sources then regenerate as soon as asked
+	STDMETHOD(GetRegenerationScheduler)(RegenerationScheduler** ppScheduler) PURE;
+
+	// a document is regenerating - every other open source whose last generation read 
+	// it is queued to regenerate as well
+	STDMETHOD(ScheduleDependentRegenerations)(ISparkSource* pChanged, LPCWSTR canonicalName) PURE;
+};
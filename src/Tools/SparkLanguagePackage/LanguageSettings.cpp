@@ -0,0 +1,45 @@
+
+#include "stdafx.h"
+#include "LanguageSettings.h"
+
+bool LanguageSettings::ReadDWORD(IServiceProvider* pSite, const WCHAR* pszName, DWORD* pdwValue)
+{
+	HRESULT hr = S_OK;
+	CComPtr<ILocalRegistry2> localRegistry;
+	_HR(pSite->QueryService(SID_SLocalRegistry, &localRegistry));
+
+	CComBSTR root;
+	_HR(localRegistry->GetLocalRegistryRoot(&root));
+	if (FAILED(hr))
+		return false;
+
+	CStringW path(root);
+	path += L"\\Languages\\Language Services\\Spark";
+
+	HKEY rgRoots[] = {HKEY_CURRENT_USER, HKEY_LOCAL_MACHINE};
+	for (int index = 0; index != _countof(rgRoots); ++index)
+	{
+		CRegKey key;
+		if (key.Open(rgRoots[index], path, KEY_READ) == ERROR_SUCCESS &&
+			key.QueryDWORDValue(pszName, *pdwValue) == ERROR_SUCCESS)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+LargeDocumentThresholds LanguageSettings::ReadLargeDocumentThresholds(IServiceProvider* pSite)
+{
+	// a couple of megabytes, or more lines than any hand written view has
+	LargeDocumentThresholds thresholds;
+	thresholds.cchSize = 1024 * 1024;
+	thresholds.cLines = 25000;
+
+	DWORD dwValue = 0;
+	if (ReadDWORD(pSite, L"LargeDocumentSize", &dwValue) && dwValue <= LONG_MAX)
+		thresholds.cchSize = (long)dwValue;
+	if (ReadDWORD(pSite, L"LargeDocumentLines", &dwValue) && dwValue <= LONG_MAX)
+		thresholds.cLines = (long)dwValue;
+	return thresholds;
+}
@@ -0,0 +1,22 @@
+
+#pragma once
+
+// Past either limit a source runs in large document mode - buffer text is read only when 
+// generation is wanted, markup is painted by the colorizer line by line, and generation 
+// waits for intellisense to ask. A limit of 0 is never reached.
+struct LargeDocumentThresholds
+{
+	long cchSize;
+	long cLines;
+};
+
+// Values of the Spark language service registry key - per-user settings win over the 
+// machine-wide registration
+class LanguageSettings
+{
+public:
+	static bool ReadDWORD(IServiceProvider* pSite, const WCHAR* pszName, DWORD* pdwValue);
+
+	// the LargeDocumentSize and LargeDocumentLines values, in characters and lines
+	static LargeDocumentThresholds ReadLargeDocumentThresholds(IServiceProvider* pSite);
+};
@@ -0,0 +1,258 @@
+
+#include "stdafx.h"
+#include "LineIndex.h"
+
+void LineIndex::Build(const WCHAR* pText, long length)
+{
+	Clear();
+
+	// same line breaks as the editor, found by the table
+	_scan.Build(pText, length);
+	long cLines = _scan.GetLineCount();
+	_lengths.SetCount(cLines);
+	for (long iLine = 0; iLine != cLines; ++iLine)
+		_lengths[iLine] = _scan.GetLineStart(iLine + 1) - _scan.GetLineStart(iLine);
+
+	_root = BuildRange(_lengths.GetData(), cLines, 0);
+}
+
+void LineIndex::Clear()
+{
+	_nodes.RemoveAll();
+	_root = -1;
+	_free = -1;
+}
+
+long LineIndex::Allocate(long length, ULONG priority)
+{
+	long node = _free;
+	if (node != -1)
+		_free = _nodes[node].left;
+	else
+		node = (long)_nodes.Add(Node());
+
+	Node& created = _nodes[node];
+	created.left = -1;
+	created.right = -1;
+	created.priority = priority;
+	created.length = length;
+	created.lines = 1;
+	created.chars = length;
+	return node;
+}
+
+void LineIndex::FreeTree(long node)
+{
+	_path.RemoveAll();
+	if (node != -1)
+		_path.Add(node);
+
+	while (!_path.IsEmpty())
+	{
+		long freed = _path[_path.GetCount() - 1];
+		_path.SetCount(_path.GetCount() - 1);
+		if (_nodes[freed].left != -1)
+			_path.Add(_nodes[freed].left);
+		if (_nodes[freed].right != -1)
+			_path.Add(_nodes[freed].right);
+
+		_nodes[freed].left = _free;
+		_free = freed;
+	}
+}
+
+ULONG LineIndex::Random()
+{
+	// xorshift - only needs to be unrelated to line order
+	_seed ^= _seed << 13;
+	_seed ^= _seed >> 17;
+	_seed ^= _seed << 5;
+	return _seed;
+}
+
+void LineIndex::Update(long node)
+{
+	Node& updated = _nodes[node];
+	updated.lines = 1 + Lines(updated.left) + Lines(updated.right);
+	updated.chars = updated.length + Chars(updated.left) + Chars(updated.right);
+}
+
+long LineIndex::BuildRange(const long* rgLengths, long cLines, long depth)
+{
+	if (cLines == 0)
+		return -1;
+
+	// balanced from the start - priorities fall with depth so the shape is a valid treap
+	long middle = cLines / 2;
+	ULONG tier = depth < 31 ? 31 - depth : 0;
+	long node = Allocate(rgLengths[middle], (tier << 26) | (Random() & 0x3FFFFFF));
+
+	long left = BuildRange(rgLengths, middle, depth + 1);
+	long right = BuildRange(rgLengths + middle + 1, cLines - middle - 1, depth + 1);
+	_nodes[node].left = left;
+	_nodes[node].right = right;
+	Update(node);
+	return node;
+}
+
+void LineIndex::Split(long node, long cLines, long* pLeft, long* pRight)
+{
+	// one walk down - each node goes to whichever side it falls on, in the place the 
+	// last node on that side left open. totals are fixed on the way back up
+	long* pLeftHole = pLeft;
+	long* pRightHole = pRight;
+	_path.RemoveAll();
+	while (node != -1)
+	{
+		_path.Add(node);
+		long cLeftLines = Lines(_nodes[node].left);
+		if (cLines <= cLeftLines)
+		{
+			*pRightHole = node;
+			pRightHole = &_nodes[node].left;
+			node = _nodes[node].left;
+		}
+		else
+		{
+			*pLeftHole = node;
+			pLeftHole = &_nodes[node].right;
+			cLines -= cLeftLines + 1;
+			node = _nodes[node].right;
+		}
+	}
+	*pLeftHole = -1;
+	*pRightHole = -1;
+
+	for (size_t index = _path.GetCount(); index != 0; --index)
+		Update(_path[index - 1]);
+}
+
+long LineIndex::Merge(long left, long right)
+{
+	// down the right edge of the left tree and the left edge of the right one, taking 
+	// the higher priority of the two each step
+	long root = -1;
+	long* pHole = &root;
+	_path.RemoveAll();
+	while (left != -1 && right != -1)
+	{
+		if (_nodes[left].priority > _nodes[right].priority)
+		{
+			*pHole = left;
+			_path.Add(left);
+			pHole = &_nodes[left].right;
+			left = _nodes[left].right;
+		}
+		else
+		{
+			*pHole = right;
+			_path.Add(right);
+			pHole = &_nodes[right].left;
+			right = _nodes[right].left;
+		}
+	}
+	*pHole = left != -1 ? left : right;
+
+	for (size_t index = _path.GetCount(); index != 0; --index)
+		Update(_path[index - 1]);
+	return root;
+}
+
+void LineIndex::ReplaceLines(long iFirstLine, long cOldLines, const long* rgLengths, long cNewLines)
+{
+	long before = -1;
+	long rest = -1;
+	long removed = -1;
+	long after = -1;
+	Split(_root, iFirstLine, &before, &rest);
+	Split(rest, cOldLines, &removed, &after);
+	FreeTree(removed);
+
+	long inserted = -1;
+	for (long index = 0; index != cNewLines; ++index)
+		inserted = Merge(inserted, Allocate(rgLengths[index], Random()));
+
+	_root = Merge(Merge(before, inserted), after);
+}
+
+long LineIndex::GetLineStart(long iLine) const
+{
+	if (iLine <= 0)
+		return 0;
+	if (iLine >= GetLineCount())
+		return GetLength();
+
+	long iPosition = 0;
+	long node = _root;
+	for (;;)
+	{
+		const Node& current = _nodes[node];
+		long cLeftLines = Lines(current.left);
+		if (iLine < cLeftLines)
+		{
+			node = current.left;
+		}
+		else if (iLine == cLeftLines)
+		{
+			return iPosition + Chars(current.left);
+		}
+		else
+		{
+			iLine -= cLeftLines + 1;
+			iPosition += Chars(current.left) + current.length;
+			node = current.right;
+		}
+	}
+}
+
+void LineIndex::GetLineIndexOfPosition(long iPosition, long* piLine, long* piIndex) const
+{
+	long length = GetLength();
+	if (iPosition < 0)
+		iPosition = 0;
+
+	// the end of the text is on the last line, even right after a line break
+	if (iPosition >= length)
+	{
+		long iLastLine = GetLineCount() - 1;
+		*piLine = iLastLine < 0 ? 0 : iLastLine;
+		*piIndex = length - GetLineStart(*piLine);
+		return;
+	}
+
+	long iLine = 0;
+	long node = _root;
+	for (;;)
+	{
+		const Node& current = _nodes[node];
+		long cLeftChars = Chars(current.left);
+		if (iPosition < cLeftChars)
+		{
+			node = current.left;
+		}
+		else if (iPosition < cLeftChars + current.length)
+		{
+			*piLine = iLine + Lines(current.left);
+			*piIndex = iPosition - cLeftChars;
+			return;
+		}
+		else
+		{
+			iLine += Lines(current.left) + 1;
+			iPosition -= cLeftChars + current.length;
+			node = current.right;
+		}
+	}
+}
+
+long LineIndex::GetPositionOfLineIndex(long iLine, long iIndex) const
+{
+	long length = GetLength();
+	if (iLine < 0)
+		return 0;
+	if (iLine >= GetLineCount())
+		return length;
+
+	long iPosition = GetLineStart(iLine) + iIndex;
+	return iPosition < length ? iPosition : length;
+}
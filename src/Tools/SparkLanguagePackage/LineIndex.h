@@ -0,0 +1,71 @@
+
+#pragma once
+
+#include "LineTable.h"
+
+// Lengths of every line of a buffer kept in an implicit treap, so an edit replaces the
+// lines it touched in O(log n) and positions convert to line/index and back without
+// asking the buffer. A line's length includes its line break - the last line has none.
+class LineIndex
+{
+	struct Node
+	{
+		long left;
+		long right;
+		ULONG priority;
+		long length;
+
+		// totals of the subtree under this node
+		long lines;
+		long chars;
+	};
+
+	PooledArray<Node> _nodes;
+	long _root;
+	long _free;
+	ULONG _seed;
+
+	// line starts when building from text, lengths when building a run of lines
+	LineTable _scan;
+	PooledArray<long> _lengths;
+
+	// nodes whose totals need updating after a split or merge, or still to be freed. the 
+	// tree's depth is only logarithmic on average, so none of it recurses
+	PooledArray<long> _path;
+
+public:
+	LineIndex()
+	{
+		_root = -1;
+		_free = -1;
+		_seed = 0x9E3779B9;
+	}
+
+	void Build(const WCHAR* pText, long length);
+	void Clear();
+
+	long GetLength() const {return _root == -1 ? 0 : _nodes[_root].chars;}
+	long GetLineCount() const {return _root == -1 ? 0 : _nodes[_root].lines;}
+
+	// GetLineStart(GetLineCount()) is the length of the text
+	long GetLineStart(long iLine) const;
+
+	void GetLineIndexOfPosition(long iPosition, long* piLine, long* piIndex) const;
+	long GetPositionOfLineIndex(long iLine, long iIndex) const;
+
+	// replaces cOldLines lines from iFirstLine with lines of the given lengths
+	void ReplaceLines(long iFirstLine, long cOldLines, const long* rgLengths, long cNewLines);
+
+private:
+	long Allocate(long length, ULONG priority);
+	void FreeTree(long node);
+	ULONG Random();
+
+	long Lines(long node) const {return node == -1 ? 0 : _nodes[node].lines;}
+	long Chars(long node) const {return node == -1 ? 0 : _nodes[node].chars;}
+	void Update(long node);
+
+	long BuildRange(const long* rgLengths, long cLines, long depth);
+	void Split(long node, long cLines, long* pLeft, long* pRight);
+	long Merge(long left, long right);
+};
@@ -0,0 +1,99 @@
+
+#include "stdafx.h"
+#include "LineTable.h"
+
+void LineTable::Build(const WCHAR* pText, long length)
+{
+	_starts.RemoveAll();
+	_length = length;
+
+	_starts.Add(0);
+	for (long index = 0; index != length; ++index)
+	{
+		WCHAR ch = pText[index];
+		if (ch > L'\r' && ch != 0x2028 && ch != 0x2029)
+			continue;
+
+		if (ch == L'\r')
+		{
+			if (index + 1 != length && pText[index + 1] == L'\n')
+				++index;
+			_starts.Add(index + 1);
+		}
+		else if (ch == L'\n' || ch == 0x2028 || ch == 0x2029)
+		{
+			_starts.Add(index + 1);
+		}
+	}
+}
+
+long LineTable::FindLine(long iPosition) const
+{
+	// last line starting at or before the position
+	size_t low = 0;
+	size_t high = _starts.GetCount();
+	while (high - low > 1)
+	{
+		size_t middle = low + (high - low) / 2;
+		if (_starts[middle] <= iPosition)
+			low = middle;
+		else
+			high = middle;
+	}
+	return (long)low;
+}
+
+void LineTable::GetLineIndexOfPosition(long iPosition, long* piLine, long* piIndex) const
+{
+	if (iPosition < 0)
+		iPosition = 0;
+	if (iPosition > _length)
+		iPosition = _length;
+
+	*piLine = FindLine(iPosition);
+	*piIndex = iPosition - _starts[*piLine];
+}
+
+void LineTable::Walker::GetLineIndexOfPosition(long iPosition, long* piLine, long* piIndex)
+{
+	const long maximumWalk = 8;
+
+	if (iPosition < 0)
+		iPosition = 0;
+	if (iPosition > _table._length)
+		iPosition = _table._length;
+
+	long iLine = _iLine;
+	if (iPosition < _table.GetLineStart(iLine))
+	{
+		iLine = _table.FindLine(iPosition);
+	}
+	else
+	{
+		long walked = 0;
+		while (iLine + 1 < _table.GetLineCount() && _table._starts[iLine + 1] <= iPosition)
+		{
+			if (++walked == maximumWalk)
+			{
+				iLine = _table.FindLine(iPosition);
+				break;
+			}
+			++iLine;
+		}
+	}
+
+	_iLine = iLine;
+	*piLine = iLine;
+	*piIndex = iPosition - _table._starts[iLine];
+}
+
+long LineTable::GetPositionOfLineIndex(long iLine, long iIndex) const
+{
+	if (iLine < 0)
+		return 0;
+	if (iLine >= GetLineCount())
+		return _length;
+
+	long iPosition = _starts[iLine] + iIndex;
+	return iPosition < _length ? iPosition : _length;
+}
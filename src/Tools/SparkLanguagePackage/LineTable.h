@@ -0,0 +1,54 @@
+
+#pragma once
+
+#include "PooledArray.h"
+
+// Offsets of the first character of every line in a block of text, found in one pass.
+// Line breaks are recognized the same way the editor's text buffers recognize them.
+class LineTable
+{
+	PooledArray<long> _starts;
+	long _length;
+
+public:
+	LineTable()
+	{
+		_length = 0;
+	}
+
+	void Build(const WCHAR* pText, long length);
+
+	void Swap(LineTable& other)
+	{
+		_starts.Swap(other._starts);
+		long length = _length; _length = other._length; other._length = length;
+	}
+
+	long GetLength() const {return _length;}
+	long GetLineCount() const {return (long)_starts.GetCount();}
+
+	// GetLineStart(GetLineCount()) is the length of the text
+	long GetLineStart(long iLine) const
+	{
+		return iLine < GetLineCount() ? _starts[iLine] : _length;
+	}
+
+	void GetLineIndexOfPosition(long iPosition, long* piLine, long* piIndex) const;
+	long GetPositionOfLineIndex(long iLine, long iIndex) const;
+
+	// Converts a series of positions. Positions that arrive in increasing order are found 
+	// by walking forward from the previous line, anything further away by binary search.
+	class Walker
+	{
+		const LineTable& _table;
+		long _iLine;
+
+	public:
+		Walker(const LineTable& table) : _table(table), _iLine(0) {}
+
+		void GetLineIndexOfPosition(long iPosition, long* piLine, long* piIndex);
+	};
+
+private:
+	long FindLine(long iPosition) const;
+};
@@ -0,0 +1,704 @@
+
+#include "stdafx.h"
+#include "MarkupTokenizer.h"
+
+// character classes of the ascii range, fixed at compile time
+enum
+{
+	CharSpace = 0x01,
+	CharNameStart = 0x02,
+	CharName = 0x04,
+	// may begin markup, code or an entity inside text
+	CharMarkup = 0x08,
+};
+
+#define S CharSpace
+#define N (CharNameStart | CharName)
+#define D CharName
+#define M CharMarkup
+
+static const unsigned char s_charClass[128] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 0, S, S|M, 0, 0, S, 0, 0,		// \t \n \r
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	S, M, 0, 0, M, 0, M, 0, 0, 0, 0, 0, 0, D, D, 0,		// space ! $ & - .
+	D, D, D, D, D, D, D, D, D, D, N, 0, M, 0, 0, M,		// 0-9 : < ?
+	0, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N,		// A-O
+	N, N, N, N, N, N, N, N, N, N, N, 0, M, 0, 0, N,		// P-Z \ _
+	M, N, N, N, N, N, N, N, N, N, N, N, N, N, N, N,		// ` a-o
+	N, N, N, N, N, N, N, N, N, N, N, 0, 0, 0, 0, 0,		// p-z
+};
+
+#undef S
+#undef N
+#undef D
+#undef M
+
+static inline bool IsClass(WCHAR ch, unsigned char charClass)
+{
+	return ch < 128 && (s_charClass[ch] & charClass) != 0;
+}
+
+// packing of MarkupState and the details which go with it
+enum
+{
+	StateKindMask = 0x0f,
+	StateReturnShift = 4,
+	StateReturnMask = 0x30,
+	StateIgnoreTag = 0x40,
+	StateVerbatim = 0x80,
+	StateSlash = 0x100,
+	StateDepthShift = 9,
+	StateDepthMask = 0x7ffffe00,
+	StateDepthMaximum = StateDepthMask >> StateDepthShift,
+};
+
+static inline long Kind(long state) {return state & StateKindMask;}
+static inline long WithKind(long state, long kind) {return (state & ~StateKindMask) | kind;}
+static inline long Depth(long state) {return (state & StateDepthMask) >> StateDepthShift;}
+static inline long WithDepth(long state, long depth)
+{
+	if (depth > StateDepthMaximum)
+		depth = StateDepthMaximum;
+	return (state & ~StateDepthMask) | (depth << StateDepthShift);
+}
+
+// code blocks return to text or to the attribute value they were written in
+static inline long CodeReturn(long kind)
+{
+	if (kind == MarkupStateValueDouble)
+		return 1;
+	if (kind == MarkupStateValueSingle)
+		return 2;
+	return 0;
+}
+
+static inline long CodeReturnKind(long state)
+{
+	switch ((state & StateReturnMask) >> StateReturnShift)
+	{
+	case 1: return MarkupStateValueDouble;
+	case 2: return MarkupStateValueSingle;
+	}
+	return MarkupStateText;
+}
+
+void MarkupTokenizer::Tokenize(const WCHAR* text, long length, PooledArray<SourcePainting>& paints)
+{
+	paints.RemoveAll();
+	MarkupTokenizer tokenizer(text, length, &paints);
+	tokenizer.Run(MarkupStateText);
+}
+
+long MarkupTokenizer::GetStateAtEndOfLine(const WCHAR* text, long length, long state)
+{
+	MarkupTokenizer tokenizer(text, length, NULL);
+	return tokenizer.Run(state);
+}
+
+// minified templates put tens of thousands of characters on one line - long runs are 
+// stored four attributes at a time once the pointer is aligned, short ones as they are
+void MarkupTokenizer::FillAttributes(ULONG* pAttributes, long count, ULONG value)
+{
+	long index = 0;
+	if (count >= 16)
+	{
+		while (((UINT_PTR)(pAttributes + index) & 15) != 0)
+			pAttributes[index++] = value;
+
+		const __m128i wide = _mm_set1_epi32((int)value);
+		for (; index + 8 <= count; index += 8)
+		{
+			_mm_store_si128((__m128i*)(pAttributes + index), wide);
+			_mm_store_si128((__m128i*)(pAttributes + index + 4), wide);
+		}
+	}
+
+	for (; index < count; ++index)
+		pAttributes[index] = value;
+}
+
+long MarkupTokenizer::ColorizeLine(const WCHAR* text, long length, long state, ULONG colorOffset, ULONG* pAttributes)
+{
+	FillAttributes(pAttributes, length + 1, 0);
+
+	MarkupTokenizer tokenizer(text, length, NULL);
+	tokenizer._attributes = pAttributes;
+	tokenizer._colorOffset = colorOffset;
+	return tokenizer.Run(state);
+}
+
+long MarkupTokenizer::Run(long state)
+{
+	long pos = 0;
+	while (pos < _length)
+	{
+		switch (Kind(state))
+		{
+		case MarkupStateTag:
+		case MarkupStateAttributeName:
+		case MarkupStateAttributeEquals:
+			pos = LexTag(pos, state);
+			break;
+		case MarkupStateValueDouble:
+		case MarkupStateValueSingle:
+			pos = LexAttributeValue(pos, state);
+			break;
+		case MarkupStateCode:
+		case MarkupStateAspx:
+			pos = LexCode(pos, state);
+			break;
+		case MarkupStateComment:
+			pos = LexComment(pos, state);
+			break;
+		case MarkupStateIgnore:
+			pos = LexIgnore(pos, state);
+			break;
+		case MarkupStateStatement:
+			pos = LexStatement(pos, state);
+			break;
+		default:
+			pos = LexText(pos, state);
+			break;
+		}
+	}
+
+	// a statement never outlives its line
+	if (Kind(state) == MarkupStateStatement)
+		state = MarkupStateText;
+	return state;
+}
+
+long MarkupTokenizer::LexText(long pos, long& state)
+{
+	// S? '#' at the start of a line begins a statement
+	if (pos == 0 || _text[pos - 1] == L'\n')
+	{
+		long marker = pos;
+		while (marker < _length && (_text[marker] == L' ' || _text[marker] == L'\t'))
+			++marker;
+		if (marker < _length && _text[marker] == L'#')
+		{
+			Paint(marker, marker + 1, MarkupColorSparkDelimiter);
+			state = MarkupStateStatement;
+			return marker + 1;
+		}
+	}
+
+	pos = FindMarkup(pos);
+	if (pos >= _length)
+		return pos;
+
+	switch (_text[pos])
+	{
+	case L'\n':
+		return pos + 1;
+
+	case L'<':
+		if (At(pos, L"<!--"))
+		{
+			Paint(pos, pos + 4, MarkupColorHtmlComment);
+			state = MarkupStateComment;
+			return pos + 4;
+		}
+		if (At(pos, L"<%"))
+		{
+			Paint(pos, pos + 2, MarkupColorHtmlServerSideScript);
+			state = MarkupStateAspx;
+			if (pos + 2 < _length && _text[pos + 2] == L'=')
+			{
+				Paint(pos + 2, pos + 3, MarkupColorHtmlOperator);
+				return pos + 3;
+			}
+			return pos + 2;
+		}
+		else
+		{
+			// '<' Name or '</' Name, with the rest of the tag lexed as its own state
+			long nameStart = pos + (At(pos, L"</") ? 2 : 1);
+			long nameEnd = ScanName(nameStart);
+			if (nameEnd == nameStart)
+				return pos + 1;
+
+			_tagStart = pos;
+			_tagPaints = _paints != NULL ? _paints->GetCount() : 0;
+			Paint(pos, nameStart, MarkupColorHtmlTagDelimiter);
+			Paint(nameStart, nameEnd, MarkupColorHtmlElementName);
+			state = MarkupStateTag;
+			if (nameStart == pos + 1 && nameEnd - nameStart == 6 && At(nameStart, L"ignore"))
+				state |= StateIgnoreTag;
+			return nameEnd;
+		}
+
+	case L'&':
+		{
+			long end = ScanEntity(pos);
+			if (end == pos)
+				return pos + 1;
+			Paint(pos, end, MarkupColorHtmlEntity);
+			return end;
+		}
+	}
+
+	long opener = MatchCodeOpener(pos, true);
+	if (opener == 0)
+		return pos + 1;
+
+	Paint(pos, pos + opener, MarkupColorSparkDelimiter);
+	state = MarkupStateCode;
+	return pos + opener;
+}
+
+long MarkupTokenizer::LexTag(long pos, long& state)
+{
+	// a '/' must be right before the tag's '>' - anything between, a line break included, 
+	// and it isn't a tag
+	bool fSlash = (state & StateSlash) != 0;
+	long start = pos;
+	pos = SkipWhitespace(pos);
+	if (pos >= _length)
+		return pos;
+	if (fSlash && (pos != start || pos == 0 || _text[pos] != L'>'))
+		return RejectTag(pos, state);
+
+	WCHAR ch = _text[pos];
+	switch (Kind(state))
+	{
+	case MarkupStateAttributeName:
+		// Name S? '=' S? Quote - the grammar takes nothing less as an attribute
+		if (ch == L'=')
+		{
+			Paint(pos, pos + 1, MarkupColorHtmlOperator);
+			state = WithKind(state, MarkupStateAttributeEquals);
+			return pos + 1;
+		}
+		return RejectTag(pos, state);
+
+	case MarkupStateAttributeEquals:
+		if (ch == L'"' || ch == L'\'')
+		{
+			Paint(pos, pos + 1, MarkupColorHtmlAttributeValue);
+			state = WithKind(state, ch == L'"' ? MarkupStateValueDouble : MarkupStateValueSingle);
+			return pos + 1;
+		}
+		return RejectTag(pos, state);
+	}
+
+	if (ch == L'/')
+	{
+		Paint(pos, pos + 1, MarkupColorHtmlTagDelimiter);
+		state |= StateSlash;
+		return pos + 1;
+	}
+
+	if (ch == L'>')
+	{
+		// the content of <ignore> is passed through untouched, unless the tag closed itself
+		bool fIgnore = (state & StateIgnoreTag) != 0 && !fSlash;
+		Paint(pos, pos + 1, MarkupColorHtmlTagDelimiter);
+		state = fIgnore ? MarkupStateIgnore : MarkupStateText;
+		_tagStart = -1;
+		return pos + 1;
+	}
+
+	long nameEnd = ScanName(pos);
+	if (nameEnd != pos)
+	{
+		Paint(pos, nameEnd, MarkupColorHtmlAttributeName);
+		state = WithKind(state, MarkupStateAttributeName);
+		return nameEnd;
+	}
+
+	return RejectTag(pos, state);
+}
+
+long MarkupTokenizer::RejectTag(long pos, long& state)
+{
+	// not a tag after all, and the grammar reads all of it as text. if it began in this 
+	// text its paints are taken back and it's lexed again from after the '<'
+	state = MarkupStateText;
+	if (_tagStart == -1)
+		return pos;
+
+	if (_attributes != NULL)
+		FillAttributes(_attributes + _tagStart, pos - _tagStart, 0);
+	if (_paints != NULL)
+		_paints->SetCount(_tagPaints);
+
+	long restart = _tagStart + 1;
+	_tagStart = -1;
+	return restart;
+}
+
+long MarkupTokenizer::LexAttributeValue(long pos, long& state)
+{
+	WCHAR quote = Kind(state) == MarkupStateValueDouble ? L'"' : L'\'';
+
+	// runs of plain value text are painted between the code and entities inside
+	long end = pos;
+	while (end < _length)
+	{
+		WCHAR ch = _text[end];
+		if (ch == quote)
+		{
+			Paint(pos, end + 1, MarkupColorHtmlAttributeValue);
+			state = WithKind(state, MarkupStateTag);
+			return end + 1;
+		}
+
+		if (ch == L'&')
+		{
+			// an '&' which doesn't start an entity is left unpainted, as a '<' is
+			long entityEnd = ScanEntity(end);
+			Paint(pos, end, MarkupColorHtmlAttributeValue);
+			if (entityEnd == end)
+				return end + 1;
+			Paint(end, entityEnd, MarkupColorHtmlEntity);
+			return entityEnd;
+		}
+		else if (ch == L'<')
+		{
+			Paint(pos, end, MarkupColorHtmlAttributeValue);
+			return end + 1;
+		}
+		else if (ch == L'$' || ch == L'!' || ch == L'?')
+		{
+			long opener = MatchCodeOpener(end, false);
+			if (opener != 0)
+			{
+				Paint(pos, end, MarkupColorHtmlAttributeValue);
+				Paint(end, end + opener, MarkupColorSparkDelimiter);
+				state = WithDepth((state & StateIgnoreTag) | MarkupStateCode | (CodeReturn(Kind(state)) << StateReturnShift), 0);
+				return end + opener;
+			}
+		}
+		++end;
+	}
+
+	Paint(pos, end, MarkupColorHtmlAttributeValue);
+	return end;
+}
+
+long MarkupTokenizer::LexCode(long pos, long& state)
+{
+	// a verbatim string may carry on from the previous line
+	if (state & StateVerbatim)
+		pos = ScanString(pos, state);
+
+	bool fAspx = Kind(state) == MarkupStateAspx;
+	long depth = Depth(state);
+	long end = pos;
+	while (end < _length && (state & StateVerbatim) == 0)
+	{
+		WCHAR ch = _text[end];
+		if (ch == L'"' || ch == L'\'' || (ch == L'@' && end + 1 < _length && _text[end + 1] == L'"'))
+		{
+			end = ScanString(end, state);
+			continue;
+		}
+		if (ch == L'/' && end + 1 < _length && _text[end + 1] == L'/')
+		{
+			end = ScanLineComment(end);
+			continue;
+		}
+		if (ch == L'#')
+		{
+			end = ScanLateBound(end);
+			continue;
+		}
+
+		if (fAspx)
+		{
+			if (ch == L'%' && end + 1 < _length && _text[end + 1] == L'>')
+			{
+				Paint(end, end + 2, MarkupColorHtmlServerSideScript);
+				state = MarkupStateText;
+				return end + 2;
+			}
+		}
+		else if (ch == L'{')
+		{
+			++depth;
+		}
+		else if (ch == L'}')
+		{
+			if (depth == 0)
+			{
+				Paint(end, end + 1, MarkupColorSparkDelimiter);
+				state = WithKind(state & StateIgnoreTag, CodeReturnKind(state));
+				return end + 1;
+			}
+			--depth;
+		}
+		++end;
+	}
+
+	state = WithDepth(state, depth);
+	return _length;
+}
+
+long MarkupTokenizer::LexComment(long pos, long& state)
+{
+	long end = pos;
+	while (end < _length && !At(end, L"-->"))
+		++end;
+
+	if (end >= _length)
+	{
+		Paint(pos, _length, MarkupColorHtmlComment);
+		return _length;
+	}
+
+	Paint(pos, end + 3, MarkupColorHtmlComment);
+	state = MarkupStateText;
+	return end + 3;
+}
+
+long MarkupTokenizer::LexIgnore(long pos, long& state)
+{
+	// everything up to and including </ignore> is left as it is
+	long end = pos;
+	while (end < _length && !At(end, L"</ignore>"))
+		++end;
+
+	if (end >= _length)
+		return _length;
+	state = MarkupStateText;
+	return end + 9;
+}
+
+long MarkupTokenizer::LexStatement(long pos, long& state)
+{
+	long end = pos;
+	while (end < _length && _text[end] != L'\n')
+	{
+		WCHAR ch = _text[end];
+		if (ch == L'"' || ch == L'\'' || (ch == L'@' && end + 1 < _length && _text[end + 1] == L'"'))
+		{
+			end = ScanString(end, state);
+
+			// statements end with the line even in a verbatim string
+			state &= ~StateVerbatim;
+			continue;
+		}
+		if (ch == L'/' && end + 1 < _length && _text[end + 1] == L'/')
+		{
+			end = ScanLineComment(end);
+			continue;
+		}
+		if (ch == L'#')
+		{
+			end = ScanLateBound(end);
+			continue;
+		}
+		++end;
+	}
+
+	if (end < _length)
+		state = MarkupStateText;
+	return end;
+}
+
+long MarkupTokenizer::FindMarkup(long pos) const
+{
+	const __m128i lt = _mm_set1_epi16(L'<');
+	const __m128i amp = _mm_set1_epi16(L'&');
+	const __m128i dollar = _mm_set1_epi16(L'$');
+	const __m128i bang = _mm_set1_epi16(L'!');
+	const __m128i question = _mm_set1_epi16(L'?');
+	const __m128i backslash = _mm_set1_epi16(L'\\');
+	const __m128i backtick = _mm_set1_epi16(L'`');
+	const __m128i newline = _mm_set1_epi16(L'\n');
+
+	while (pos + 8 <= _length)
+	{
+		__m128i chars = _mm_loadu_si128((const __m128i*)(_text + pos));
+		__m128i hits = _mm_or_si128(
+			_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi16(chars, lt), _mm_cmpeq_epi16(chars, amp)),
+				_mm_or_si128(_mm_cmpeq_epi16(chars, dollar), _mm_cmpeq_epi16(chars, bang))),
+			_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi16(chars, question), _mm_cmpeq_epi16(chars, backslash)),
+				_mm_or_si128(_mm_cmpeq_epi16(chars, backtick), _mm_cmpeq_epi16(chars, newline))));
+
+		int mask = _mm_movemask_epi8(hits);
+		if (mask != 0)
+		{
+			unsigned long bit = 0;
+			_BitScanForward(&bit, mask);
+			return pos + (long)(bit / 2);
+		}
+		pos += 8;
+	}
+
+	while (pos < _length && !IsClass(_text[pos], CharMarkup))
+		++pos;
+	return pos;
+}
+
+long MarkupTokenizer::MatchCodeOpener(long pos, bool fEscapes) const
+{
+	// escaped forms are painted the same, and become text rather than output
+	static const WCHAR* s_openers[] = 
+	{
+		L"${", L"$!{", L"!{", L"?{",
+		L"\\${", L"$${", L"`${", 
+		L"\\!{", L"!!{", L"`!{", 
+		L"\\$!{", L"$$!{", L"`$!{",
+	};
+
+	size_t cOpeners = fEscapes ? _countof(s_openers) : 4;
+
+	// longest opener first, so "$$!{" isn't taken as text followed by "$!{"
+	long opener = 0;
+	for (size_t index = 0; index != cOpeners; ++index)
+	{
+		long length = (long)wcslen(s_openers[index]);
+		if (length > opener && At(pos, s_openers[index]))
+			opener = length;
+	}
+	return opener;
+}
+
+long MarkupTokenizer::ScanString(long pos, long& state)
+{
+	// picks up a verbatim string left open at the end of the last line, or begins a new one
+	long end = pos;
+	bool fVerbatim = (state & StateVerbatim) != 0;
+	WCHAR quote = L'"';
+	if (!fVerbatim)
+	{
+		if (_text[end] == L'@')
+		{
+			fVerbatim = true;
+			++end;
+		}
+		quote = _text[end++];
+	}
+
+	while (end < _length)
+	{
+		WCHAR ch = _text[end];
+		if (!fVerbatim && ch == L'\\')
+		{
+			end += 2;
+			continue;
+		}
+		if (!fVerbatim && ch == L'\n')
+			break;
+		if (ch == quote)
+		{
+			// a doubled quote is the verbatim escape
+			if (fVerbatim && end + 1 < _length && _text[end + 1] == quote)
+			{
+				end += 2;
+				continue;
+			}
+			Paint(pos, end + 1, MarkupColorString);
+			state &= ~StateVerbatim;
+			return end + 1;
+		}
+		++end;
+	}
+
+	// unterminated - only a verbatim string continues on the next line
+	if (end > _length)
+		end = _length;
+	Paint(pos, end, MarkupColorString);
+	if (fVerbatim)
+		state |= StateVerbatim;
+	return end;
+}
+
+long MarkupTokenizer::ScanLateBound(long pos) const
+{
+	// '#' Identifier ('.' Identifier)* (S? Quote Format Quote)? - the format is part of 
+	// the eval the grammar makes of it, and isn't painted as a string
+	long end = pos + 1;
+	if (end >= _length || !IsClass(_text[end], CharNameStart) || _text[end] == L':')
+		return pos + 1;
+
+	while (end < _length && (IsClass(_text[end], CharName) || _text[end] >= 128) && _text[end] != L':' && _text[end] != L'-')
+		++end;
+
+	long format = end;
+	while (format < _length && (_text[format] == L' ' || _text[format] == L'\t'))
+		++format;
+	if (format < _length && (_text[format] == L'"' || _text[format] == L'\''))
+	{
+		WCHAR quote = _text[format];
+		long close = format + 1;
+		while (close < _length && _text[close] != quote)
+			++close;
+		if (close < _length && close != format + 1)
+			end = close + 1;
+	}
+	return end;
+}
+
+long MarkupTokenizer::ScanLineComment(long pos) const
+{
+	// "//" to the end of the line, quotes and braces in it included
+	long end = pos + 2;
+	while (end < _length && _text[end] != L'\n')
+		++end;
+	return end;
+}
+
+long MarkupTokenizer::ScanEntity(long pos) const
+{
+	// '&' Name ';'
+	long nameEnd = ScanName(pos + 1);
+	if (nameEnd == pos + 1 || nameEnd >= _length || _text[nameEnd] != L';')
+		return pos;
+	return nameEnd + 1;
+}
+
+long MarkupTokenizer::ScanName(long pos) const
+{
+	if (pos >= _length || !IsClass(_text[pos], CharNameStart))
+		return pos;
+
+	++pos;
+	while (pos < _length && IsClass(_text[pos], CharName))
+		++pos;
+	return pos;
+}
+
+long MarkupTokenizer::SkipWhitespace(long pos) const
+{
+	while (pos < _length && IsClass(_text[pos], CharSpace))
+		++pos;
+	return pos;
+}
+
+bool MarkupTokenizer::At(long pos, const WCHAR* match) const
+{
+	for (; *match != 0; ++pos, ++match)
+	{
+		if (pos >= _length || _text[pos] != *match)
+			return false;
+	}
+	return true;
+}
+
+void MarkupTokenizer::Paint(long start, long end, MarkupColor color)
+{
+	if (end <= start)
+		return;
+
+	if (_attributes != NULL)
+	{
+		FillAttributes(_attributes + start, end - start, color + _colorOffset);
+		return;
+	}
+
+	if (_paints == NULL)
+		return;
+
+	SourcePainting paint;
+	paint.start = start;
+	paint.end = end;
+	paint.color = color;
+	_paints->Add(paint);
+}
@@ -0,0 +1,106 @@
+
+#pragma once
+
+#include "SparkLanguagePackage_i.h"
+#include "PooledArray.h"
+
+// Same values as SparkLanguage's SparkTokenType, which SourcePainting.color carries
+enum MarkupColor
+{
+	MarkupColorPlainText = 0,
+	MarkupColorHtmlTagDelimiter,
+	MarkupColorHtmlOperator,
+	MarkupColorHtmlElementName,
+	MarkupColorHtmlAttributeName,
+	MarkupColorHtmlAttributeValue,
+	MarkupColorHtmlComment,
+	MarkupColorHtmlEntity,
+	MarkupColorHtmlServerSideScript,
+	MarkupColorString,
+	MarkupColorSparkDelimiter,
+};
+
+// What the tokenizer is in the middle of where a line ends. Packed into the 
+// long the editor keeps per line, along with the details needed to resume:
+// bits 0-3 the construct, bits 4-5 what a code block returns to, bit 6 set 
+// inside an <ignore> start tag, bit 7 set inside a verbatim string, bit 8 set 
+// after a tag's '/', and bits 9-30 the depth of braces nested in a code block, 
+// which stops counting at the most those bits hold
+enum MarkupState
+{
+	MarkupStateText = 0,
+	MarkupStateTag,
+	MarkupStateAttributeName,
+	MarkupStateAttributeEquals,
+	MarkupStateValueDouble,
+	MarkupStateValueSingle,
+	MarkupStateCode,
+	MarkupStateAspx,
+	MarkupStateComment,
+	MarkupStateIgnore,
+	MarkupStateStatement,
+};
+
+// Native counterpart of the painting done by MarkupGrammar - produces the same kinds of 
+// runs straight from the buffer text, so markup can be recolored the moment it's edited
+// instead of after a round trip through managed generation. Unlike the grammar it only 
+// backtracks within a line, so it can stop at the end of any line and pick up there later 
+// - a malformed tag is painted until the line it turns out malformed on. Text between 
+// markup is skipped eight characters at a time with SSE2.
+class MarkupTokenizer
+{
+	const WCHAR* _text;
+	long _length;
+	PooledArray<SourcePainting>* _paints;
+	ULONG* _attributes;
+	ULONG _colorOffset;
+
+	// where the tag being lexed began, if it was in this text, and the paints before it
+	long _tagStart;
+	size_t _tagPaints;
+
+	MarkupTokenizer(const WCHAR* text, long length, PooledArray<SourcePainting>* paints) :
+		_text(text), _length(length), _paints(paints), _attributes(NULL), _colorOffset(0), 
+		_tagStart(-1), _tagPaints(0)
+	{
+	}
+
+public:
+	// replaces the contents of paints with the runs of text, in document order
+	static void Tokenize(const WCHAR* text, long length, PooledArray<SourcePainting>& paints);
+
+	// the state one line without its line break ends in, starting in the state the previous line ended in
+	static long GetStateAtEndOfLine(const WCHAR* text, long length, long state);
+
+	// writes the colors of one line straight into an editor attribute array, offset by 
+	// colorOffset. all length + 1 attributes are written, plain text and the line break 
+	// as 0 - no paints are collected on the way
+	static long ColorizeLine(const WCHAR* text, long length, long state, ULONG colorOffset, ULONG* pAttributes);
+
+	// sets count attributes to value, with aligned 16 byte stores for the middle of long runs
+	static void FillAttributes(ULONG* pAttributes, long count, ULONG value);
+
+private:
+	long Run(long state);
+
+	long LexText(long pos, long& state);
+	long LexTag(long pos, long& state);
+	long LexAttributeValue(long pos, long& state);
+	long LexCode(long pos, long& state);
+	long LexComment(long pos, long& state);
+	long LexIgnore(long pos, long& state);
+	long LexStatement(long pos, long& state);
+	long RejectTag(long pos, long& state);
+
+	long FindMarkup(long pos) const;
+	long MatchCodeOpener(long pos, bool fEscapes) const;
+	long ScanString(long pos, long& state);
+	long ScanLateBound(long pos) const;
+	long ScanLineComment(long pos) const;
+	long ScanEntity(long pos) const;
+	long ScanName(long pos) const;
+	long SkipWhitespace(long pos) const;
+
+	bool At(long pos, const WCHAR* match) const;
+	void Paint(long start, long end, MarkupColor color);
+};
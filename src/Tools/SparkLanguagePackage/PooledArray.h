@@ -0,0 +1,92 @@
+
+#pragma once
+
+// Array of plain structs which keeps its largest allocation when it is emptied or 
+// resized. Tables rebuilt on every generation stop allocating once they reach the 
+// size their document usually needs. Same names as CAtlArray where they overlap, 
+// and like CAtlArray it throws E_OUTOFMEMORY when growing fails.
+template<typename T>
+class PooledArray
+{
+	T* _data;
+	size_t _count;
+	size_t _capacity;
+
+	// not copyable
+	PooledArray(const PooledArray&);
+	PooledArray& operator=(const PooledArray&);
+
+public:
+	PooledArray() : _data(NULL), _count(0), _capacity(0)
+	{
+	}
+
+	~PooledArray()
+	{
+		free(_data);
+	}
+
+	size_t GetCount() const {return _count;}
+	bool IsEmpty() const {return _count == 0;}
+	T* GetData() {return _data;}
+	const T* GetData() const {return _data;}
+
+	T& operator[](size_t index) {ATLASSERT(index < _count); return _data[index];}
+	const T& operator[](size_t index) const {ATLASSERT(index < _count); return _data[index];}
+
+	// elements past the old count are left uninitialized
+	void SetCount(size_t count)
+	{
+		Reserve(count);
+		_count = count;
+	}
+
+	size_t Add(const T& item)
+	{
+		if (_count == _capacity)
+			Reserve(_count + 1);
+		_data[_count] = item;
+		return _count++;
+	}
+
+	void RemoveAll() 
+	{
+		_count = 0;
+	}
+
+	void Reserve(size_t capacity)
+	{
+		if (capacity <= _capacity)
+			return;
+
+		// at least double, so a table growing one Add at a time reallocates rarely
+		size_t grown = _capacity < 8 ? 16 : _capacity * 2;
+		if (grown < capacity)
+			grown = capacity;
+		if (grown > ((size_t)-1) / sizeof(T))
+			AtlThrow(E_OUTOFMEMORY);
+
+		T* data = (T*)realloc(_data, grown * sizeof(T));
+		if (data == NULL)
+			AtlThrow(E_OUTOFMEMORY);
+		_data = data;
+		_capacity = grown;
+	}
+
+	// exchanges contents, allocations included, without copying
+	void Swap(PooledArray& other)
+	{
+		T* data = _data; _data = other._data; other._data = data;
+		size_t count = _count; _count = other._count; other._count = count;
+		size_t capacity = _capacity; _capacity = other._capacity; other._capacity = capacity;
+	}
+
+	// gives the memory back - for buffers which were much larger than usual
+	void Release()
+	{
+		free(_data);
+		_data = NULL;
+		_count = 0;
+		_capacity = 0;
+	}
+};
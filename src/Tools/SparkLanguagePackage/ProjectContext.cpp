@@ -0,0 +1,131 @@
+
+#include "stdafx.h"
+#include "ProjectContext.h"
+
+STDMETHODIMP ProjectContext::GetIntellisenseProjectManager(VSITEMID itemid, IVsIntellisenseProjectManager** ppProjectManager)
+{
+	HRESULT hr = S_OK;
+	if (_projectManager == NULL)
+	{
+		CComPtr<IWebApplicationCtxSvc> webApplicationCtx;
+		_HR(_site->QueryService(__uuidof(IWebApplicationCtxSvc), &webApplicationCtx));
+
+		CComPtr<IServiceProvider> itemServices;
+		_HR(webApplicationCtx->GetItemContext(_hierarchy, itemid, &itemServices));
+		_HR(itemServices->QueryService(__uuidof(SVsIntellisenseProjectManager), &_projectManager));
+	}
+	if (FAILED(hr))
+		return hr;
+
+	return _projectManager.CopyTo(ppProjectManager);
+}
+
+STDMETHODIMP ProjectContext::GetDefaultPageBaseType(BSTR* pPageBaseType)
+{
+	if (_pageBaseTypeKnown)
+		return _pageBaseType.CopyTo(pPageBaseType);
+
+	*pPageBaseType = NULL;
+	CComBSTR pageBaseType;
+
+	HRESULT hr = S_OK;
+	CComPtr<VSProject> vsProject;
+	_HR(GetVSProject(&vsProject));
+
+	// listen before walking, so a reference added during the walk isn't missed
+	if (SUCCEEDED(hr) && _referencesEventsAdvise == 0)
+		AdviseReferencesEvents(vsProject);
+
+	CComPtr<References> references;
+	_HR(vsProject->get_References(&references));
+
+	CComPtr<IUnknown> punkEnum;
+	_HR(references->_NewEnum(&punkEnum));
+
+	CComPtr<IEnumVARIANT> pvarEnum;
+	_HR(punkEnum->QueryInterface(&pvarEnum));
+
+	while(SUCCEEDED(hr))
+	{
+		CComVariant varReference;
+		ULONG cFetched = 0;
+		HRESULT hrEnum = pvarEnum->Next(1, &varReference, &cFetched);
+		if (hrEnum != S_OK || cFetched == 0)
+			break;
+
+		_HR(varReference.ChangeType(VT_UNKNOWN));
+
+		CComPtr<Reference> reference;
+		_HR(V_UNKNOWN(&varReference)->QueryInterface(&reference));
+
+		CComBSTR name;
+		_HR(reference->get_Name(&name));
+
+		if (CompareStringW(LOCALE_INVARIANT, NORM_IGNORECASE, name, -1, L"Spark.Web.Mvc", -1) == CSTR_EQUAL)
+		{
+			pageBaseType = L"Spark.Web.Mvc.SparkView";
+			break;
+		}
+		else if (CompareStringW(LOCALE_INVARIANT, NORM_IGNORECASE, name, -1, L"Castle.MonoRail.Views.Spark", -1) == CSTR_EQUAL)
+		{
+			pageBaseType = L"Castle.MonoRail.Views.Spark.SparkView";
+			break;
+		}
+	}
+
+	// only remembered when something will say it's stale
+	if (SUCCEEDED(hr) && _referencesEventsAdvise != 0)
+	{
+		_pageBaseType = pageBaseType;
+		_pageBaseTypeKnown = true;
+	}
+
+	*pPageBaseType = pageBaseType.Detach();
+	return hr;
+}
+
+STDMETHODIMP ProjectContext::Close()
+{
+	if (_referencesEventsAdvise != 0)
+	{
+		AtlUnadvise(_referencesEvents, __uuidof(_dispReferencesEvents), _referencesEventsAdvise);
+		_referencesEventsAdvise = 0;
+	}
+	_referencesEvents.Release();
+	_projectManager.Release();
+
+	_pageBaseTypeKnown = false;
+	_pageBaseType.Empty();
+	return S_OK;
+}
+
+HRESULT ProjectContext::GetVSProject(VSProject** ppProject)
+{
+	HRESULT hr = S_OK;
+	CComVariant varProject;
+	_HR(_hierarchy->GetProperty(VSITEMID_ROOT, VSHPROPID_ExtObject, &varProject));
+	_HR(varProject.ChangeType(VT_UNKNOWN));
+	
+	CComPtr<DTE_Project> dteProject;
+	_HR(V_UNKNOWN(&varProject)->QueryInterface(&dteProject));
+
+	CComPtr<IDispatch> dispProject;
+	_HR(dteProject->get_Object(&dispProject));
+
+	_HR(dispProject->QueryInterface(ppProject));
+	return hr;
+}
+
+HRESULT ProjectContext::AdviseReferencesEvents(VSProject* pProject)
+{
+	HRESULT hr = S_OK;
+	CComPtr<VSProjectEvents> events;
+	_HR(pProject->get_Events(&events));
+
+	CComPtr<ReferencesEvents> referencesEvents;
+	_HR(events->get_ReferencesEvents(&referencesEvents));
+
+	_HR(referencesEvents->QueryInterface(&_referencesEvents));
+	_HR(AtlAdvise(_referencesEvents, static_cast<IDispatch*>(this), __uuidof(_dispReferencesEvents), &_referencesEventsAdvise));
+	return hr;
+}
@@ -0,0 +1,75 @@
+
+#pragma once
+
+#include "atlutil.h"
+#include "LanguageNative.h"
+
+class ProjectContextInit
+{
+public:
+	CComPtr<IServiceProvider> _site;
+	CComPtr<IVsHierarchy> _hierarchy;
+};
+
+// Caches what every document of a project would otherwise rediscover through the item 
+// context and DTE automation. Also the sink for the project's reference events, any of 
+// which forgets the page base type so it's walked again on next use.
+class ATL_NO_VTABLE ProjectContext :
+	public CComCreatableObject<ProjectContext, ProjectContextInit>,
+	public ISparkProjectContext,
+	public IDispatch
+{
+	CComPtr<IVsIntellisenseProjectManager> _projectManager;
+
+	bool _pageBaseTypeKnown;
+	CComBSTR _pageBaseType;
+
+	CComPtr<IUnknown> _referencesEvents;
+	DWORD _referencesEventsAdvise;
+
+public:
+	ProjectContext()
+	{
+		_pageBaseTypeKnown = false;
+		_referencesEventsAdvise = 0;
+	}
+
+	BEGIN_COM_MAP(ProjectContext)
+		COM_INTERFACE_ENTRY(ISparkProjectContext)
+		COM_INTERFACE_ENTRY(IDispatch)
+		COM_INTERFACE_ENTRY_IID(__uuidof(_dispReferencesEvents), IDispatch)
+	END_COM_MAP()
+
+	void FinalRelease()
+	{
+		Close();
+	}
+
+	/**** ISparkProjectContext ****/
+	STDMETHODIMP GetIntellisenseProjectManager(VSITEMID itemid, IVsIntellisenseProjectManager** ppProjectManager);
+	STDMETHODIMP GetDefaultPageBaseType(BSTR* pPageBaseType);
+	STDMETHODIMP Close();
+
+	/**** IDispatch (_dispReferencesEvents) ****/
+	STDMETHODIMP GetTypeInfoCount(UINT* pctinfo) 
+	{
+		*pctinfo = 0;
+		return S_OK;
+	}
+
+	STDMETHODIMP GetTypeInfo(UINT iTInfo, LCID lcid, ITypeInfo** ppTInfo) {ATLTRACENOTIMPL(_T("ProjectContext::GetTypeInfo"));}
+
+	STDMETHODIMP GetIDsOfNames(REFIID riid, LPOLESTR* rgszNames, UINT cNames, LCID lcid, DISPID* rgDispId) {ATLTRACENOTIMPL(_T("ProjectContext::GetIDsOfNames"));}
+
+	STDMETHODIMP Invoke(DISPID dispIdMember, REFIID riid, LCID lcid, WORD wFlags, DISPPARAMS* pDispParams, VARIANT* pVarResult, EXCEPINFO* pExcepInfo, UINT* puArgErr)
+	{
+		// ReferenceAdded, ReferenceRemoved and ReferenceChanged all invalidate
+		_pageBaseTypeKnown = false;
+		_pageBaseType.Empty();
+		return S_OK;
+	}
+
+private:
+	HRESULT GetVSProject(VSProject** ppProject);
+	HRESULT AdviseReferencesEvents(VSProject* pProject);
+};
@@ -0,0 +1,255 @@
+
+#include "stdafx.h"
+#include "RegenerationScheduler.h"
+
+RegenerationScheduler::RegenerationScheduler()
+{
+	_dispatcher = NULL;
+	_sequence = 0;
+	_running = 0;
+	_dispatchRequested = false;
+	_open = false;
+}
+
+RegenerationScheduler::~RegenerationScheduler()
+{
+	Close();
+}
+
+void RegenerationScheduler::Open(RegenerationDispatcher* pDispatcher)
+{
+	_dispatcher = pDispatcher;
+	_dispatchRequested = false;
+	_open = true;
+}
+
+void RegenerationScheduler::Close()
+{
+	_open = false;
+
+	CAtlArray<IUnknown*> owners;
+	for (size_t index = _entries.GetCount(); index-- != 0; )
+	{
+		_entries[index].queued = false;
+		if (_entries[index].running)
+			continue;
+		if (_entries[index].owner != NULL)
+			owners.Add(_entries[index].owner);
+		_entries.RemoveAt(index);
+	}
+
+	// a job's owner may be the last thing holding it, so it goes once the queue is settled
+	for (size_t index = 0; index != owners.GetCount(); ++index)
+		owners[index]->Release();
+}
+
+long RegenerationScheduler::Find(RegenerationJob* pJob)
+{
+	for (size_t index = 0; index != _entries.GetCount(); ++index)
+	{
+		if (_entries[index].job == pJob)
+			return (long)index;
+	}
+	return -1;
+}
+
+long RegenerationScheduler::Add(RegenerationJob* pJob, RegenerationPriority priority)
+{
+	Entry entry;
+	entry.job = pJob;
+	entry.owner = NULL;
+	entry.priority = priority;
+	entry.sequence = ++_sequence;
+	entry.passedOver = 0;
+	entry.queued = false;
+	entry.running = false;
+	return (long)_entries.Add(entry);
+}
+
+bool RegenerationScheduler::Schedule(RegenerationJob* pJob, IUnknown* pOwner, RegenerationPriority priority)
+{
+	if (!_open)
+		return false;
+
+	long index = Find(pJob);
+	if (index == -1)
+		index = Add(pJob, priority);
+
+	Entry& entry = _entries[index];
+	if (entry.owner == NULL)
+	{
+		entry.owner = pOwner;
+		entry.owner->AddRef();
+	}
+
+	// waiting already - the text it reads will be current when it runs
+	if (entry.queued)
+	{
+		if (priority < entry.priority)
+			entry.priority = priority;
+		return true;
+	}
+
+	entry.queued = true;
+	entry.priority = priority;
+	entry.sequence = ++_sequence;
+	entry.passedOver = 0;
+	RequestDispatch();
+	return true;
+}
+
+void RegenerationScheduler::SetPriority(RegenerationJob* pJob, RegenerationPriority priority)
+{
+	long index = Find(pJob);
+	if (index != -1)
+		_entries[index].priority = priority;
+}
+
+void RegenerationScheduler::Cancel(RegenerationJob* pJob)
+{
+	long index = Find(pJob);
+	if (index == -1)
+		return;
+
+	_entries[index].queued = false;
+	if (_entries[index].running)
+		return;
+
+	IUnknown* owner = _entries[index].owner;
+	_entries.RemoveAt(index);
+	if (owner != NULL)
+		owner->Release();
+}
+
+bool RegenerationScheduler::BeginInline(RegenerationJob* pJob)
+{
+	long index = Find(pJob);
+	if (index == -1)
+		index = Add(pJob, RegenerationPriorityFocused);
+
+	Entry& entry = _entries[index];
+	if (entry.running)
+		return false;
+
+	entry.queued = false;
+	entry.running = true;
+	++_running;
+	return true;
+}
+
+void RegenerationScheduler::EndInline(RegenerationJob* pJob)
+{
+	--_running;
+	long index = Find(pJob);
+	if (index == -1)
+		return;
+
+	IUnknown* owner = Finish(index);
+	RequestDispatch();
+	if (owner != NULL)
+		owner->Release();
+}
+
+bool RegenerationScheduler::RunNext()
+{
+	_dispatchRequested = false;
+	if (_running != 0)
+		return false;
+
+	long index = TakeNext();
+	if (index == -1)
+		return false;
+
+	// the owner is held until the job is finished, whatever the job does meanwhile
+	RegenerationJob* job = _entries[index].job;
+	++_running;
+	job->RunRegeneration();
+	--_running;
+
+	IUnknown* owner = Finish(Find(job));
+	RequestDispatch();
+	if (owner != NULL)
+		owner->Release();
+	return true;
+}
+
+long RegenerationScheduler::TakeNext()
+{
+	// the job passed over most often once any reaches the bound, otherwise the
+	// best priority, first come first served within it
+	long chosen = -1;
+	bool fOverdue = false;
+	for (size_t index = 0; index != _entries.GetCount(); ++index)
+	{
+		const Entry& entry = _entries[index];
+		if (!entry.queued || entry.running)
+			continue;
+
+		if (chosen == -1)
+		{
+			chosen = (long)index;
+			fOverdue = entry.passedOver >= s_fairnessBound;
+			continue;
+		}
+
+		const Entry& best = _entries[chosen];
+		bool fBetter;
+		if (entry.passedOver >= s_fairnessBound || fOverdue)
+			fBetter = entry.passedOver > best.passedOver ||
+				(entry.passedOver == best.passedOver && entry.sequence < best.sequence);
+		else
+			fBetter = entry.priority < best.priority ||
+				(entry.priority == best.priority && entry.sequence < best.sequence);
+
+		if (fBetter)
+		{
+			chosen = (long)index;
+			fOverdue = entry.passedOver >= s_fairnessBound;
+		}
+	}
+
+	if (chosen == -1)
+		return -1;
+
+	for (size_t index = 0; index != _entries.GetCount(); ++index)
+	{
+		if (_entries[index].queued && !_entries[index].running && (long)index != chosen)
+			++_entries[index].passedOver;
+	}
+
+	Entry& entry = _entries[chosen];
+	entry.queued = false;
+	entry.running = true;
+	entry.passedOver = 0;
+	return chosen;
+}
+
+IUnknown* RegenerationScheduler::Finish(long index)
+{
+	// scheduled again while it ran - it stays, and waits its turn like any other
+	Entry& entry = _entries[index];
+	entry.running = false;
+	if (entry.queued && _open)
+		return NULL;
+
+	IUnknown* owner = entry.owner;
+	_entries.RemoveAt(index);
+	return owner;
+}
+
+void RegenerationScheduler::RequestDispatch()
+{
+	// one request covers every waiting job - each dispatch asks for the next
+	if (_dispatchRequested || _dispatcher == NULL || !_open || _running != 0)
+		return;
+
+	for (size_t index = 0; index != _entries.GetCount(); ++index)
+	{
+		if (_entries[index].queued && !_entries[index].running)
+		{
+			_dispatchRequested = true;
+			_dispatcher->RequestDispatch();
+			return;
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// Which of a document's views the user is looking at - lower values are regenerated first
+enum RegenerationPriority
+{
+	// the view with keyboard focus
+	RegenerationPriorityFocused = 0,
+
+	// shown in a window frame, but not the active one
+	RegenerationPriorityVisible = 1,
+
+	// open without a visible window, or not known to be shown yet
+	RegenerationPriorityBackground = 2,
+};
+
+// Work the scheduler runs - implemented by Source
+class RegenerationJob
+{
+public:
+	// called on the UI thread, never while the same job is running further up the stack
+	virtual void RunRegeneration() = 0;
+};
+
+// Has RunNext called back on the UI thread once it has caught up with pending input -
+// implemented by RegenerationDispatchWindow
+class RegenerationDispatcher
+{
+public:
+	virtual void RequestDispatch() = 0;
+};
+
+// Queues the regenerations of every open source and runs them one at a time on the UI
+// thread, one per dispatch so input is handled between them. The supervisor generates
+// through the project hierarchy and the running document table, which belong to the UI
+// thread, so the queue only decides the order. Each job is queued at most once: scheduling
+// a job already waiting only raises its priority, and scheduling one that's running has
+// it run once more afterwards. The focused view goes first, then visible ones, then the
+// rest - but a job passed over often enough goes next whatever its priority, so a steady
+// stream of work on one view can't hold the others back indefinitely.
+//
+// Used from the UI thread only.
+class RegenerationScheduler
+{
+	struct Entry
+	{
+		RegenerationJob* job;
+		IUnknown* owner;
+		RegenerationPriority priority;
+		ULONG sequence;
+		long passedOver;
+		bool queued;
+		bool running;
+	};
+
+	CAtlArray<Entry> _entries;
+	RegenerationDispatcher* _dispatcher;
+	ULONG _sequence;
+	long _running;
+	bool _dispatchRequested;
+	bool _open;
+
+	// how many other jobs may go ahead of a waiting one before it's next
+	static const long s_fairnessBound = 4;
+
+public:
+	RegenerationScheduler();
+	~RegenerationScheduler();
+
+	void Open(RegenerationDispatcher* pDispatcher);
+
+	// forgets waiting jobs - a running one is further up the stack, and finishes first
+	void Close();
+
+	bool IsOpen() const {return _open;}
+
+	// the job's owner is held while it is queued or running. false once closed
+	bool Schedule(RegenerationJob* pJob, IUnknown* pOwner, RegenerationPriority priority);
+	void SetPriority(RegenerationJob* pJob, RegenerationPriority priority);
+
+	// takes a waiting job out of the queue. one already running isn't interrupted,
+	// but won't be run again
+	void Cancel(RegenerationJob* pJob);
+
+	// for a caller which needs the regeneration done before it returns. a waiting job is
+	// taken out of the queue and run by the caller until EndInline. false when the job is
+	// already running further up the stack, where it can't be waited for
+	bool BeginInline(RegenerationJob* pJob);
+	void EndInline(RegenerationJob* pJob);
+
+	// runs the job which goes next, as the dispatcher asked. false when there's none, or
+	// a regeneration is running further up the stack - messages pumped while it runs
+	// dispatch again once it's finished
+	bool RunNext();
+
+private:
+	long Find(RegenerationJob* pJob);
+	long Add(RegenerationJob* pJob, RegenerationPriority priority);
+	long TakeNext();
+	IUnknown* Finish(long index);
+	void RequestDispatch();
+};
@@ -0,0 +1,133 @@
+
+#include "stdafx.h"
+#include "RegenerationWindow.h"
+
+HRESULT RegenerationWindow::Open(RegenerationCallback* callback)
+{
+	_callback = callback;
+	if (Create(HWND_MESSAGE) == NULL)
+		return AtlHresultFromLastError();
+	return S_OK;
+}
+
+void RegenerationWindow::Close()
+{
+	if (IsWindow())
+	{
+		KillTimer(TIMER_REGENERATE);
+		KillTimer(TIMER_PROMOTE);
+		DestroyWindow();
+	}
+	delete TakeResult();
+	_callback = NULL;
+}
+
+void RegenerationWindow::Schedule(DWORD dwDelay)
+{
+	if (IsWindow())
+		SetTimer(TIMER_REGENERATE, dwDelay);
+}
+
+void RegenerationWindow::Cancel()
+{
+	if (IsWindow())
+		KillTimer(TIMER_REGENERATE);
+}
+
+void RegenerationWindow::SchedulePromotion()
+{
+	if (IsWindow())
+		SetTimer(TIMER_PROMOTE, USER_TIMER_MINIMUM);
+}
+
+void RegenerationWindow::Post(GeneratedResult* pResult)
+{
+	GeneratedResult* pSuperseded = NULL;
+	{
+		CComCritSecLock<CComCriticalSection> lock(_resultLock);
+		pSuperseded = _result;
+		_result = pResult;
+	}
+
+	// a message is already on its way if there was an unapplied result
+	if (pSuperseded == NULL)
+		PostMessage(WM_GENERATEDRESULT);
+	delete pSuperseded;
+}
+
+GeneratedResult* RegenerationWindow::TakeResult()
+{
+	CComCritSecLock<CComCriticalSection> lock(_resultLock);
+	GeneratedResult* pResult = _result;
+	_result = NULL;
+	return pResult;
+}
+
+LRESULT RegenerationWindow::OnTimer(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
+{
+	if (wParam == TIMER_REGENERATE)
+	{
+		KillTimer(TIMER_REGENERATE);
+		if (_callback != NULL)
+			_callback->OnRegenerationDue();
+	}
+	else if (wParam == TIMER_PROMOTE)
+	{
+		KillTimer(TIMER_PROMOTE);
+		if (_callback != NULL)
+			_callback->OnPromotionDue();
+	}
+	else
+	{
+		bHandled = FALSE;
+	}
+	return 0;
+}
+
+LRESULT RegenerationWindow::OnGeneratedResult(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
+{
+	GeneratedResult* pResult = TakeResult();
+	if (pResult != NULL && _callback != NULL)
+		_callback->OnGeneratedResult(pResult);
+	delete pResult;
+	return 0;
+}
+
+
+HRESULT RegenerationDispatchWindow::Open(RegenerationScheduler* pScheduler)
+{
+	_scheduler = pScheduler;
+	if (Create(HWND_MESSAGE) == NULL)
+		return AtlHresultFromLastError();
+	return S_OK;
+}
+
+void RegenerationDispatchWindow::Close()
+{
+	if (IsWindow())
+	{
+		KillTimer(TIMER_DISPATCH);
+		DestroyWindow();
+	}
+	_scheduler = NULL;
+}
+
+void RegenerationDispatchWindow::RequestDispatch()
+{
+	if (IsWindow())
+		SetTimer(TIMER_DISPATCH, USER_TIMER_MINIMUM);
+}
+
+LRESULT RegenerationDispatchWindow::OnTimer(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
+{
+	if (wParam != TIMER_DISPATCH)
+	{
+		bHandled = FALSE;
+		return 0;
+	}
+
+	KillTimer(TIMER_DISPATCH);
+	if (_scheduler != NULL)
+		_scheduler->RunNext();
+	return 0;
+}
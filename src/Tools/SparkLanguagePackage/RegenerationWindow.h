@@ -0,0 +1,125 @@
+
+#pragma once
+
+#include "SparkLanguagePackage_i.h"
+#include "RegenerationScheduler.h"
+
+// Copy of a generation result which arrived away from the UI thread
+struct GeneratedResult
+{
+	// identifies the primary text it was generated from, see GeneratedState::HashText
+	long _primaryLength;
+	ULONG _primaryHash;
+	CComBSTR _secondaryText;
+	CAtlArray<SourceMapping> _mappings;
+};
+
+class RegenerationCallback
+{
+public:
+	// the debounce window has passed without another edit
+	virtual void OnRegenerationDue() = 0;
+
+	// a result posted from another thread has reached the UI thread
+	virtual void OnGeneratedResult(GeneratedResult* pResult) = 0;
+
+	// the UI thread has caught up with pending input and painting
+	virtual void OnPromotionDue() = 0;
+};
+
+// Message-only window created on the UI thread. It coalesces bursts of edits into a 
+// single regeneration with a restartable timer, and carries generation results 
+// produced on other threads back to the thread which owns the text buffers.
+class RegenerationWindow : 
+	public CWindowImpl<RegenerationWindow, CWindow, CNullTraits>
+{
+	enum 
+	{
+		TIMER_REGENERATE = 1,
+		TIMER_PROMOTE = 2,
+		WM_GENERATEDRESULT = WM_APP + 1,
+	};
+
+	RegenerationCallback* _callback;
+
+	// most recent result posted and not yet applied - older ones are superseded
+	CComAutoCriticalSection _resultLock;
+	GeneratedResult* _result;
+
+public:
+	RegenerationWindow()
+	{
+		_callback = NULL;
+		_result = NULL;
+	}
+
+	~RegenerationWindow()
+	{
+		Close();
+	}
+
+	BEGIN_MSG_MAP(RegenerationWindow)
+		MESSAGE_HANDLER(WM_TIMER, OnTimer)
+		MESSAGE_HANDLER(WM_GENERATEDRESULT, OnGeneratedResult)
+	END_MSG_MAP()
+
+	HRESULT Open(RegenerationCallback* callback);
+	void Close();
+
+	// (re)starts the debounce timer - an edit inside the window pushes regeneration back
+	void Schedule(DWORD dwDelay);
+	void Cancel();
+
+	// deferred work which should wait for the editor to paint first - timer messages
+	// are only delivered once the input and paint queues are empty
+	void SchedulePromotion();
+
+	// callable from any thread, takes ownership of the result
+	void Post(GeneratedResult* pResult);
+
+private:
+	LRESULT OnTimer(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
+	LRESULT OnGeneratedResult(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
+
+	GeneratedResult* TakeResult();
+};
+
+// Message-only window created on the UI thread for the language's regeneration queue. 
+// Each dispatch runs one regeneration from a timer, and timer messages are only 
+// delivered once the input and paint queues are empty, so typing is never held up 
+// behind more than the regeneration already running.
+class RegenerationDispatchWindow : 
+	public CWindowImpl<RegenerationDispatchWindow, CWindow, CNullTraits>,
+	public RegenerationDispatcher
+{
+	enum 
+	{
+		TIMER_DISPATCH = 1,
+	};
+
+	RegenerationScheduler* _scheduler;
+
+public:
+	RegenerationDispatchWindow()
+	{
+		_scheduler = NULL;
+	}
+
+	~RegenerationDispatchWindow()
+	{
+		Close();
+	}
+
+	BEGIN_MSG_MAP(RegenerationDispatchWindow)
+		MESSAGE_HANDLER(WM_TIMER, OnTimer)
+	END_MSG_MAP()
+
+	HRESULT Open(RegenerationScheduler* pScheduler);
+	void Close();
+
+	/**** RegenerationDispatcher ****/
+	void RequestDispatch();
+
+private:
+	LRESULT OnTimer(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
+};
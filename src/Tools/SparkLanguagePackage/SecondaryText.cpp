@@ -0,0 +1,205 @@
+
+#include "stdafx.h"
+#include "SecondaryText.h"
+
+HRESULT SecondaryText::Apply(
+	SecondaryTextTarget* pTarget, 
+	const LineIndex& primaryLines, 
+	const WCHAR* pSecondaryText, long cchSecondary, 
+	const SourceMapping* rgSpans, long cSpans, 
+	SpanMappingTable& mappingTable, 
+	SecondaryTextBuffers& buffers)
+{
+	HRESULT hr = S_OK;
+	buffers.recolorFirstLine = -1;
+
+	CStringW& existingText = buffers.existingText;
+	if (!buffers.existingValid)
+	{
+		_HR(pTarget->GetText(existingText));
+		if (FAILED(hr))
+			return hr;
+		buffers.existingLines.Build(existingText, existingText.GetLength());
+		buffers.existingValid = true;
+	}
+
+	// secondary text already current - the buffer coordinator has carried the mappings 
+	// through the edit, but the rows of the table may still have moved
+	if (existingText.GetLength() == cchSecondary && 
+		(cchSecondary == 0 || memcmp((const WCHAR*)existingText, pSecondaryText, cchSecondary * sizeof(WCHAR)) == 0))
+	{
+		buffers.hunks.RemoveAll();
+		return ApplyMappings(pTarget, primaryLines, buffers.existingLines, rgSpans, cSpans, mappingTable, buffers);
+	}
+
+	// line starts of the generated text - the primary's are kept by the source as it's edited
+	buffers.secondaryLines.Build(pSecondaryText, cchSecondary);
+
+	_HR(ReplaceText(pTarget, pSecondaryText, buffers));
+	_HR(ApplyMappings(pTarget, primaryLines, buffers.secondaryLines, rgSpans, cSpans, mappingTable, buffers));
+
+	// a replacement that failed part way leaves the buffer somewhere in between
+	buffers.existingValid = SUCCEEDED(hr);
+	if (SUCCEEDED(hr))
+	{
+		existingText.SetString(pSecondaryText, cchSecondary);
+		buffers.existingLines.Swap(buffers.secondaryLines);
+	}
+	return hr;
+}
+
+HRESULT SecondaryText::ApplyMappings(
+	SecondaryTextTarget* pTarget, 
+	const LineIndex& primaryLines, 
+	const LineTable& secondaryLines, 
+	const SourceMapping* rgSpans, long cSpans, 
+	SpanMappingTable& mappingTable, 
+	SecondaryTextBuffers& buffers)
+{
+	HRESULT hr = S_OK;
+
+	buffers.mappings.SetCount(cSpans);
+	NewSpanMapping* mappings = buffers.mappings.GetData();
+	if (cSpans != 0)
+		ZeroMemory(mappings, sizeof(NewSpanMapping) * cSpans);
+
+	// mappings are produced in document order, so each walker mostly steps forward
+	LineTable::Walker secondaryStart(secondaryLines);
+	LineTable::Walker secondaryEnd(secondaryLines);
+	for(int index = 0; index != cSpans; ++index)
+	{
+		primaryLines.GetLineIndexOfPosition(
+			rgSpans[index].start1,
+			&mappings[index].tspSpans.span1.iStartLine,
+			&mappings[index].tspSpans.span1.iStartIndex);
+		primaryLines.GetLineIndexOfPosition(
+			rgSpans[index].end1,
+			&mappings[index].tspSpans.span1.iEndLine,
+			&mappings[index].tspSpans.span1.iEndIndex);
+		secondaryStart.GetLineIndexOfPosition(
+			rgSpans[index].start2,
+			&mappings[index].tspSpans.span2.iStartLine,
+			&mappings[index].tspSpans.span2.iStartIndex);
+		secondaryEnd.GetLineIndexOfPosition(
+			rgSpans[index].end2,
+			&mappings[index].tspSpans.span2.iEndLine,
+			&mappings[index].tspSpans.span2.iEndIndex);
+	}
+
+	// nothing moved and none of the generated code changed - every line still paints 
+	// as it did
+	PooledArray<NewSpanMapping>& appliedMappings = buffers.appliedMappings;
+	if (buffers.hunks.IsEmpty() && 
+		appliedMappings.GetCount() == (size_t)cSpans && 
+		(cSpans == 0 || memcmp(appliedMappings.GetData(), mappings, sizeof(NewSpanMapping) * cSpans) == 0))
+		return hr;
+
+	buffers.recolorFirstLine = FindRecolorFirstLine(buffers);
+
+	if (cSpans == 0)
+	{
+		mappingTable.Clear();
+	}
+	else
+	{
+		_HR(pTarget->SetSpanMappings(cSpans, mappings));
+		mappingTable.Build(mappings, cSpans);
+	}
+
+	// the table is built either way, so it's what the colorizer has painted from
+	appliedMappings.Swap(buffers.mappings);
+	return hr;
+}
+
+long SecondaryText::FindRecolorFirstLine(const SecondaryTextBuffers& buffers)
+{
+	const PooledArray<NewSpanMapping>& applied = buffers.appliedMappings;
+	const PooledArray<NewSpanMapping>& mappings = buffers.mappings;
+	size_t cApplied = applied.GetCount();
+	size_t cMappings = mappings.GetCount();
+
+	// past the mappings both sets share, rows go by the first line any of the rest 
+	// touches - they are mostly in document order, but not always
+	size_t iFirstDifferent = 0;
+	while (iFirstDifferent != cApplied && iFirstDifferent != cMappings && 
+		memcmp(&applied[iFirstDifferent], &mappings[iFirstDifferent], sizeof(NewSpanMapping)) == 0)
+		++iFirstDifferent;
+
+	long iFirstLine = -1;
+	for (size_t index = iFirstDifferent; index < cApplied; ++index)
+	{
+		long iLine = applied[index].tspSpans.span1.iStartLine;
+		if (iFirstLine == -1 || iLine < iFirstLine)
+			iFirstLine = iLine;
+	}
+	for (size_t index = iFirstDifferent; index < cMappings; ++index)
+	{
+		long iLine = mappings[index].tspSpans.span1.iStartLine;
+		if (iFirstLine == -1 || iLine < iFirstLine)
+			iFirstLine = iLine;
+	}
+
+	// a shared mapping over generated code that was replaced colors differently. hunks 
+	// are in order of line, and one that only removes lines touches the line after
+	const PooledArray<TextHunk>& hunks = buffers.hunks;
+	size_t cHunks = hunks.GetCount();
+	for (size_t index = 0; cHunks != 0 && index != iFirstDifferent; ++index)
+	{
+		const TextSpanPair& spans = mappings[index].tspSpans;
+		if (iFirstLine != -1 && spans.span1.iStartLine >= iFirstLine)
+			continue;
+
+		size_t low = 0;
+		size_t high = cHunks;
+		while (low != high)
+		{
+			size_t middle = (low + high) / 2;
+			long iHunkEnd = hunks[middle].iNewEnd > hunks[middle].iNewFirst ? hunks[middle].iNewEnd : hunks[middle].iNewFirst + 1;
+			if (iHunkEnd <= spans.span2.iStartLine)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		if (low != cHunks && hunks[low].iNewFirst <= spans.span2.iEndLine)
+			iFirstLine = spans.span1.iStartLine;
+	}
+	return iFirstLine;
+}
+
+HRESULT SecondaryText::ReplaceText(
+	SecondaryTextTarget* pTarget, 
+	const WCHAR* pSecondaryText, 
+	SecondaryTextBuffers& buffers)
+{
+	HRESULT hr = S_OK;
+
+	const WCHAR* pExistingText = buffers.existingText;
+	const LineTable& existingLines = buffers.existingLines;
+	const LineTable& secondaryLines = buffers.secondaryLines;
+
+	// replace only the lines which changed, so the contained language can keep its 
+	// state for the rest of the generated code. working from the bottom up leaves 
+	// the line numbers of the hunks above still valid
+	PooledArray<TextHunk>& hunks = buffers.hunks;
+	TextDiff::DiffLines(pExistingText, existingLines, pSecondaryText, secondaryLines, hunks);
+
+	for (size_t index = hunks.GetCount(); SUCCEEDED(hr) && index != 0; --index)
+	{
+		const TextHunk& hunk = hunks[index - 1];
+
+		long iStartLine = 0;
+		long iStartIndex = 0;
+		existingLines.GetLineIndexOfPosition(existingLines.GetLineStart(hunk.iOldFirst), &iStartLine, &iStartIndex);
+		long iEndLine = 0;
+		long iEndIndex = 0;
+		existingLines.GetLineIndexOfPosition(existingLines.GetLineStart(hunk.iOldEnd), &iEndLine, &iEndIndex);
+
+		long iNewStart = secondaryLines.GetLineStart(hunk.iNewFirst);
+		long iNewEnd = secondaryLines.GetLineStart(hunk.iNewEnd);
+
+		_HR(pTarget->ReplaceLines(
+			iStartLine, iStartIndex, iEndLine, iEndIndex, 
+			pSecondaryText + iNewStart, iNewEnd - iNewStart));
+	}
+	return hr;
+}
@@ -0,0 +1,78 @@
+
+#pragma once
+
+#include "atlutil.h"
+#include "SparkLanguagePackage_i.h"
+#include "LineTable.h"
+#include "LineIndex.h"
+#include "SpanMappingTable.h"
+#include "TextDiff.h"
+
+// What applying a generation needs from the secondary buffer and its coordinator. Source 
+// implements it over IVsTextLines and IVsTextBufferCoordinator - anything holding the 
+// text in memory can stand in for them, with no editor running.
+class SecondaryTextTarget
+{
+public:
+	virtual ~SecondaryTextTarget() {}
+
+	virtual HRESULT GetText(CStringW& text) = 0;
+	virtual HRESULT ReplaceLines(long iStartLine, long iStartIndex, long iEndLine, long iEndIndex, const WCHAR* pText, long cchText) = 0;
+	virtual HRESULT SetSpanMappings(long cMappings, const NewSpanMapping* rgMappings) = 0;
+};
+
+// Scratch storage for Apply, kept by the caller so it is only allocated until it 
+// has grown to what the document needs. existingText and existingLines are the text 
+// last applied, which is what the buffer holds for as long as existingValid is set -
+// whoever sees the buffer edited some other way clears it, and the text is read back
+struct SecondaryTextBuffers
+{
+	CStringW existingText;
+	LineTable existingLines;
+	bool existingValid;
+	LineIndex primaryLines;
+	LineTable secondaryLines;
+	PooledArray<TextHunk> hunks;
+	PooledArray<NewSpanMapping> mappings;
+	PooledArray<NewSpanMapping> appliedMappings;
+
+	// set by Apply - the first primary line whose contained language colors may no 
+	// longer be what it was painted with, or -1. every line from there down may have
+	// been painted from rows of the mapping table which have since moved
+	long recolorFirstLine;
+
+	SecondaryTextBuffers() : existingValid(false), recolorFirstLine(-1)
+	{
+	}
+};
+
+// Brings a secondary buffer up to date with generated code: only the changed lines are 
+// replaced, and the span mappings are converted to line/index form once for both the
+// coordinator and the per-line table the colorizer reads.
+class SecondaryText
+{
+public:
+	static HRESULT Apply(
+		SecondaryTextTarget* pTarget, 
+		const LineIndex& primaryLines, 
+		const WCHAR* pSecondaryText, long cchSecondary, 
+		const SourceMapping* rgSpans, long cSpans, 
+		SpanMappingTable& mappingTable, 
+		SecondaryTextBuffers& buffers);
+
+private:
+	static HRESULT ApplyMappings(
+		SecondaryTextTarget* pTarget, 
+		const LineIndex& primaryLines, 
+		const LineTable& secondaryLines, 
+		const SourceMapping* rgSpans, long cSpans, 
+		SpanMappingTable& mappingTable, 
+		SecondaryTextBuffers& buffers);
+
+	static long FindRecolorFirstLine(const SecondaryTextBuffers& buffers);
+
+	static HRESULT ReplaceText(
+		SecondaryTextTarget* pTarget, 
+		const WCHAR* pSecondaryText, 
+		SecondaryTextBuffers& buffers);
+};
@@ -1,279 +1,884 @@
-
-#include "stdafx.h"
-#include "Source.h"
-
-STDMETHODIMP Source::SetSupervisor(ISourceSupervisor* pSupervisor) 
-{
-	if (_supervisorAdvise)
-	{
-		if (_supervisor != NULL)
-			_supervisor->Unadvise(_supervisorAdvise);
-		_supervisorAdvise = 0;
-	}
-
-	_supervisor = pSupervisor;
-	if (_supervisor != NULL)
-		_supervisor->Advise(this, &_supervisorAdvise);
-
-	return S_OK;
-}
-
-STDMETHODIMP Source::GetRunningDocumentText(BSTR CanonicalName, BSTR *pText)
-{
-	*pText = NULL;
-
-	HRESULT hr = S_OK;
-	CComPtr<IVsRunningDocumentTable> runningDocumentTable;
-	_HR(_site->QueryService(__uuidof(IVsRunningDocumentTable), &runningDocumentTable));
-	
-	CComPtr<IUnknown> punkDocument;
-	if (SUCCEEDED(hr))
-	{
-		CComPtr<IVsHierarchy> hierarchy;
-		VSITEMID itemid = 0;
-		VSCOOKIE cookie = 0;
-		HRESULT hrFind = runningDocumentTable->FindAndLockDocument(0, CanonicalName, &hierarchy, &itemid, &punkDocument, &cookie);
-		if (FAILED(hrFind) || itemid == VSITEMID_NIL)
-		{
-			// return (string)null
-			*pText = NULL;
-			return S_OK;
-		}
-	}
-
-	CComPtr<IVsTextLines> textLines;	
-	_HR(punkDocument->QueryInterface(&textLines));
-
-	long iLine = 0;
-	long iIndex = 0;
-	_HR(textLines->GetLastLineIndex(&iLine, &iIndex));
-	_HR(textLines->GetLineText(0, 0, iLine, iIndex, pText));
-
-	return hr;
-}
-
-STDMETHODIMP Source::GetPaint( 
-    /* [out] */ long *cPaint,
-    /* [size_is][size_is][out] */ SourcePainting **prgPaint)
-{
-	HRESULT hr = S_OK;
-	*cPaint = _paintLength;
-	*prgPaint = new SourcePainting[_paintLength];
-	CopyMemory(*prgPaint, _paintArray, sizeof(SourcePainting) * _paintLength);
-	return hr;
-}
-
-
-HRESULT SiteObject(IUnknown* obj, IServiceProvider* site)
-{
-	CComQIPtr<IObjectWithSite> ows(obj);
-	return (ows == NULL) ? S_OK : ows->SetSite(site);
-}
-
-HRESULT Source::FinalConstruct()
-{
-	HRESULT hr = S_OK;
-
-	CComPtr<ILocalRegistry> reg;
-	_HR(_site->QueryService(__uuidof(ILocalRegistry), &reg));
-
-
-	// Initialize secondary buffer and coordinator
-	_HR(reg->CreateInstance(__uuidof(VsTextBuffer), NULL, __uuidof(IVsTextLines), CLSCTX_INPROC_SERVER, (void**)&_secondaryBuffer));
-	_HR(SiteObject(_secondaryBuffer, _site));
-	_HR(_secondaryBuffer->SetLanguageServiceID(__uuidof(CSharp)));
-
-	_HR(reg->CreateInstance(__uuidof(VsTextBufferCoordinator), NULL, __uuidof(IVsTextBufferCoordinator), CLSCTX_INPROC_SERVER, (void**)&_bufferCoordinator));
-	_HR(SiteObject(_bufferCoordinator, _site));
-	_HR(_bufferCoordinator->SetBuffers(_primaryBuffer, _secondaryBuffer));
-
-	// Get the moniker for the text buffer
-	CComPtr<IVsUserData> userData;
-	_HR(_primaryBuffer->QueryInterface(&userData));		
-	CComVariant moniker;
-	_HR(userData->GetData(__uuidof(IVsUserData), &moniker));
-	_HR(moniker.ChangeType(VT_BSTR));
-
-	// Locate hierarchy itemid
-	CComPtr<IWebApplicationCtxSvc> webApplicationCtx;
-	_HR(_site->QueryService(__uuidof(IWebApplicationCtxSvc), &webApplicationCtx));
-	_HR(webApplicationCtx->GetItemContextFromPath(V_BSTR(&moniker), FALSE, &_hierarchy, &_itemid));
-
-	// Locate intellisense project manager
-	CComPtr<IServiceProvider> itemServices;
-	_HR(webApplicationCtx->GetItemContext(_hierarchy, _itemid, &itemServices));		
-	_HR(itemServices->QueryService(__uuidof(SVsIntellisenseProjectManager), &_projectManager));
-
-	// Initialize contained language
-	CComPtr<IVsContainedLanguageFactory> containedLanguagefactory;
-	_HR(_projectManager->GetContainedLanguageFactory(CComBSTR(_T("CSharp")), &containedLanguagefactory));
-	_HR(containedLanguagefactory->GetLanguage(_hierarchy, _itemid, _bufferCoordinator, &_containedLanguage));
-	_HR(_containedLanguage->SetHost(this));
-	
-	return hr;
-}
-
-STDMETHODIMP Source::GetDefaultPageBaseType(BSTR* pPageBaseType)
-{
-	CComBSTR pageBaseType;
-
-	HRESULT hr = S_OK;
-	CComVariant varProject;
-	_HR(_hierarchy->GetProperty(VSITEMID_ROOT, VSHPROPID_ExtObject, &varProject));
-	_HR(varProject.ChangeType(VT_UNKNOWN));
-	
-	CComPtr<DTE_Project> dteProject;
-	_HR(V_UNKNOWN(&varProject)->QueryInterface(&dteProject));
-
-	CComPtr<IDispatch> dispProject;
-	_HR(dteProject->get_Object(&dispProject));
-
-	CComPtr<VSProject> vsProject;
-	_HR(dispProject->QueryInterface(&vsProject));
-
-	CComPtr<References> references;
-	_HR(vsProject->get_References(&references));
-
-	CComPtr<IUnknown> punkEnum;
-	_HR(references->_NewEnum(&punkEnum));
-
-	CComPtr<IEnumVARIANT> pvarEnum;
-	_HR(punkEnum->QueryInterface(&pvarEnum));
-
-	while(SUCCEEDED(hr))
-	{
-		CComVariant varReference;
-		ULONG cFetched = 0;
-		HRESULT hrEnum = pvarEnum->Next(1, &varReference, &cFetched);
-		if (hrEnum != S_OK || cFetched == 0)
-			break;
-
-		_HR(varReference.ChangeType(VT_UNKNOWN));
-
-		CComPtr<Reference> reference;
-		_HR(V_UNKNOWN(&varReference)->QueryInterface(&reference));
-
-		CComBSTR name;
-		_HR(reference->get_Name(&name));
-
-		if (CompareStringW(LOCALE_INVARIANT, NORM_IGNORECASE, name, -1, L"Spark.Web.Mvc", -1) == CSTR_EQUAL)
-		{
-			pageBaseType = L"Spark.Web.Mvc.SparkView";
-			break;
-		}
-		else if (CompareStringW(LOCALE_INVARIANT, NORM_IGNORECASE, name, -1, L"Castle.MonoRail.Views.Spark", -1) == CSTR_EQUAL)
-		{
-			pageBaseType = L"Castle.MonoRail.Views.Spark.SparkView";
-			break;
-		}
-	}
-
-	*pPageBaseType = pageBaseType.Detach();
-	return hr;
-}
-
-
-STDMETHODIMP Source::EnsureSecondaryBufferReady()
-{
-	HRESULT hr = S_OK;
-
-	long iLastLine = 0;
-	long iLastIndex = 0;
-	_HR(_primaryBuffer->GetLastLineIndex(&iLastLine, &iLastIndex));
-
-	CComBSTR primaryText;
-	_HR(_primaryBuffer->GetLineText(0, 0, iLastLine, iLastIndex, &primaryText));
-
-	// primary text has not changed - do nothing
-	if (FAILED(hr) || primaryText == _primaryText)
-		return hr;
-
-	_primaryText.Attach(primaryText.Detach());
-
-	_HR(_supervisor->PrimaryTextChanged(TRUE));
-
-	return hr;
-}
-
-STDMETHODIMP Source::OnGenerated( 
-    /* [in] */ BSTR primaryText,
-    /* [in] */ BSTR secondaryText,
-    /* [in] */ long cMappings,
-    /* [size_is][in] */ SourceMapping *rgSpans,
-	/* [in] */ long cPaints,
-	/* [size_is][in] */ SourcePainting *rgPaints)
-{
-	HRESULT hr = S_OK;
-
-	long iReplaceLastLine = 0;
-	long iReplaceLastIndex = 0;
-	_HR(_secondaryBuffer->GetLastLineIndex(&iReplaceLastLine, &iReplaceLastIndex));
-	CComBSTR existingSecondaryText;
-	_HR(_secondaryBuffer->GetLineText(0, 0, iReplaceLastLine, iReplaceLastIndex, &existingSecondaryText));
-
-	// secondary text already current - assume buffer coordinator worked and do nothing
-	if (FAILED(hr) || secondaryText == existingSecondaryText)
-		return hr;
-
-	TextSpan changedSpan = {0};
-	_HR(_secondaryBuffer->ReplaceLines(
-		0, 0, iReplaceLastLine, iReplaceLastIndex, 
-		secondaryText, SysStringLen(secondaryText), 
-		&changedSpan));
-
-	if (cMappings != 0)
-	{
-		NewSpanMapping* mappings = new NewSpanMapping[cMappings];
-		ZeroMemory(mappings, sizeof(NewSpanMapping) * cMappings);
-		for(int index = 0; index != cMappings; ++index)
-		{
-			_primaryBuffer->GetLineIndexOfPosition(
-				rgSpans[index].start1,
-				&mappings[index].tspSpans.span1.iStartLine,
-				&mappings[index].tspSpans.span1.iStartIndex);
-			_primaryBuffer->GetLineIndexOfPosition(
-				rgSpans[index].end1,
-				&mappings[index].tspSpans.span1.iEndLine,
-				&mappings[index].tspSpans.span1.iEndIndex);
-			_secondaryBuffer->GetLineIndexOfPosition(
-				rgSpans[index].start2,
-				&mappings[index].tspSpans.span2.iStartLine,
-				&mappings[index].tspSpans.span2.iStartIndex);
-			_secondaryBuffer->GetLineIndexOfPosition(
-				rgSpans[index].end2,
-				&mappings[index].tspSpans.span2.iEndLine,
-				&mappings[index].tspSpans.span2.iEndIndex);
-		}
-
-		_HR(_bufferCoordinator->SetSpanMappings(cMappings, mappings));
-		delete[cMappings] mappings;
-	}
-
-	if (_paintArray != NULL)
-	{
-		delete[_paintLength] _paintArray;
-		_paintArray = NULL;
-	}
-
-	_paintLength = cPaints;
-	_paintArray = new SourcePainting[_paintLength];
-	CopyMemory(_paintArray, rgPaints, cPaints * sizeof(SourcePainting));
-
-	return hr;
-}
-
-STDMETHODIMP Source::GetLineIndent( 
-	/* [in] */ long lLineNumber,
-	/* [out] */ __RPC__deref_out_opt BSTR *pbstrIndentString,
-	/* [out] */ __RPC__out long *plParentIndentLevel,
-	/* [out] */ __RPC__out long *plIndentSize,
-	/* [out] */ __RPC__out BOOL *pfTabs,
-	/* [out] */ __RPC__out long *plTabSize) 
-{
-	*pbstrIndentString = SysAllocString(L"  ");
-	*plParentIndentLevel = 0;
-	*plIndentSize = 2;
-	*pfTabs = FALSE;
-	*plTabSize = 4;
-	return S_OK;
-}
+
+#include "stdafx.h"
+#include "Source.h"
+#include "MarkupTokenizer.h"
+
+STDMETHODIMP Source::SetSupervisor(ISourceSupervisor* pSupervisor) 
+{
+	if (_supervisorAdvise)
+	{
+		if (_supervisor != NULL)
+			_supervisor->Unadvise(_supervisorAdvise);
+		_supervisorAdvise = 0;
+	}
+
+	_supervisor = pSupervisor;
+	if (_supervisor != NULL)
+		_supervisor->Advise(this, &_supervisorAdvise);
+
+	LoadTypeCharTriggers();
+	return S_OK;
+}
+
+void Source::LoadTypeCharTriggers()
+{
+	ZeroMemory(_typeCharAscii, sizeof(_typeCharAscii));
+	_typeCharOther.Empty();
+	_typeCharAll = false;
+
+	if (_supervisor == NULL)
+		return;
+
+	// a supervisor from before the triggers could be asked for sees every character
+	CComQIPtr<ISourceSupervisor2> supervisor2(_supervisor);
+	CComBSTR triggers;
+	if (supervisor2 == NULL || FAILED(supervisor2->GetTypeCharTriggers(&triggers)))
+	{
+		_typeCharAll = true;
+		return;
+	}
+
+	for (UINT index = 0; index != triggers.Length(); ++index)
+	{
+		WCHAR ch = triggers[index];
+		if (ch < 128)
+			_typeCharAscii[ch / 32] |= 1 << (ch % 32);
+		else
+			_typeCharOther.AppendChar(ch);
+	}
+}
+
+STDMETHODIMP Source::GetRunningDocumentText(BSTR CanonicalName, BSTR *pText)
+{
+	// every document the generation includes is read through here
+	bool fNoted = false;
+	for (size_t index = 0; index != _generationReferences.GetCount() && !fNoted; ++index)
+		fNoted = _generationReferences[index].CompareNoCase(CanonicalName) == 0;
+	if (!fNoted)
+		_generationReferences.Add(CStringW(CanonicalName));
+
+	// layouts and partials are shared by many views, the language keeps their text
+	if (_language == NULL)
+		return *pText = NULL, S_OK;
+
+	return _language->GetRunningDocumentText(CanonicalName, pText);
+}
+
+STDMETHODIMP Source::GetPaint( 
+    /* [out] */ long *cPaint,
+    /* [size_is][size_is][out] */ SourcePainting **prgPaint)
+{
+	// the colorizer paints line by line and nothing else keeps whole-document paint. it's 
+	// the paint of the text GetPrimaryText returns - the one last read for generation, 
+	// which a large document leaves behind the buffer until generation is wanted - so it 
+	// is tokenized again only when that text changes
+	if (_markupPaintsGeneration != _generation)
+	{
+		MarkupTokenizer::Tokenize(_primaryText, _primaryText.Length(), _markupPaints);
+		_markupPaintsGeneration = _generation;
+	}
+
+	long cTokenized = (long)_markupPaints.GetCount();
+	*cPaint = cTokenized;
+	*prgPaint = new SourcePainting[cTokenized];
+	if (cTokenized != 0)
+		CopyMemory(*prgPaint, _markupPaints.GetData(), sizeof(SourcePainting) * cTokenized);
+	_diagnostics.Add(SparkCounterBytesCopied, sizeof(SourcePainting) * cTokenized);
+	return S_OK;
+}
+
+
+HRESULT SiteObject(IUnknown* obj, IServiceProvider* site)
+{
+	CComQIPtr<IObjectWithSite> ows(obj);
+	return (ows == NULL) ? S_OK : ows->SetSite(site);
+}
+
+HRESULT Source::FinalConstruct()
+{
+	HRESULT hr = S_OK;
+
+	// Results and debounced regeneration are handled on the thread that owns the buffers.
+	// Without the window every change simply regenerates immediately, as it always has.
+	_uiThreadId = GetCurrentThreadId();
+	_diagnostics.SetOwnerThread(_uiThreadId);
+	_regenerationWindow.Open(this);
+
+	// Track changes to the primary buffer so unchanged text is never re-read
+	_HR(AtlAdvise(_primaryBuffer, static_cast<IVsTextLinesEvents*>(this), __uuidof(IVsTextLinesEvents), &_primaryBufferAdvise));
+
+	// Get the moniker for the text buffer
+	CComPtr<IVsUserData> userData;
+	_HR(_primaryBuffer->QueryInterface(&userData));		
+	CComVariant moniker;
+	_HR(userData->GetData(__uuidof(IVsUserData), &moniker));
+	_HR(moniker.ChangeType(VT_BSTR));
+
+	// Locate hierarchy itemid - the supervisor needs it to generate at all
+	CComPtr<IWebApplicationCtxSvc> webApplicationCtx;
+	_HR(_site->QueryService(__uuidof(IWebApplicationCtxSvc), &webApplicationCtx));
+	_HR(webApplicationCtx->GetItemContextFromPath(V_BSTR(&moniker), FALSE, &_hierarchy, &_itemid));
+
+	// Project level facts are shared by every document in the project
+	_HR(_language->GetProjectContext(_hierarchy, &_projectContext));
+	_HR(_language->GetLargeDocumentThresholds(&_largeThresholds));
+	_HR(_language->GetRegenerationScheduler(&_scheduler));
+	if (V_VT(&moniker) == VT_BSTR)
+		_moniker = V_BSTR(&moniker);
+
+	// The remaining tiers follow once the editor has painted, or right away without the window
+	if (SUCCEEDED(hr))
+	{
+		if (_regenerationWindow.IsWindow())
+			_regenerationWindow.SchedulePromotion();
+		else
+			while (SUCCEEDED(hr) && _tier != SourceTierContainedLanguage)
+				_HR(Promote());
+	}
+	return hr;
+}
+
+void Source::OnPromotionDue()
+{
+	// one tier per timer, so input and painting get in between
+	if (SUCCEEDED(Promote()) && _tier != SourceTierContainedLanguage)
+		_regenerationWindow.SchedulePromotion();
+}
+
+HRESULT Source::Promote()
+{
+	HRESULT hr = S_OK;
+	switch (_tier)
+	{
+	case SourceTierMarkup:
+		_HR(CreateBuffers());
+		if (SUCCEEDED(hr))
+		{
+			_tier = SourceTierBuffers;
+
+			// the generation already applied had nowhere to put the generated code
+			if (_generatedGeneration != 0)
+				_HR(Regenerate(false));
+		}
+		break;
+
+	case SourceTierBuffers:
+		_HR(CreateContainedLanguage());
+		if (SUCCEEDED(hr))
+		{
+			_tier = SourceTierContainedLanguage;
+
+			// sinks may unadvise while being told, so work from a copy
+			CAtlArray<ISparkSourceNativeEvents*> sinks;
+			sinks.Copy(_containedLanguageSinks);
+			_containedLanguageSinks.RemoveAll();
+			for (size_t index = 0; index != sinks.GetCount(); ++index)
+				sinks[index]->OnContainedLanguageReady();
+
+			// lines colored so far are missing the contained language's colors
+			CComQIPtr<IVsTextColorState> colorState(_primaryBuffer);
+			if (colorState != NULL)
+				colorState->ReColorizeLines(0, -1);
+		}
+		break;
+	}
+	return hr;
+}
+
+HRESULT Source::CreateBuffers()
+{
+	HRESULT hr = S_OK;
+
+	CComPtr<ILocalRegistry> reg;
+	_HR(_site->QueryService(__uuidof(ILocalRegistry), &reg));
+
+	// Initialize secondary buffer and coordinator
+	CComPtr<IVsTextLines> secondaryBuffer;
+	_HR(reg->CreateInstance(__uuidof(VsTextBuffer), NULL, __uuidof(IVsTextLines), CLSCTX_INPROC_SERVER, (void**)&secondaryBuffer));
+	_HR(SiteObject(secondaryBuffer, _site));
+	_HR(secondaryBuffer->SetLanguageServiceID(__uuidof(CSharp)));
+
+	CComPtr<IVsTextBufferCoordinator> bufferCoordinator;
+	_HR(reg->CreateInstance(__uuidof(VsTextBufferCoordinator), NULL, __uuidof(IVsTextBufferCoordinator), CLSCTX_INPROC_SERVER, (void**)&bufferCoordinator));
+	_HR(SiteObject(bufferCoordinator, _site));
+	_HR(bufferCoordinator->SetBuffers(_primaryBuffer, secondaryBuffer));
+
+	SecondaryBufferEventsInit init;
+	init._buffer = secondaryBuffer;
+	CComPtr<IVsTextLinesEvents> events;
+	_HR(SecondaryBufferEvents::CreateInstance(init, &events));
+
+	if (SUCCEEDED(hr))
+	{
+		_secondaryBuffer = secondaryBuffer;
+		_bufferCoordinator = bufferCoordinator;
+		_secondaryBufferEventsUnk = events;
+		_secondaryBufferEvents = static_cast<SecondaryBufferEvents*>(events.p);
+	}
+	return hr;
+}
+
+HRESULT Source::CreateContainedLanguage()
+{
+	HRESULT hr = S_OK;
+
+	// Locate intellisense project manager, shared by every document in the project
+	_HR(_projectContext->GetIntellisenseProjectManager(_itemid, &_projectManager));
+
+	// Initialize contained language
+	CComPtr<IVsContainedLanguageFactory> containedLanguagefactory;
+	_HR(_projectManager->GetContainedLanguageFactory(CComBSTR(_T("CSharp")), &containedLanguagefactory));
+	_HR(containedLanguagefactory->GetLanguage(_hierarchy, _itemid, _bufferCoordinator, &_containedLanguage));
+	_HR(_containedLanguage->SetHost(this));
+	return hr;
+}
+
+STDMETHODIMP Source::AdviseContainedLanguageReady(ISparkSourceNativeEvents* pSink)
+{
+	if (_containedLanguage != NULL)
+		return S_FALSE;
+
+	_containedLanguageSinks.Add(pSink);
+	return S_OK;
+}
+
+STDMETHODIMP Source::UnadviseContainedLanguageReady(ISparkSourceNativeEvents* pSink)
+{
+	for (size_t index = 0; index != _containedLanguageSinks.GetCount(); ++index)
+	{
+		if (_containedLanguageSinks[index] == pSink)
+		{
+			_containedLanguageSinks.RemoveAt(index);
+			return S_OK;
+		}
+	}
+	return S_FALSE;
+}
+
+void Source::FinalRelease()
+{
+	Close();
+}
+
+STDMETHODIMP Source::Close()
+{
+	_regenerationWindow.Close();
+
+	// a waiting regeneration is dropped. one is only running here when a message pumped
+	// while the supervisor generates closed the source - the scheduler and RunRegeneration 
+	// hold the source and supervisor until it returns, and with this source unadvised 
+	// below the result goes nowhere
+	if (_scheduler != NULL)
+	{
+		_scheduler->Cancel(this);
+		_scheduler = NULL;
+	}
+
+	// the buffer, supervisor and contained language each hold a reference back to this source
+	if (_primaryBufferAdvise != 0)
+	{
+		AtlUnadvise(_primaryBuffer, __uuidof(IVsTextLinesEvents), _primaryBufferAdvise);
+		_primaryBufferAdvise = 0;
+	}
+	if (_secondaryBufferEvents != NULL)
+	{
+		_secondaryBufferEvents->Close();
+		_secondaryBufferEvents = NULL;
+		_secondaryBufferEventsUnk.Release();
+	}
+
+	SetSupervisor(NULL);
+
+	if (_containedLanguage != NULL)
+	{
+		_containedLanguage->SetHost(NULL);
+		_containedLanguage.Release();
+	}
+
+	_containedLanguageSinks.RemoveAll();
+	_projectContext.Release();
+	_language.Release();
+	return S_OK;
+}
+
+STDMETHODIMP Source::GetDefaultPageBaseType(BSTR* pPageBaseType)
+{
+	if (_projectContext == NULL)
+		return *pPageBaseType = NULL, S_OK;
+
+	return _projectContext->GetDefaultPageBaseType(pPageBaseType);
+}
+
+
+static bool SameText(BSTR text1, BSTR text2)
+{
+	UINT length = SysStringLen(text1);
+	if (length != SysStringLen(text2))
+		return false;
+	return length == 0 || memcmp(text1, text2, length * sizeof(OLECHAR)) == 0;
+}
+
+HRESULT Source::SyncPrimaryText(bool fImmediate)
+{
+	HRESULT hr = S_OK;
+
+	// no edits since the primary text was last read
+	if (_primaryDirty)
+	{
+		_HR(UpdateLargeDocument());
+
+		// a large document's text isn't read for colors - only when generation is wanted
+		if (_largeDocument && !fImmediate)
+		{
+			if (_deferredVersion != _primaryVersion)
+			{
+				_deferredVersion = _primaryVersion;
+				_diagnostics.Add(SparkCounterDeferredRegenerations, 1);
+			}
+			return hr;
+		}
+
+		CComBSTR primaryText;
+		_HR(ReadPrimaryText(primaryText));
+		if (FAILED(hr))
+			return hr;
+
+		_primaryDirty = false;
+		_dirtyFirstLine = -1;
+		_dirtyLastLine = -1;
+
+		// the index follows the buffer's events - rebuilt when it missed one, or no longer
+		// agrees with the buffer about the size of the text
+		long cLines = 0;
+		_HR(_primaryBuffer->GetLineCount(&cLines));
+		if (!_primaryLinesValid || 
+			_primaryLines.GetLength() != (long)primaryText.Length() ||
+			_primaryLines.GetLineCount() != cLines)
+		{
+			_primaryLines.Build(primaryText, primaryText.Length());
+			_primaryLinesValid = true;
+		}
+
+		// an edit which restored the same text needs no generation
+		if (!SameText(primaryText, _primaryText))
+		{
+			_primaryText.Attach(primaryText.Detach());
+			_primaryHash = GeneratedState::HashText(_primaryText, _primaryText.Length());
+			++_generation;
+		}
+	}
+
+	if (_generation == _requestedGeneration)
+		return hr;
+
+	// a large document's generation waits until intellisense needs it
+	if (_largeDocument && !fImmediate)
+		return hr;
+
+	// intellisense and the very first paint can't wait - otherwise let edits settle
+	if (fImmediate || _generatedGeneration == 0 || !_regenerationWindow.IsWindow())
+	{
+		_regenerationWindow.Cancel();
+		return Regenerate(fImmediate);
+	}
+
+	_regenerationWindow.Schedule(GetRegenerationDelay());
+	return hr;
+}
+
+HRESULT Source::UpdateLargeDocument()
+{
+	HRESULT hr = S_OK;
+
+	long cChars = 0;
+	long cLines = 0;
+	_HR(_primaryBuffer->GetSize(&cChars));
+	_HR(_primaryBuffer->GetLineCount(&cLines));
+	if (FAILED(hr))
+		return hr;
+
+	_largeDocument = 
+		(_largeThresholds.cchSize != 0 && cChars >= _largeThresholds.cchSize) ||
+		(_largeThresholds.cLines != 0 && cLines >= _largeThresholds.cLines);
+	return hr;
+}
+
+HRESULT Source::ReadPrimaryText(CComBSTR& primaryText)
+{
+	HRESULT hr = S_OK;
+
+	// a large document only has the lines edited since the last read copied out of the buffer
+	if (_largeDocument && ReadPrimaryTextChanges(primaryText) == S_OK)
+		return hr;
+
+	long iLastLine = 0;
+	long iLastIndex = 0;
+	_HR(_primaryBuffer->GetLastLineIndex(&iLastLine, &iLastIndex));
+	_HR(_primaryBuffer->GetLineText(0, 0, iLastLine, iLastIndex, &primaryText));
+	if (SUCCEEDED(hr))
+		_diagnostics.Add(SparkCounterBytesCopied, primaryText.ByteLength());
+	return hr;
+}
+
+HRESULT Source::ReadPrimaryTextChanges(CComBSTR& primaryText)
+{
+	HRESULT hr = S_OK;
+
+	// the line index knows where the dirty lines are now, and everything outside them is 
+	// still what was read last time - S_FALSE when the whole text has to be read instead
+	long cLines = _primaryLines.GetLineCount();
+	if (!_primaryLinesValid || _dirtyFirstLine == -1 || _primaryText == NULL || cLines == 0)
+		return S_FALSE;
+
+	long iFirstLine = _dirtyFirstLine < cLines ? _dirtyFirstLine : cLines - 1;
+	long iLastLine = _dirtyLastLine < cLines ? _dirtyLastLine : cLines - 1;
+	if (iLastLine < iFirstLine)
+		iLastLine = iFirstLine;
+
+	long length = _primaryLines.GetLength();
+	long start = _primaryLines.GetLineStart(iFirstLine);
+	long end = _primaryLines.GetLineStart(iLastLine + 1);
+	long tail = length - end;
+	long previousLength = (long)_primaryText.Length();
+	if (start + tail > previousLength)
+		return S_FALSE;
+
+	BSTR text = SysAllocStringLen(NULL, length);
+	if (text == NULL)
+		return E_OUTOFMEMORY;
+	primaryText.Attach(text);
+
+	long iEndLine = iLastLine + 1;
+	long iEndIndex = 0;
+	if (iEndLine == cLines)
+	{
+		iEndLine = iLastLine;
+		iEndIndex = _primaryLines.GetLineStart(cLines) - _primaryLines.GetLineStart(iLastLine);
+	}
+
+	int cchCopied = end - start;
+	_HR(_primaryBuffer->CopyLineText(iFirstLine, 0, iEndLine, iEndIndex, text + start, &cchCopied));
+	if (FAILED(hr) || cchCopied != end - start)
+	{
+		primaryText.Empty();
+		return S_FALSE;
+	}
+
+	CopyMemory(text, (BSTR)_primaryText, start * sizeof(WCHAR));
+	CopyMemory(text + end, (BSTR)_primaryText + previousLength - tail, tail * sizeof(WCHAR));
+	_diagnostics.Add(SparkCounterBytesCopied, (end - start) * sizeof(WCHAR));
+	return S_OK;
+}
+
+HRESULT Source::Regenerate(bool fImmediate)
+{
+	HRESULT hr = S_OK;
+	if (_supervisor == NULL)
+		return hr;
+
+	// text changes since the last request which never got a regeneration of their own
+	if (_generation - _requestedGeneration > 1)
+		_diagnostics.Add(SparkCounterCoalescedRegenerations, _generation - _requestedGeneration - 1);
+	_diagnostics.Add(SparkCounterRegenerations, 1);
+
+	_requestedGeneration = _generation;
+	_regenerationStart = GetTickCount();
+
+	if (_language != NULL && _moniker != NULL)
+		_language->ScheduleDependentRegenerations(this, _moniker);
+
+	// waits its turn behind the other sources, unless it's wanted now - then a waiting
+	// regeneration is taken out of the queue and run here instead
+	bool fQueue = _scheduler != NULL && _scheduler->IsOpen();
+	if (fQueue && !fImmediate && _scheduler->Schedule(this, GetUnknown(), _regenerationPriority))
+		return hr;
+
+	// this source is already regenerating further up the stack, which happens only when 
+	// a message was pumped while the supervisor generates. it read the text before this 
+	// change and can't be waited for on the same thread, so it runs once more as soon as
+	// it returns - and the caller hears S_FALSE, the secondary buffer not yet current
+	if (fQueue && !_scheduler->BeginInline(this))
+	{
+		_scheduler->Schedule(this, GetUnknown(), RegenerationPriorityFocused);
+		return S_FALSE;
+	}
+
+	// held in case the supervisor closes this source before it returns
+	CComPtr<ISourceSupervisor> supervisor(_supervisor);
+	_HR(Generate(supervisor));
+
+	if (fQueue)
+		_scheduler->EndInline(this);
+	return hr;
+}
+
+void Source::RunRegeneration()
+{
+	// the queue's turn came - on the UI thread, like every other call to the supervisor
+	CComPtr<ISourceSupervisor> supervisor(_supervisor);
+	if (supervisor == NULL)
+		return;
+
+	_regenerationStart = GetTickCount();
+	Generate(supervisor);
+}
+
+HRESULT Source::Generate(ISourceSupervisor* pSupervisor)
+{
+	// what this generation reads replaces what the last one did, unless it failed
+	_generationReferences.RemoveAll();
+	HRESULT hr = pSupervisor->PrimaryTextChanged(TRUE);
+	if (SUCCEEDED(hr))
+		_references.Copy(_generationReferences);
+	return hr;
+}
+
+STDMETHODIMP Source::ReferencesDocument(LPCWSTR canonicalName)
+{
+	for (size_t index = 0; index != _references.GetCount(); ++index)
+	{
+		if (_references[index].CompareNoCase(canonicalName) == 0)
+			return S_OK;
+	}
+	return S_FALSE;
+}
+
+STDMETHODIMP Source::ScheduleRegeneration()
+{
+	// a large document waits for intellisense even when what it includes changes
+	if (_supervisor == NULL || _largeDocument || _scheduler == NULL || !_scheduler->IsOpen())
+		return S_FALSE;
+
+	_requestedGeneration = _generation;
+	return _scheduler->Schedule(this, GetUnknown(), _regenerationPriority) ? S_OK : S_FALSE;
+}
+
+DWORD Source::GetRegenerationDelay()
+{
+	// wait out roughly one generation's worth of idle time, so a document that takes 
+	// long to generate isn't regenerated between every pair of keystrokes
+	const DWORD dwMinimumDelay = 100;
+	const DWORD dwMaximumDelay = 2000;
+
+	if (_regenerationCost < dwMinimumDelay)
+		return dwMinimumDelay;
+	if (_regenerationCost > dwMaximumDelay)
+		return dwMaximumDelay;
+	return _regenerationCost;
+}
+
+void Source::OnRegenerationDue()
+{
+	if (_generation != _requestedGeneration)
+		Regenerate(false);
+}
+
+void Source::OnGeneratedResult(GeneratedResult* pResult)
+{
+	ApplyGenerated(
+		pResult->_primaryLength, 
+		pResult->_primaryHash, 
+		pResult->_secondaryText, 
+		pResult->_secondaryText.Length(), 
+		pResult->_mappings.GetData(), 
+		(long)pResult->_mappings.GetCount());
+}
+
+STDMETHODIMP_(void) Source::OnChangeLineText( 
+	/* [in] */ __RPC__in const TextLineChange *pTextLineChange,
+	/* [in] */ BOOL fLast)
+{
+	InterlockedIncrement(&_primaryVersion);
+	_primaryDirty = true;
+	_mappingsMoved = true;
+	_liveMappingTableValid = false;
+
+	if (_primaryLinesValid)
+		_primaryLinesValid = UpdatePrimaryLines(pTextLineChange) == S_OK;
+
+	// keep the dirty range in current line numbers as lines come and go below it
+	long iLineDelta = pTextLineChange->iNewEndLine - pTextLineChange->iOldEndLine;
+	if (_dirtyFirstLine == -1)
+	{
+		_dirtyFirstLine = pTextLineChange->iStartLine;
+		_dirtyLastLine = pTextLineChange->iNewEndLine;
+		return;
+	}
+
+	if (_dirtyLastLine >= pTextLineChange->iOldEndLine)
+		_dirtyLastLine += iLineDelta;
+	if (_dirtyFirstLine > pTextLineChange->iStartLine)
+		_dirtyFirstLine = pTextLineChange->iStartLine;
+	if (_dirtyLastLine < pTextLineChange->iNewEndLine)
+		_dirtyLastLine = pTextLineChange->iNewEndLine;
+}
+
+HRESULT Source::UpdatePrimaryLines(const TextLineChange* pTextLineChange)
+{
+	HRESULT hr = S_OK;
+
+	long cLines = 0;
+	long cChars = 0;
+	long iPosition = 0;
+	_HR(_primaryBuffer->GetLineCount(&cLines));
+	_HR(_primaryBuffer->GetSize(&cChars));
+	_HR(_primaryBuffer->GetPositionOfLine(pTextLineChange->iStartLine, &iPosition));
+
+	// only the lines the change left behind are measured - the rest keep their lengths
+	long cNewLines = pTextLineChange->iNewEndLine - pTextLineChange->iStartLine + 1;
+	_primaryLineLengths.SetCount(cNewLines);
+	for (long index = 0; SUCCEEDED(hr) && index != cNewLines; ++index)
+	{
+		long iNextLine = pTextLineChange->iStartLine + index + 1;
+		long iNextPosition = cChars;
+		if (iNextLine < cLines)
+			_HR(_primaryBuffer->GetPositionOfLine(iNextLine, &iNextPosition));
+		_primaryLineLengths[index] = iNextPosition - iPosition;
+		iPosition = iNextPosition;
+	}
+	if (FAILED(hr))
+		return hr;
+
+	_primaryLines.ReplaceLines(
+		pTextLineChange->iStartLine, 
+		pTextLineChange->iOldEndLine - pTextLineChange->iStartLine + 1, 
+		_primaryLineLengths.GetData(), 
+		cNewLines);
+
+	// a change reported after the buffer had already moved on doesn't add up
+	if (_primaryLines.GetLineCount() != cLines || _primaryLines.GetLength() != cChars)
+		return S_FALSE;
+	return hr;
+}
+
+// the secondary buffer and coordinator as SecondaryText sees them
+class BufferTarget : public SecondaryTextTarget
+{
+	IVsTextLines* _buffer;
+	IVsTextBufferCoordinator* _coordinator;
+	Diagnostics& _diagnostics;
+
+public:
+	BufferTarget(IVsTextLines* pBuffer, IVsTextBufferCoordinator* pCoordinator, Diagnostics& diagnostics) :
+		_buffer(pBuffer), _coordinator(pCoordinator), _diagnostics(diagnostics)
+	{
+	}
+
+	HRESULT GetText(CStringW& text)
+	{
+		HRESULT hr = S_OK;
+		long iLastLine = 0;
+		long iLastIndex = 0;
+		_HR(_buffer->GetLastLineIndex(&iLastLine, &iLastIndex));
+		CComBSTR bufferText;
+		_HR(_buffer->GetLineText(0, 0, iLastLine, iLastIndex, &bufferText));
+		if (SUCCEEDED(hr))
+		{
+			text.SetString(bufferText, bufferText.Length());
+			_diagnostics.Add(SparkCounterBytesCopied, bufferText.ByteLength());
+		}
+		return hr;
+	}
+
+	HRESULT ReplaceLines(long iStartLine, long iStartIndex, long iEndLine, long iEndIndex, const WCHAR* pText, long cchText)
+	{
+		TextSpan changedSpan = {0};
+		return _buffer->ReplaceLines(iStartLine, iStartIndex, iEndLine, iEndIndex, pText, cchText, &changedSpan);
+	}
+
+	HRESULT SetSpanMappings(long cMappings, const NewSpanMapping* rgMappings)
+	{
+		return _coordinator->SetSpanMappings(cMappings, const_cast<NewSpanMapping*>(rgMappings));
+	}
+};
+
+STDMETHODIMP Source::OnGenerated( 
+    /* [in] */ BSTR primaryText,
+    /* [in] */ BSTR secondaryText,
+    /* [in] */ long cMappings,
+    /* [size_is][in] */ SourceMapping *rgSpans,
+	/* [in] */ long cPaints,
+	/* [size_is][in] */ SourcePainting *rgPaints)
+{
+	// a full result - deltas which follow have to start again from an empty generation
+	{
+		CComCritSecLock<CComCriticalSection> lock(_deliveredLock);
+		_delivered.Clear();
+	}
+
+	long primaryLength = SysStringLen(primaryText);
+	return ApplyGenerated(
+		primaryLength, 
+		GeneratedState::HashText(primaryText, primaryLength), 
+		secondaryText, SysStringLen(secondaryText), 
+		rgSpans, cMappings);
+}
+
+STDMETHODIMP Source::OnGeneratedDelta( 
+	/* [in] */ long generation,
+	/* [in] */ long baseGeneration,
+	/* [in] */ long primaryLength,
+	/* [in] */ long primaryHash,
+	/* [in] */ long cTextEdits,
+	/* [size_is][in] */ GeneratedTextEdit *rgTextEdits,
+	/* [in] */ BSTR insertedText,
+	/* [in] */ long cMappingOps,
+	/* [size_is][in] */ SourceDeltaOp *rgMappingOps,
+	/* [in] */ long cMappings,
+	/* [size_is][in] */ SourceMapping *rgMappings,
+	/* [retval][out] */ BOOL *pfApplied)
+{
+	*pfApplied = FALSE;
+
+	// held while the result is applied, so a delta arriving on another thread waits for this one
+	CComCritSecLock<CComCriticalSection> lock(_deliveredLock);
+	if (!_delivered.ApplyDelta(
+		generation, baseGeneration, 
+		rgTextEdits, cTextEdits, insertedText, SysStringLen(insertedText), 
+		rgMappingOps, cMappingOps, rgMappings, cMappings))
+		return S_OK;
+
+	*pfApplied = TRUE;
+	return ApplyGenerated(
+		primaryLength, 
+		(ULONG)primaryHash, 
+		_delivered.GetText(), _delivered.GetTextLength(), 
+		_delivered.GetMappings().GetData(), (long)_delivered.GetMappings().GetCount());
+}
+
+HRESULT Source::ApplyGenerated(
+	long primaryLength, ULONG primaryHash, 
+	const WCHAR* pSecondaryText, long cchSecondary, 
+	const SourceMapping* rgSpans, long cMappings)
+{
+	HRESULT hr = S_OK;
+
+	// a supervisor working on another thread has its result applied on the UI thread
+	if (GetCurrentThreadId() != _uiThreadId && _regenerationWindow.IsWindow())
+	{
+		GeneratedResult* pResult = new GeneratedResult;
+		pResult->_primaryLength = primaryLength;
+		pResult->_primaryHash = primaryHash;
+		pResult->_secondaryText.Attach(SysAllocStringLen(pSecondaryText, cchSecondary));
+		pResult->_mappings.SetCount(cMappings);
+		if (cMappings != 0)
+			CopyMemory(pResult->_mappings.GetData(), rgSpans, cMappings * sizeof(SourceMapping));
+		_regenerationWindow.Post(pResult);
+		_diagnostics.Add(SparkCounterBytesCopied, cchSecondary * sizeof(WCHAR) + cMappings * sizeof(SourceMapping));
+		return hr;
+	}
+
+	// discard results generated from text which has been edited since
+	if (primaryLength != (long)_primaryText.Length() || primaryHash != _primaryHash)
+	{
+		_diagnostics.Add(SparkCounterCancelledRegenerations, 1);
+		return hr;
+	}
+
+	DiagnosticsTimer timer(_diagnostics, SparkTimingOnGenerated);
+	_diagnostics.Set(SparkCounterMappingCount, cMappings);
+
+	if (_regenerationStart != 0)
+	{
+		DWORD dwCost = GetTickCount() - _regenerationStart;
+		_regenerationCost = (_regenerationCost * 3 + dwCost) / 4;
+		_regenerationStart = 0;
+	}
+	_generatedGeneration = _generation;
+
+	if (_secondaryBuffer == NULL || _bufferCoordinator == NULL)
+		return hr;
+
+	// the live line index is ahead of the text the result came from while edits are pending
+	const LineIndex* pPrimaryLines = &_primaryLines;
+	if (_primaryDirty || !_primaryLinesValid)
+	{
+		_secondaryTextBuffers.primaryLines.Build(_primaryText, _primaryText.Length());
+		pPrimaryLines = &_secondaryTextBuffers.primaryLines;
+	}
+
+	// the text kept from the last apply stands in for the buffer's, unless something else 
+	// has edited the buffer since. the apply's own edits are dropped once it's done
+	if (_secondaryBufferEvents->TakeEdited())
+		_secondaryTextBuffers.existingValid = false;
+
+	BufferTarget target(_secondaryBuffer, _bufferCoordinator, _diagnostics);
+	_HR(SecondaryText::Apply(
+		&target, 
+		*pPrimaryLines, 
+		pSecondaryText, cchSecondary, 
+		rgSpans, cMappings, 
+		_mappingTable, 
+		_secondaryTextBuffers));
+
+	_secondaryBufferEvents->TakeEdited();
+
+	// the table fits the buffer again, unless it was edited after the text was read
+	if (SUCCEEDED(hr) && !_primaryDirty)
+		_mappingsMoved = false;
+
+	// lines already painted from mappings or generated code which have since changed
+	if (_secondaryTextBuffers.recolorFirstLine != -1)
+	{
+		CComQIPtr<IVsTextColorState> colorState(_primaryBuffer);
+		if (colorState != NULL)
+			colorState->ReColorizeLines(_secondaryTextBuffers.recolorFirstLine, -1);
+	}
+	return hr;
+}
+
+STDMETHODIMP Source::GetLineMappings(long iLine, const SpanMappingTable::Fragment** prgFragments, long* cFragments)
+{
+	if (!_mappingsMoved || _bufferCoordinator == NULL)
+	{
+		*prgFragments = _mappingTable.GetLine(iLine, cFragments);
+		return S_OK;
+	}
+
+	if (!_liveMappingTableValid)
+		BuildLiveMappingTable();
+	*prgFragments = _liveMappingTable.GetLine(iLine, cFragments);
+	return S_OK;
+}
+
+HRESULT Source::BuildLiveMappingTable()
+{
+	HRESULT hr = S_OK;
+
+	// read once per edit rather than once per line, and left empty when it can't be read
+	_liveMappings.RemoveAll();
+	_liveMappingTableValid = true;
+
+	CComPtr<IVsEnumBufferCoordinatorSpans> spans;
+	_HR(_bufferCoordinator->EnumSpans(&spans));
+	while (SUCCEEDED(hr))
+	{
+		NewSpanMapping mapping = {0};
+		ULONG cFetched = 0;
+		if (spans->Next(1, &mapping, &cFetched) != S_OK || cFetched == 0)
+			break;
+		_liveMappings.Add(mapping);
+	}
+
+	if (FAILED(hr))
+		_liveMappings.RemoveAll();
+	_liveMappingTable.Build(_liveMappings.GetData(), (long)_liveMappings.GetCount());
+	_diagnostics.Add(SparkCounterBytesCopied, _liveMappings.GetCount() * sizeof(NewSpanMapping));
+	return hr;
+}
+
+STDMETHODIMP Source::GetLineIndent( 
+	/* [in] */ long lLineNumber,
+	/* [out] */ __RPC__deref_out_opt BSTR *pbstrIndentString,
+	/* [out] */ __RPC__out long *plParentIndentLevel,
+	/* [out] */ __RPC__out long *plIndentSize,
+	/* [out] */ __RPC__out BOOL *pfTabs,
+	/* [out] */ __RPC__out long *plTabSize) 
+{
+	*pbstrIndentString = SysAllocString(L"  ");
+	*plParentIndentLevel = 0;
+	*plIndentSize = 2;
+	*pfTabs = FALSE;
+	*plTabSize = 4;
+	return S_OK;
+}
@@ -1,192 +1,506 @@
-
-#pragma once
-
-#include "atlutil.h"
-#include "SparkLanguagePackage_i.h"
-
-
-class SourceInit
-{
-public:
-	CComPtr<IServiceProvider> _site;
-	CComPtr<IVsTextLines> _primaryBuffer;
-};
-
-class ATL_NO_VTABLE Source :
-	public CComCreatableObject<Source, SourceInit>,
-	public ISparkSource,
-	public IVsContainedLanguageHost,
-	public ISourceSupervisorEvents
-{
-	CComPtr<ISourceSupervisor> _supervisor;
-	DWORD _supervisorAdvise;
-
-	CComPtr<IVsHierarchy> _hierarchy;
-	VSITEMID _itemid;
-
-	CComPtr<IVsTextLines> _secondaryBuffer;
-	CComPtr<IVsTextBufferCoordinator> _bufferCoordinator;
-
-	CComPtr<IVsIntellisenseProjectManager> _projectManager;
-	CComPtr<IVsContainedLanguage> _containedLanguage;
-
-	CComBSTR _primaryText;
-
-
-	int _paintLength;
-	SourcePainting* _paintArray;
-
-
-public:
-	Source()
-	{
-		_supervisorAdvise = 0;
-		_paintLength = 0;
-		_paintArray = NULL;
-	}
-
-	BEGIN_COM_MAP(Source)
-		COM_INTERFACE_ENTRY(ISparkSource)
-		COM_INTERFACE_ENTRY(IVsContainedLanguageHost)
-		COM_INTERFACE_ENTRY(ISourceSupervisorEvents)
-	END_COM_MAP()
-
-	DECLARE_PROTECT_FINAL_CONSTRUCT();
-
-	HRESULT FinalConstruct();
-	
-	/**** ISparkSource ****/
-	STDMETHODIMP GetSupervisor(ISourceSupervisor** ppSupervisor) {return _supervisor.CopyTo(ppSupervisor);}
-	STDMETHODIMP SetSupervisor(ISourceSupervisor* pSupervisor);
-
-	STDMETHODIMP GetIntellisenseProjectManager(IVsIntellisenseProjectManager** ppProjectManager)
-	{
-		if (_projectManager == NULL)
-			return *ppProjectManager = NULL, S_OK;
-
-		return _projectManager->QueryInterface(ppProjectManager);
-	}
-
-    STDMETHODIMP GetContainedLanguage( 
-        /* [out] */ IVsContainedLanguage **ppContainedLanguage)
-	{
-		if (_containedLanguage == NULL)
-			return *ppContainedLanguage = NULL, S_OK;
-
-		return _containedLanguage->QueryInterface(ppContainedLanguage);
-	}
-
-    STDMETHODIMP GetTextBufferCoordinator( 
-    /* [out] */ IVsTextBufferCoordinator **ppCoordinator)
-	{
-		if (_bufferCoordinator == NULL)
-			return *ppCoordinator = NULL, S_OK;
-
-		return _bufferCoordinator->QueryInterface(ppCoordinator);
-	}
-
-	STDMETHODIMP GetDocument(
-		IVsHierarchy** ppHierarchy, 
-		VSITEMID* pItemId, 
-		IVsTextLines** pBuffer)
-	{
-		HRESULT hr = S_OK;
-		if (ppHierarchy != NULL)
-			_HR(_hierarchy.CopyTo(ppHierarchy));
-		if (pItemId != NULL)
-			*pItemId = _itemid;
-		if (pBuffer != NULL)
-			_HR(_primaryBuffer.CopyTo(pBuffer));
-		return hr;
-	}
-
-    STDMETHODIMP GetPrimaryText(BSTR *pText)
-	{
-		*pText = _primaryText.Copy();
-		return S_OK;
-	}
-
-	STDMETHODIMP GetRunningDocumentText(BSTR CanonicalName, BSTR *pText);
-
-    STDMETHODIMP GetPaint( 
-        /* [out] */ long *cPaint,
-        /* [size_is][size_is][out] */ SourcePainting **prgPaint);
-
-	STDMETHODIMP GetDefaultPageBaseType(BSTR* pPageBaseType);
-
-
-	/**** ISourceSupervisorEvents ****/
-    STDMETHODIMP OnGenerated( 
-        /* [in] */ BSTR primaryText,
-        /* [in] */ BSTR secondaryText,
-        /* [in] */ long cMappings,
-        /* [size_is][in] */ SourceMapping *rgSpans,
-		/* [in] */ long cPaints,
-		/* [size_is][in] */ SourcePainting *rgPaints);
-
-	/**** IVsContainedLanguageHost ****/
-	STDMETHODIMP Advise( 
-		/* [in] */ __RPC__in_opt IVsContainedLanguageHostEvents *pHost,
-		/* [out] */ __RPC__out VSCOOKIE *pvsCookie) {ATLTRACENOTIMPL(_T("Source::Advise"));}
-
-	STDMETHODIMP Unadvise( 
-		/* [in] */ VSCOOKIE vsCookie) {ATLTRACENOTIMPL(_T("Source::Unadvise"));}
-
-	STDMETHODIMP GetLineIndent( 
-		/* [in] */ long lLineNumber,
-		/* [out] */ __RPC__deref_out_opt BSTR *pbstrIndentString,
-		/* [out] */ __RPC__out long *plParentIndentLevel,
-		/* [out] */ __RPC__out long *plIndentSize,
-		/* [out] */ __RPC__out BOOL *pfTabs,
-		/* [out] */ __RPC__out long *plTabSize);
-
-	STDMETHODIMP CanReformatCode( 
-		/* [out] */ __RPC__out BOOL *pfCanReformat) {ATLTRACENOTIMPL(_T("Source::CanReformatCode"));}
-
-	STDMETHODIMP GetNearestVisibleToken( 
-		/* [in] */ TextSpan tsSecondaryToken,
-		/* [out] */ __RPC__out TextSpan *ptsPrimaryToken) 
-	{
-		ATLTRACE(_T("Source::GetNearestVisibleToken\r\n"));
-		*ptsPrimaryToken = tsSecondaryToken;
-		return S_OK;
-		//ATLTRACENOTIMPL(_T("Source::GetNearestVisibleToken"));
-	}
-
-	STDMETHODIMP EnsureSpanVisible( 
-		/* [in] */ TextSpan tsPrimary) {ATLTRACENOTIMPL(_T("Source::EnsureSpanVisible"));}
-
-	STDMETHODIMP QueryEditFile() {ATLTRACENOTIMPL(_T("Source::QueryEditFile"));}
-
-	STDMETHODIMP OnRenamed( 
-		/* [in] */ ContainedLanguageRenameType clrt,
-		/* [in] */ __RPC__in BSTR bstrOldID,
-		/* [in] */ __RPC__in BSTR bstrNewID) {ATLTRACENOTIMPL(_T("Source::OnRenamed"));}
-
-	STDMETHODIMP InsertControl( 
-		/* [in] */ __RPC__in const WCHAR *pwcFullType,
-		/* [in] */ __RPC__in const WCHAR *pwcID) {ATLTRACENOTIMPL(_T("Source::InsertControl"));}
-
-	STDMETHODIMP InsertReference( 
-		/* [in] */ __RPC__in const WCHAR *__MIDL__IVsContainedLanguageHost0000) {ATLTRACENOTIMPL(_T("Source::InsertReference"));}
-
-	STDMETHODIMP GetVSHierarchy( 
-		/* [out] */ __RPC__deref_out_opt IVsHierarchy **ppVsHierarchy) 
-	{
-		return _hierarchy->QueryInterface(ppVsHierarchy);
-	}
-
-	STDMETHODIMP GetErrorProviderInformation( 
-		/* [out] */ __RPC__deref_out_opt BSTR *pbstrTaskProviderName,
-		/* [out] */ __RPC__out GUID *pguidTaskProviderGuid) {ATLTRACENOTIMPL(_T("Source::GetErrorProviderInformation"));}
-
-	STDMETHODIMP InsertImportsDirective( 
-		/* [in] */ __RPC__in const WCHAR *__MIDL__IVsContainedLanguageHost0001) {ATLTRACENOTIMPL(_T("Source::InsertImportsDirective"));}
-
-	STDMETHODIMP OnContainedLanguageEditorSettingsChange() {ATLTRACENOTIMPL(_T("Source::OnContainedLanguageEditorSettingsChange"));}
-
-	STDMETHODIMP EnsureSecondaryBufferReady();
-
-
-};
-
+
+#pragma once
+
+#include "atlutil.h"
+#include "SparkLanguagePackage_i.h"
+#include "SourceNative.h"
+#include "RegenerationWindow.h"
+#include "SecondaryText.h"
+#include "GeneratedState.h"
+#include "LineIndex.h"
+#include "LanguageNative.h"
+
+
+class SourceInit
+{
+public:
+	CComPtr<IServiceProvider> _site;
+	CComPtr<IVsTextLines> _primaryBuffer;
+	CComPtr<ISparkLanguageNative> _language;
+};
+
+// A source comes up in tiers so markup can be colored before the expensive parts exist.
+// Each tier after the first is promoted from a timer, once the editor has painted.
+enum SourceTier
+{
+	// hierarchy item and supervisor - generation runs and paints spark markup
+	SourceTierMarkup = 1,
+
+	// secondary buffer and coordinator - generated code and span mappings are applied
+	SourceTierBuffers = 2,
+
+	// intellisense project manager and contained language - c# colors and intellisense
+	SourceTierContainedLanguage = 3,
+};
+
+class SecondaryBufferEventsInit
+{
+public:
+	CComPtr<IVsTextLines> _buffer;
+};
+
+// Notices edits to the secondary buffer. Source keeps the text it last applied there 
+// to diff the next generation against, and reads the buffer back only once something
+// else - the coordinator carrying typing across, or the contained language - edited it
+class ATL_NO_VTABLE SecondaryBufferEvents :
+	public CComCreatableObject<SecondaryBufferEvents, SecondaryBufferEventsInit>,
+	public IVsTextLinesEvents
+{
+	DWORD _bufferAdvise;
+	bool _edited;
+
+public:
+	SecondaryBufferEvents()
+	{
+		_bufferAdvise = 0;
+		_edited = false;
+	}
+
+	BEGIN_COM_MAP(SecondaryBufferEvents)
+		COM_INTERFACE_ENTRY(IVsTextLinesEvents)
+	END_COM_MAP()
+
+	DECLARE_PROTECT_FINAL_CONSTRUCT();
+
+	HRESULT FinalConstruct()
+	{
+		return AtlAdvise(_buffer, static_cast<IVsTextLinesEvents*>(this), __uuidof(IVsTextLinesEvents), &_bufferAdvise);
+	}
+
+	void Close()
+	{
+		if (_bufferAdvise != 0)
+		{
+			AtlUnadvise(_buffer, __uuidof(IVsTextLinesEvents), _bufferAdvise);
+			_bufferAdvise = 0;
+		}
+	}
+
+	// whether the buffer was edited since the last call
+	bool TakeEdited()
+	{
+		bool edited = _edited;
+		_edited = false;
+		return edited;
+	}
+
+	/**** IVsTextLinesEvents ****/
+	STDMETHODIMP_(void) OnChangeLineText( 
+		/* [in] */ __RPC__in const TextLineChange *pTextLineChange,
+		/* [in] */ BOOL fLast)
+	{
+		_edited = true;
+	}
+
+	STDMETHODIMP_(void) OnChangeLineAttributes( 
+		/* [in] */ long iFirstLine,
+		/* [in] */ long iLastLine)
+	{
+	}
+};
+
+class ATL_NO_VTABLE Source :
+	public CComCreatableObject<Source, SourceInit>,
+	public ISparkSource,
+	public IVsContainedLanguageHost,
+	public ISourceSupervisorEvents2,
+	public ISparkSourceNative,
+	public IVsTextLinesEvents,
+	public ISparkDiagnostics,
+	public RegenerationCallback,
+	public RegenerationJob
+{
+	CComPtr<ISourceSupervisor> _supervisor;
+	DWORD _supervisorAdvise;
+
+	// characters the supervisor's OnTypeChar acts on - a bitmap of the ascii range and a 
+	// list of anything beyond it. a supervisor which can't say is sent every character
+	DWORD _typeCharAscii[128 / 32];
+	CStringW _typeCharOther;
+	bool _typeCharAll;
+
+	CComPtr<IVsHierarchy> _hierarchy;
+	VSITEMID _itemid;
+	CComPtr<ISparkProjectContext> _projectContext;
+
+	CComPtr<IVsTextLines> _secondaryBuffer;
+	CComPtr<IVsTextBufferCoordinator> _bufferCoordinator;
+	CComPtr<IUnknown> _secondaryBufferEventsUnk;
+	SecondaryBufferEvents* _secondaryBufferEvents;
+
+	CComPtr<IVsIntellisenseProjectManager> _projectManager;
+	CComPtr<IVsContainedLanguage> _containedLanguage;
+
+	SourceTier _tier;
+	CAtlArray<ISparkSourceNativeEvents*> _containedLanguageSinks;
+
+	CComBSTR _primaryText;
+	ULONG _primaryHash;
+
+	// GetPaint's tokens of _primaryText, kept until the text changes - -1 before the first
+	PooledArray<SourcePainting> _markupPaints;
+	long _markupPaintsGeneration;
+
+	// change tracking for the primary buffer, maintained by IVsTextLinesEvents
+	DWORD _primaryBufferAdvise;
+	bool _primaryDirty;
+	long _primaryVersion;
+	long _dirtyFirstLine;
+	long _dirtyLastLine;
+
+	// line lengths of the primary buffer, updated from the same events. matches _primaryText 
+	// whenever that isn't dirty. an event that leaves it disagreeing with the buffer has it 
+	// rebuilt from the text on the next sync
+	LineIndex _primaryLines;
+	PooledArray<long> _primaryLineLengths;
+	bool _primaryLinesValid;
+
+	// decided again at each sync from the buffer's size and line count
+	LargeDocumentThresholds _largeThresholds;
+	bool _largeDocument;
+	long _deferredVersion;
+
+	// regeneration is debounced on the UI thread - _generation counts primary text changes,
+	// _requestedGeneration was last sent to the supervisor, and _generatedGeneration is 
+	// the one the current secondary buffer came from
+	DWORD _uiThreadId;
+	RegenerationWindow _regenerationWindow;
+	long _generation;
+	long _requestedGeneration;
+	long _generatedGeneration;
+	DWORD _regenerationStart;
+	DWORD _regenerationCost;
+
+	// regenerations wait in the language's queue, behind sources in more visible views.
+	// the documents a generation reads through GetRunningDocumentText are what it 
+	// includes, and a change to one of them has this source regenerate along with it
+	RegenerationScheduler* _scheduler;
+	RegenerationPriority _regenerationPriority;
+	CComBSTR _moniker;
+	CAtlArray<CStringW> _references;
+	CAtlArray<CStringW> _generationReferences;
+
+	// scratch tables for applying generated text, kept from one generation to the next
+	SecondaryTextBuffers _secondaryTextBuffers;
+
+	// mapped lines as of the last generation. once the primary buffer is edited they're
+	// out of place until the next, so the coordinator's spans - which the editor moves
+	// along with the text - are read into the live table instead, once per edit
+	SpanMappingTable _mappingTable;
+	SpanMappingTable _liveMappingTable;
+	PooledArray<NewSpanMapping> _liveMappings;
+	bool _mappingsMoved;
+	bool _liveMappingTableValid;
+
+	// what the supervisor last delivered, the base of the next OnGeneratedDelta
+	CComAutoCriticalSection _deliveredLock;
+	GeneratedState _delivered;
+
+	Diagnostics _diagnostics;
+
+public:
+	Source()
+	{
+		_supervisorAdvise = 0;
+		ZeroMemory(_typeCharAscii, sizeof(_typeCharAscii));
+		_typeCharAll = false;
+		_tier = SourceTierMarkup;
+		_secondaryBufferEvents = NULL;
+		_primaryBufferAdvise = 0;
+		_mappingsMoved = false;
+		_liveMappingTableValid = false;
+		_primaryHash = GeneratedState::HashText(NULL, 0);
+		_primaryDirty = true;
+		_primaryVersion = 0;
+		_dirtyFirstLine = -1;
+		_dirtyLastLine = -1;
+		_primaryLinesValid = false;
+		_largeThresholds.cchSize = 0;
+		_largeThresholds.cLines = 0;
+		_largeDocument = false;
+		_deferredVersion = 0;
+		_uiThreadId = 0;
+		_generation = 0;
+		_markupPaintsGeneration = -1;
+		_requestedGeneration = 0;
+		_generatedGeneration = 0;
+		_regenerationStart = 0;
+		_regenerationCost = 0;
+		_scheduler = NULL;
+		_regenerationPriority = RegenerationPriorityVisible;
+	}
+
+	BEGIN_COM_MAP(Source)
+		COM_INTERFACE_ENTRY(ISparkSource)
+		COM_INTERFACE_ENTRY(IVsContainedLanguageHost)
+		COM_INTERFACE_ENTRY(ISourceSupervisorEvents)
+		COM_INTERFACE_ENTRY(ISourceSupervisorEvents2)
+		COM_INTERFACE_ENTRY(ISparkSourceNative)
+		COM_INTERFACE_ENTRY(IVsTextLinesEvents)
+		COM_INTERFACE_ENTRY(ISparkDiagnostics)
+	END_COM_MAP()
+
+	DECLARE_PROTECT_FINAL_CONSTRUCT();
+
+	HRESULT FinalConstruct();
+	void FinalRelease();
+	
+	/**** ISparkSource ****/
+	STDMETHODIMP GetSupervisor(ISourceSupervisor** ppSupervisor) {return _supervisor.CopyTo(ppSupervisor);}
+	STDMETHODIMP SetSupervisor(ISourceSupervisor* pSupervisor);
+
+	STDMETHODIMP GetIntellisenseProjectManager(IVsIntellisenseProjectManager** ppProjectManager)
+	{
+		if (_projectManager == NULL)
+			return *ppProjectManager = NULL, S_OK;
+
+		return _projectManager->QueryInterface(ppProjectManager);
+	}
+
+    STDMETHODIMP GetContainedLanguage( 
+        /* [out] */ IVsContainedLanguage **ppContainedLanguage)
+	{
+		if (_containedLanguage == NULL)
+			return *ppContainedLanguage = NULL, S_OK;
+
+		return _containedLanguage->QueryInterface(ppContainedLanguage);
+	}
+
+    STDMETHODIMP GetTextBufferCoordinator( 
+    /* [out] */ IVsTextBufferCoordinator **ppCoordinator)
+	{
+		if (_bufferCoordinator == NULL)
+			return *ppCoordinator = NULL, S_OK;
+
+		return _bufferCoordinator->QueryInterface(ppCoordinator);
+	}
+
+	STDMETHODIMP GetDocument(
+		IVsHierarchy** ppHierarchy, 
+		VSITEMID* pItemId, 
+		IVsTextLines** pBuffer)
+	{
+		HRESULT hr = S_OK;
+		if (ppHierarchy != NULL)
+			_HR(_hierarchy.CopyTo(ppHierarchy));
+		if (pItemId != NULL)
+			*pItemId = _itemid;
+		if (pBuffer != NULL)
+			_HR(_primaryBuffer.CopyTo(pBuffer));
+		return hr;
+	}
+
+    STDMETHODIMP GetPrimaryText(BSTR *pText)
+	{
+		*pText = _primaryText.Copy();
+		return S_OK;
+	}
+
+	STDMETHODIMP GetRunningDocumentText(BSTR CanonicalName, BSTR *pText);
+
+    STDMETHODIMP GetPaint( 
+        /* [out] */ long *cPaint,
+        /* [size_is][size_is][out] */ SourcePainting **prgPaint);
+
+	STDMETHODIMP GetDefaultPageBaseType(BSTR* pPageBaseType);
+
+
+	/**** ISourceSupervisorEvents ****/
+    STDMETHODIMP OnGenerated( 
+        /* [in] */ BSTR primaryText,
+        /* [in] */ BSTR secondaryText,
+        /* [in] */ long cMappings,
+        /* [size_is][in] */ SourceMapping *rgSpans,
+		/* [in] */ long cPaints,
+		/* [size_is][in] */ SourcePainting *rgPaints);
+
+	/**** ISourceSupervisorEvents2 ****/
+	STDMETHODIMP OnGeneratedDelta( 
+		/* [in] */ long generation,
+		/* [in] */ long baseGeneration,
+		/* [in] */ long primaryLength,
+		/* [in] */ long primaryHash,
+		/* [in] */ long cTextEdits,
+		/* [size_is][in] */ GeneratedTextEdit *rgTextEdits,
+		/* [in] */ BSTR insertedText,
+		/* [in] */ long cMappingOps,
+		/* [size_is][in] */ SourceDeltaOp *rgMappingOps,
+		/* [in] */ long cMappings,
+		/* [size_is][in] */ SourceMapping *rgMappings,
+		/* [retval][out] */ BOOL *pfApplied);
+
+	/**** ISparkSourceNative ****/
+	STDMETHODIMP RefreshPrimaryText() {return SyncPrimaryText(false);}
+
+	STDMETHODIMP GetLineMappings(long iLine, const SpanMappingTable::Fragment** prgFragments, long* cFragments);
+
+	STDMETHODIMP Close();
+
+	STDMETHODIMP AdviseContainedLanguageReady(ISparkSourceNativeEvents* pSink);
+	STDMETHODIMP UnadviseContainedLanguageReady(ISparkSourceNativeEvents* pSink);
+
+	STDMETHODIMP IsTypeCharTrigger(WCHAR ch)
+	{
+		if (_typeCharAll)
+			return S_OK;
+		if (ch < 128)
+			return (_typeCharAscii[ch / 32] & (1 << (ch % 32))) ? S_OK : S_FALSE;
+		return _typeCharOther.Find(ch) != -1 ? S_OK : S_FALSE;
+	}
+
+	STDMETHODIMP GetDiagnostics(Diagnostics** ppDiagnostics)
+	{
+		*ppDiagnostics = &_diagnostics;
+		return S_OK;
+	}
+
+	STDMETHODIMP SetRegenerationPriority(RegenerationPriority priority)
+	{
+		_regenerationPriority = priority;
+		if (_scheduler != NULL)
+			_scheduler->SetPriority(this, priority);
+		return S_OK;
+	}
+
+	STDMETHODIMP ScheduleRegeneration();
+	STDMETHODIMP ReferencesDocument(LPCWSTR canonicalName);
+
+	/**** ISparkDiagnostics ****/
+	STDMETHODIMP GetCounter(SparkCounter counter, LONGLONG* pValue)
+	{
+		Diagnostics::Block block;
+		Diagnostics::Clear(block);
+		_diagnostics.Read(block);
+		return Diagnostics::GetCounter(block, counter, pValue);
+	}
+
+	STDMETHODIMP GetHistogram(SparkTiming timing, long cBuckets, LONGLONG* rgCounts, long* pcBuckets)
+	{
+		Diagnostics::Block block;
+		Diagnostics::Clear(block);
+		_diagnostics.Read(block);
+		return Diagnostics::GetHistogram(block, timing, cBuckets, rgCounts, pcBuckets);
+	}
+
+	STDMETHODIMP Dump(BSTR* pText)
+	{
+		Diagnostics::Block block;
+		Diagnostics::Clear(block);
+		_diagnostics.Read(block);
+		return Diagnostics::Dump(block, pText);
+	}
+
+	STDMETHODIMP Reset()
+	{
+		_diagnostics.Reset();
+		return S_OK;
+	}
+
+	/**** IVsTextLinesEvents ****/
+	STDMETHODIMP_(void) OnChangeLineText( 
+		/* [in] */ __RPC__in const TextLineChange *pTextLineChange,
+		/* [in] */ BOOL fLast);
+
+	STDMETHODIMP_(void) OnChangeLineAttributes( 
+		/* [in] */ long iFirstLine,
+		/* [in] */ long iLastLine)
+	{
+	}
+
+	/**** IVsContainedLanguageHost ****/
+	STDMETHODIMP Advise( 
+		/* [in] */ __RPC__in_opt IVsContainedLanguageHostEvents *pHost,
+		/* [out] */ __RPC__out VSCOOKIE *pvsCookie) {ATLTRACENOTIMPL(_T("Source::Advise"));}
+
+	STDMETHODIMP Unadvise( 
+		/* [in] */ VSCOOKIE vsCookie) {ATLTRACENOTIMPL(_T("Source::Unadvise"));}
+
+	STDMETHODIMP GetLineIndent( 
+		/* [in] */ long lLineNumber,
+		/* [out] */ __RPC__deref_out_opt BSTR *pbstrIndentString,
+		/* [out] */ __RPC__out long *plParentIndentLevel,
+		/* [out] */ __RPC__out long *plIndentSize,
+		/* [out] */ __RPC__out BOOL *pfTabs,
+		/* [out] */ __RPC__out long *plTabSize);
+
+	STDMETHODIMP CanReformatCode( 
+		/* [out] */ __RPC__out BOOL *pfCanReformat) {ATLTRACENOTIMPL(_T("Source::CanReformatCode"));}
+
+	STDMETHODIMP GetNearestVisibleToken( 
+		/* [in] */ TextSpan tsSecondaryToken,
+		/* [out] */ __RPC__out TextSpan *ptsPrimaryToken) 
+	{
+		ATLTRACE(_T("Source::GetNearestVisibleToken\r\n"));
+		*ptsPrimaryToken = tsSecondaryToken;
+		return S_OK;
+		//ATLTRACENOTIMPL(_T("Source::GetNearestVisibleToken"));
+	}
+
+	STDMETHODIMP EnsureSpanVisible( 
+		/* [in] */ TextSpan tsPrimary) {ATLTRACENOTIMPL(_T("Source::EnsureSpanVisible"));}
+
+	STDMETHODIMP QueryEditFile() {ATLTRACENOTIMPL(_T("Source::QueryEditFile"));}
+
+	STDMETHODIMP OnRenamed( 
+		/* [in] */ ContainedLanguageRenameType clrt,
+		/* [in] */ __RPC__in BSTR bstrOldID,
+		/* [in] */ __RPC__in BSTR bstrNewID) {ATLTRACENOTIMPL(_T("Source::OnRenamed"));}
+
+	STDMETHODIMP InsertControl( 
+		/* [in] */ __RPC__in const WCHAR *pwcFullType,
+		/* [in] */ __RPC__in const WCHAR *pwcID) {ATLTRACENOTIMPL(_T("Source::InsertControl"));}
+
+	STDMETHODIMP InsertReference( 
+		/* [in] */ __RPC__in const WCHAR *__MIDL__IVsContainedLanguageHost0000) {ATLTRACENOTIMPL(_T("Source::InsertReference"));}
+
+	STDMETHODIMP GetVSHierarchy( 
+		/* [out] */ __RPC__deref_out_opt IVsHierarchy **ppVsHierarchy) 
+	{
+		return _hierarchy->QueryInterface(ppVsHierarchy);
+	}
+
+	STDMETHODIMP GetErrorProviderInformation( 
+		/* [out] */ __RPC__deref_out_opt BSTR *pbstrTaskProviderName,
+		/* [out] */ __RPC__out GUID *pguidTaskProviderGuid) {ATLTRACENOTIMPL(_T("Source::GetErrorProviderInformation"));}
+
+	STDMETHODIMP InsertImportsDirective( 
+		/* [in] */ __RPC__in const WCHAR *__MIDL__IVsContainedLanguageHost0001) {ATLTRACENOTIMPL(_T("Source::InsertImportsDirective"));}
+
+	STDMETHODIMP OnContainedLanguageEditorSettingsChange() {ATLTRACENOTIMPL(_T("Source::OnContainedLanguageEditorSettingsChange"));}
+
+	STDMETHODIMP EnsureSecondaryBufferReady() 
+	{
+		DiagnosticsTimer timer(_diagnostics, SparkTimingEnsureSecondaryBufferReady);
+		return SyncPrimaryText(true);
+	}
+
+	/**** RegenerationCallback ****/
+	void OnRegenerationDue();
+	void OnGeneratedResult(GeneratedResult* pResult);
+	void OnPromotionDue();
+
+	/**** RegenerationJob ****/
+	void RunRegeneration();
+
+private:
+	HRESULT Promote();
+	HRESULT CreateBuffers();
+	HRESULT CreateContainedLanguage();
+
+	void LoadTypeCharTriggers();
+	HRESULT SyncPrimaryText(bool fImmediate);
+	HRESULT UpdatePrimaryLines(const TextLineChange* pTextLineChange);
+	HRESULT UpdateLargeDocument();
+	HRESULT ReadPrimaryText(CComBSTR& primaryText);
+	HRESULT ReadPrimaryTextChanges(CComBSTR& primaryText);
+	HRESULT Regenerate(bool fImmediate);
+	HRESULT Generate(ISourceSupervisor* pSupervisor);
+	HRESULT BuildLiveMappingTable();
+	HRESULT ApplyGenerated(
+		long primaryLength, ULONG primaryHash, 
+		const WCHAR* pSecondaryText, long cchSecondary, 
+		const SourceMapping* rgSpans, long cMappings);
+	DWORD GetRegenerationDelay();
+
+};
+
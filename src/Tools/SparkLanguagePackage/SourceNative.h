@@ -0,0 +1,51 @@
+
+#pragma once
+
+#include "SpanMappingTable.h"
+#include "Diagnostics.h"
+#include "RegenerationScheduler.h"
+
+// Implemented by objects which need a source's contained language and may be created 
+// before the source has finished bringing it up
+interface __declspec(uuid("3b68cb4d-628f-46de-a336-4ae987f0eab3")) __declspec(novtable) 
+ISparkSourceNativeEvents : public IUnknown
+{
+	STDMETHOD(OnContainedLanguageReady)() PURE;
+};
+
+// In-process view of a Source used by the other native objects of this package.
+// Not part of the type library - pointers returned remain owned by the Source.
+interface __declspec(uuid("2b6b439b-f398-414a-81db-cd0ebd9ac482")) __declspec(novtable) 
+ISparkSourceNative : public IUnknown
+{
+	// picks up primary buffer edits, scheduling a debounced regeneration when text changed
+	STDMETHOD(RefreshPrimaryText)() PURE;
+
+	// mapped fragments of the primary buffer line, valid until the next generation
+	STDMETHOD(GetLineMappings)(long iLine, const SpanMappingTable::Fragment** prgFragments, long* cFragments) PURE;
+
+	// breaks the connections holding the source alive once its document has closed
+	STDMETHOD(Close)() PURE;
+
+	// S_FALSE when the contained language is already available. the sink is not 
+	// referenced, and must unadvise before it goes away
+	STDMETHOD(AdviseContainedLanguageReady)(ISparkSourceNativeEvents* pSink) PURE;
+	STDMETHOD(UnadviseContainedLanguageReady)(ISparkSourceNativeEvents* pSink) PURE;
+
+	// S_OK when the supervisor wants to hear about the character being typed, otherwise S_FALSE
+	STDMETHOD(IsTypeCharTrigger)(WCHAR ch) PURE;
+
+	// counters the source's colorizer and the language add to, alive as long as the source
+	STDMETHOD(GetDiagnostics)(Diagnostics** ppDiagnostics) PURE;
+
+	// where the source's regenerations go in the language's queue, from its views' state
+	STDMETHOD(SetRegenerationPriority)(RegenerationPriority priority) PURE;
+
+	// queues a regeneration of unchanged text, for when a document it includes changed.
+	// S_FALSE when the source doesn't regenerate in the background
+	STDMETHOD(ScheduleRegeneration)() PURE;
+
+	// S_OK when its last generation read the document - a layout, partial or _global.spark
+	// it includes - otherwise S_FALSE
+	STDMETHOD(ReferencesDocument)(LPCWSTR canonicalName) PURE;
+};
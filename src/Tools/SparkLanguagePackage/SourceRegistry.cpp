@@ -0,0 +1,151 @@
+#include "stdafx.h"
+#include "SourceRegistry.h"
+
+SourceRegistry::SourceRegistry()
+{
+	InitializeSRWLock(&_lock);
+	Diagnostics::Clear(_retiredDiagnostics);
+}
+
+SourceRegistry::~SourceRegistry()
+{
+	CInterfaceArray<IUnknown> sources;
+	RemoveAll(sources);
+}
+
+HRESULT SourceRegistry::Lookup(IUnknown* pKey, IUnknown** ppSource)
+{
+	*ppSource = NULL;
+
+	AcquireSRWLockShared(&_lock);
+	Entry entry;
+	if (_entries.Lookup(pKey, entry))
+	{
+		*ppSource = entry.source;
+		entry.source->AddRef();
+	}
+	ReleaseSRWLockShared(&_lock);
+
+	return *ppSource != NULL ? S_OK : S_FALSE;
+}
+
+HRESULT SourceRegistry::GetOrCreate(IUnknown* pKey, SourceFactory* pFactory, IUnknown** ppSource)
+{
+	if (Lookup(pKey, ppSource) == S_OK)
+		return S_OK;
+
+	HRESULT hr = S_OK;
+	CComPtr<IUnknown> source;
+	Diagnostics* pDiagnostics = NULL;
+	_HR(pFactory->CreateSource(pKey, &source, &pDiagnostics));
+	if (FAILED(hr))
+		return hr;
+
+	// whatever was registered while this one was made is the one everyone else has
+	CComPtr<IUnknown> registered;
+	AcquireSRWLockExclusive(&_lock);
+	Entry entry;
+	if (_entries.Lookup(pKey, entry))
+	{
+		registered = entry.source;
+	}
+	else
+	{
+		entry.source = source;
+		entry.diagnostics = pDiagnostics;
+		_entries.SetAt(pKey, entry);
+		pKey->AddRef();
+		source->AddRef();
+	}
+	ReleaseSRWLockExclusive(&_lock);
+
+	if (registered != NULL)
+	{
+		pFactory->DiscardSource(source);
+		*ppSource = registered.Detach();
+		return S_OK;
+	}
+
+	*ppSource = source.Detach();
+	return S_OK;
+}
+
+HRESULT SourceRegistry::Remove(IUnknown* pKey, IUnknown** ppSource)
+{
+	*ppSource = NULL;
+
+	IUnknown* registeredKey = NULL;
+	AcquireSRWLockExclusive(&_lock);
+	CAtlMap<IUnknown*, Entry>::CPair* pair = _entries.Lookup(pKey);
+	if (pair != NULL)
+	{
+		registeredKey = pair->m_key;
+		*ppSource = pair->m_value.source;
+		if (pair->m_value.diagnostics != NULL)
+			pair->m_value.diagnostics->Read(_retiredDiagnostics);
+		_entries.RemoveKey(pKey);
+	}
+	ReleaseSRWLockExclusive(&_lock);
+
+	// released outside the lock, where the buffer may do as it likes
+	if (registeredKey != NULL)
+		registeredKey->Release();
+	return *ppSource != NULL ? S_OK : S_FALSE;
+}
+
+void SourceRegistry::GetSources(CInterfaceArray<IUnknown>& sources)
+{
+	AcquireSRWLockShared(&_lock);
+	for (POSITION pos = _entries.GetStartPosition(); pos != NULL; )
+		sources.Add(_entries.GetNextValue(pos).source);
+	ReleaseSRWLockShared(&_lock);
+}
+
+void SourceRegistry::RemoveAll(CInterfaceArray<IUnknown>& sources)
+{
+	CAtlArray<IUnknown*> keys;
+	AcquireSRWLockExclusive(&_lock);
+	for (POSITION pos = _entries.GetStartPosition(); pos != NULL; )
+	{
+		CAtlMap<IUnknown*, Entry>::CPair* pair = _entries.GetNext(pos);
+		keys.Add(pair->m_key);
+
+		// the array takes over the registry's reference
+		size_t index = sources.Add(NULL);
+		sources[index].Attach(pair->m_value.source);
+		if (pair->m_value.diagnostics != NULL)
+			pair->m_value.diagnostics->Read(_retiredDiagnostics);
+	}
+	_entries.RemoveAll();
+	ReleaseSRWLockExclusive(&_lock);
+
+	for (size_t index = 0; index != keys.GetCount(); ++index)
+		keys[index]->Release();
+}
+
+void SourceRegistry::ReadDiagnostics(Diagnostics::Block& block)
+{
+	AcquireSRWLockShared(&_lock);
+	block = _retiredDiagnostics;
+	for (POSITION pos = _entries.GetStartPosition(); pos != NULL; )
+	{
+		Diagnostics* pDiagnostics = _entries.GetNextValue(pos).diagnostics;
+		if (pDiagnostics != NULL)
+			pDiagnostics->Read(block);
+	}
+	ReleaseSRWLockShared(&_lock);
+}
+
+void SourceRegistry::ResetDiagnostics()
+{
+	// resets are safe alongside reads, but the retired totals are the registry's own
+	AcquireSRWLockExclusive(&_lock);
+	Diagnostics::Clear(_retiredDiagnostics);
+	for (POSITION pos = _entries.GetStartPosition(); pos != NULL; )
+	{
+		Diagnostics* pDiagnostics = _entries.GetNextValue(pos).diagnostics;
+		if (pDiagnostics != NULL)
+			pDiagnostics->Reset();
+	}
+	ReleaseSRWLockExclusive(&_lock);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "atlutil.h"
+#include "Diagnostics.h"
+
+// How SourceRegistry makes a source for a buffer it doesn't have one for. Language 
+// implements it over Source and the supervisor - anything counting references can 
+// stand in, with no editor running.
+class SourceFactory
+{
+public:
+	virtual ~SourceFactory() {}
+
+	// a source ready for use, and the figures it keeps
+	virtual HRESULT CreateSource(IUnknown* pKey, IUnknown** ppSource, Diagnostics** ppDiagnostics) = 0;
+
+	// a source made for a buffer another thread registered one for first
+	virtual void DiscardSource(IUnknown* pSource) = 0;
+};
+
+// The sources of open documents, keyed by the IUnknown of their primary buffer, with a 
+// reference held on each key and source. The lock covers the map and nothing else - 
+// sources are created, queried and closed outside it, so any of that calling back 
+// into the language can't deadlock. Lookups share the lock; adding and removing take 
+// it exclusively. Figures of removed sources stay in the totals.
+class SourceRegistry
+{
+	struct Entry
+	{
+		IUnknown* source;
+		Diagnostics* diagnostics;
+	};
+
+	SRWLOCK _lock;
+	CAtlMap<IUnknown*, Entry> _entries;
+	Diagnostics::Block _retiredDiagnostics;
+
+	SourceRegistry(const SourceRegistry&);
+	SourceRegistry& operator=(const SourceRegistry&);
+
+public:
+	SourceRegistry();
+	~SourceRegistry();
+
+	// the source registered for pKey, or none with S_FALSE
+	HRESULT Lookup(IUnknown* pKey, IUnknown** ppSource);
+
+	// the source registered for pKey, made by pFactory when there isn't one. two threads
+	// asking at once may each make one - the first to register it wins, and the other's
+	// is discarded
+	HRESULT GetOrCreate(IUnknown* pKey, SourceFactory* pFactory, IUnknown** ppSource);
+
+	// takes the entry for pKey out, handing back the source, or none with S_FALSE
+	HRESULT Remove(IUnknown* pKey, IUnknown** ppSource);
+
+	// every source registered, copied out to be called outside the lock
+	void GetSources(CInterfaceArray<IUnknown>& sources);
+
+	// takes out every entry, handing back the sources
+	void RemoveAll(CInterfaceArray<IUnknown>& sources);
+
+	void ReadDiagnostics(Diagnostics::Block& block);
+	void ResetDiagnostics();
+};
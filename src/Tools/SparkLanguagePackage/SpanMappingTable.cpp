@@ -0,0 +1,131 @@
+
+#include "stdafx.h"
+#include "SpanMappingTable.h"
+
+void SpanMappingTable::Build(const NewSpanMapping* rgMappings, long cMappings)
+{
+	Clear();
+
+	long iLastLine = -1;
+	for (long index = 0; index != cMappings; ++index)
+	{
+		if (rgMappings[index].tspSpans.span1.iEndLine > iLastLine)
+			iLastLine = rgMappings[index].tspSpans.span1.iEndLine;
+	}
+	if (iLastLine < 0)
+		return;
+
+	// count the fragments on each line, then turn the counts into starting positions
+	_lineFirst.SetCount(iLastLine + 2);
+	for (long iLine = 0; iLine != iLastLine + 2; ++iLine)
+		_lineFirst[iLine] = 0;
+
+	for (long index = 0; index != cMappings; ++index)
+	{
+		const TextSpan& span = rgMappings[index].tspSpans.span1;
+		if (span.iStartLine < 0 || span.iEndLine < span.iStartLine)
+			continue;
+		for (long iLine = span.iStartLine; iLine <= span.iEndLine; ++iLine)
+			++_lineFirst[iLine + 1];
+	}
+
+	for (long iLine = 0; iLine != iLastLine + 1; ++iLine)
+		_lineFirst[iLine + 1] += _lineFirst[iLine];
+
+	_fragments.SetCount(_lineFirst[iLastLine + 1]);
+
+	_lineNext.SetCount(iLastLine + 1);
+	for (long iLine = 0; iLine != iLastLine + 1; ++iLine)
+		_lineNext[iLine] = _lineFirst[iLine];
+
+	for (long index = 0; index != cMappings; ++index)
+	{
+		const TextSpan& span = rgMappings[index].tspSpans.span1;
+		if (span.iStartLine < 0 || span.iEndLine < span.iStartLine)
+			continue;
+		for (long iLine = span.iStartLine; iLine <= span.iEndLine; ++iLine)
+		{
+			Fragment& fragment = _fragments[_lineNext[iLine]++];
+			fragment.iStartIndex = (iLine == span.iStartLine) ? span.iStartIndex : 0;
+			fragment.iEndIndex = (iLine == span.iEndLine) ? span.iEndIndex : -1;
+		}
+	}
+
+	MergeRuns(iLastLine);
+}
+
+static inline long RunEnd(const SpanMappingTable::Fragment& fragment)
+{
+	return fragment.iEndIndex == -1 ? LONG_MAX : fragment.iEndIndex;
+}
+
+static bool FragmentLess(const SpanMappingTable::Fragment& a, const SpanMappingTable::Fragment& b)
+{
+	return a.iStartIndex < b.iStartIndex;
+}
+
+void SpanMappingTable::MergeRuns(long iLastLine)
+{
+	// compacts each line in place - a line's runs never start after its fragments did
+	size_t output = 0;
+	for (long iLine = 0; iLine != iLastLine + 1; ++iLine)
+	{
+		size_t first = _lineFirst[iLine];
+		size_t end = _lineFirst[iLine + 1];
+		_lineFirst[iLine] = output;
+		if (first == end)
+			continue;
+
+		Fragment* rgFragments = _fragments.GetData();
+		std::sort(rgFragments + first, rgFragments + end, FragmentLess);
+
+		Fragment run = rgFragments[first];
+		for (size_t index = first + 1; index != end; ++index)
+		{
+			if (rgFragments[index].iStartIndex <= RunEnd(run))
+			{
+				if (RunEnd(rgFragments[index]) > RunEnd(run))
+					run.iEndIndex = rgFragments[index].iEndIndex;
+				continue;
+			}
+			rgFragments[output++] = run;
+			run = rgFragments[index];
+		}
+		rgFragments[output++] = run;
+	}
+	_lineFirst[iLastLine + 1] = output;
+	_fragments.SetCount(output);
+}
+
+void SpanMappingTable::Clear()
+{
+	_fragments.RemoveAll();
+	_lineFirst.RemoveAll();
+}
+
+bool SpanMappingTable::ClampToLine(const Fragment& fragment, long cchLine, long* piStart, long* piEnd)
+{
+	long iStart = fragment.iStartIndex;
+	long iEnd = fragment.iEndIndex == -1 ? cchLine : fragment.iEndIndex;
+	if (iStart < 0)
+		iStart = 0;
+	if (iEnd > cchLine)
+		iEnd = cchLine;
+
+	*piStart = iStart;
+	*piEnd = iEnd;
+	return iStart < iEnd;
+}
+
+const SpanMappingTable::Fragment* SpanMappingTable::GetLine(long iLine, long* cFragments) const
+{
+	if (iLine < 0 || (size_t)iLine + 1 >= _lineFirst.GetCount())
+	{
+		*cFragments = 0;
+		return NULL;
+	}
+
+	size_t first = _lineFirst[iLine];
+	*cFragments = (long)(_lineFirst[iLine + 1] - first);
+	return *cFragments == 0 ? NULL : _fragments.GetData() + first;
+}
@@ -0,0 +1,38 @@
+
+#pragma once
+
+#include "PooledArray.h"
+
+// Primary buffer span mappings arranged by line. Each line holds the fragments of 
+// the mappings which touch it, so a colorizer can go straight to the contained 
+// language spans of one line without enumerating the coordinator. Fragments which 
+// overlap or touch are merged into one run, in order of position on the line.
+class SpanMappingTable
+{
+public:
+	struct Fragment
+	{
+		long iStartIndex;
+		long iEndIndex; // -1 when the mapping continues past the end of the line
+	};
+
+	void Build(const NewSpanMapping* rgMappings, long cMappings);
+	void Clear();
+
+	const Fragment* GetLine(long iLine, long* cFragments) const;
+
+	// the columns of a fragment on a line of cchLine characters. a table from an earlier 
+	// generation can reach past a line an edit has shortened since, so both ends are kept 
+	// to the line - false when nothing of the fragment is left on it
+	static bool ClampToLine(const Fragment& fragment, long cchLine, long* piStart, long* piEnd);
+
+private:
+	void MergeRuns(long iLastLine);
+
+	// fragments for line n are _fragments[_lineFirst[n].._lineFirst[n+1]]
+	PooledArray<Fragment> _fragments;
+	PooledArray<size_t> _lineFirst;
+
+	// fill position of each line while building
+	PooledArray<size_t> _lineNext;
+};
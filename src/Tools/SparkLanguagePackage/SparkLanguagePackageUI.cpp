@@ -1,6 +1,6 @@
-// SparkLanguagePackageUI.cpp : Defines the exported functions for the DLL application.
-//
-
-
-
-
+// SparkLanguagePackageUI.cpp : Defines the exported functions for the DLL application.
+//
+
+
+
+
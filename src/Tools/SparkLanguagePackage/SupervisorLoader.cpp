@@ -0,0 +1,151 @@
+
+#include "stdafx.h"
+#include "SupervisorLoader.h"
+#include "LanguageSettings.h"
+
+static CComBSTR GetModulePath()
+{
+	WCHAR wszModule[MAX_PATH + 2];
+	DWORD dwModuleLength = GetModuleFileNameW(_AtlBaseModule.GetModuleInstance(), wszModule, MAX_PATH);
+
+	while (dwModuleLength != 0 && wszModule[dwModuleLength - 1] != L'\\')
+		wszModule[--dwModuleLength] = '\0';
+
+	return wszModule;
+}
+
+SupervisorLoader::SupervisorLoader()
+{
+	_loaded = CreateEvent(NULL, TRUE, FALSE, NULL);
+	_started = FALSE;
+	_hrLoad = E_PENDING;
+	ZeroMemory(&_timings, sizeof(_timings));
+}
+
+SupervisorLoader::~SupervisorLoader()
+{
+	if (_loaded != NULL)
+		CloseHandle(_loaded);
+}
+
+SupervisorStartup SupervisorLoader::ReadStartup(IServiceProvider* pSite)
+{
+	DWORD dwStartup = 0;
+	if (LanguageSettings::ReadDWORD(pSite, L"SupervisorStartup", &dwStartup) && 
+		dwStartup <= SupervisorStartupImmediate)
+	{
+		return (SupervisorStartup)dwStartup;
+	}
+	return SupervisorStartupDeferred;
+}
+
+HRESULT SupervisorLoader::BeginLoad(IUnknown* pOwner)
+{
+	if (InterlockedExchange(&_started, TRUE))
+		return S_FALSE;
+
+	LoadContext* context = new LoadContext;
+	context->_loader = this;
+	context->_owner = pOwner;
+	if (!QueueUserWorkItem(LoadProc, context, WT_EXECUTELONGFUNCTION))
+	{
+		delete context;
+		Load();
+		return _hrLoad;
+	}
+	return S_OK;
+}
+
+DWORD WINAPI SupervisorLoader::LoadProc(void* pv)
+{
+	LoadContext* context = (LoadContext*)pv;
+
+	// the clr's com callable wrappers are agile, so the supervisor created here 
+	// is used directly from the ui thread
+	HRESULT hrInit = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+	context->_loader->Load();
+
+	// the owner reference goes before the apartment it may have been used in
+	delete context;
+	if (SUCCEEDED(hrInit))
+		CoUninitialize();
+	return 0;
+}
+
+HRESULT SupervisorLoader::GetSupervisor(ILanguageSupervisor** ppSupervisor)
+{
+	*ppSupervisor = NULL;
+
+	if (!InterlockedExchange(&_started, TRUE))
+	{
+		Load();
+	}
+	else if (WaitForSingleObject(_loaded, 0) == WAIT_TIMEOUT)
+	{
+		// keep pumping - the caller is usually the ui thread
+		DWORD dwStart = GetTickCount();
+		DWORD dwIndex = 0;
+		CoWaitForMultipleHandles(0, INFINITE, 1, &_loaded, &dwIndex);
+		_timings.dwWait += GetTickCount() - dwStart;
+
+		ATLTRACE(SUPERVISOR_STARTUP, 1, L"waited %u ms for background load\n", GetTickCount() - dwStart);
+	}
+
+	CComCritSecLock<CComCriticalSection> lock(_lock);
+	if (FAILED(_hrLoad))
+		return _hrLoad;
+	return _supervisor.CopyTo(ppSupervisor);
+}
+
+void SupervisorLoader::Load()
+{
+	HRESULT hr = S_OK;
+	DWORD dwStart = GetTickCount();
+
+	// Create an appdomain based out of the location of this com dll. 
+	// Managed Spark.dll and SparkLanguage.dll assemblies are in the same location
+	CComPtr<ICorRuntimeHost> pRuntime;		
+	_HR(CorBindToRuntimeEx(NULL, NULL, 0, CLSID_CorRuntimeHost, __uuidof(pRuntime), (void**)&pRuntime));
+	DWORD dwBound = GetTickCount();
+
+	CComPtr<IUnknown> punkSetup;
+	_HR(pRuntime->CreateDomainSetup(&punkSetup));
+
+	CComPtr<mscorlib::IAppDomainSetup> domainSetup;
+	_HR(punkSetup->QueryInterface(&domainSetup));
+	_HR(domainSetup->put_ApplicationBase(GetModulePath()));
+	_HR(domainSetup->put_ApplicationName(CComBSTR(L"Spark Language Package Domain")));
+
+	CComPtr<IUnknown> punkDomain;
+	_HR(pRuntime->CreateDomainEx(L"Spark Language", punkSetup, NULL, &punkDomain));
+
+	CComPtr<mscorlib::_AppDomain> appDomain;
+	_HR(punkDomain->QueryInterface(&appDomain));
+	DWORD dwDomain = GetTickCount();
+
+
+	// Create a LanguageSupervisor (and CCW) that is the root of all access into managed code
+	CComPtr<mscorlib::_ObjectHandle> supervisorHandle = NULL;
+	_HR(appDomain->CreateInstance(CComBSTR(L"SparkLanguage"), CComBSTR(L"SparkLanguage.LanguageSupervisor"), &supervisorHandle));
+
+	CComVariant varSupervisor;
+	_HR(supervisorHandle->Unwrap(&varSupervisor));
+	_HR(varSupervisor.ChangeType(VT_UNKNOWN));
+
+	CComPtr<ILanguageSupervisor> supervisor;
+	_HR(V_UNKNOWN(&varSupervisor)->QueryInterface(&supervisor));
+	DWORD dwCreated = GetTickCount();
+
+	{
+		CComCritSecLock<CComCriticalSection> lock(_lock);
+		_timings.dwBindRuntime = dwBound - dwStart;
+		_timings.dwCreateDomain = dwDomain - dwBound;
+		_timings.dwCreateSupervisor = dwCreated - dwDomain;
+		_supervisor = supervisor;
+		_hrLoad = hr;
+	}
+	SetEvent(_loaded);
+
+	ATLTRACE(SUPERVISOR_STARTUP, 1, L"0x%08x bind runtime %u ms, create domain %u ms, create supervisor %u ms\n", 
+		hr, _timings.dwBindRuntime, _timings.dwCreateDomain, _timings.dwCreateSupervisor);
+}
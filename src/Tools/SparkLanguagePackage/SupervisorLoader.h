@@ -0,0 +1,66 @@
+
+#pragma once
+
+#include "atlutil.h"
+#include "SparkLanguagePackage_i.h"
+
+__declspec(selectany) CTraceCategory SUPERVISOR_STARTUP(_T("Supervisor startup"), 1);
+
+// How the managed LanguageSupervisor is brought up, from the SupervisorStartup value 
+// of the Spark language service registry key
+enum SupervisorStartup
+{
+	// when a spark document first needs it - a solution without views never loads the clr
+	SupervisorStartupDeferred = 0,
+
+	// on a worker thread as soon as the package is sited
+	SupervisorStartupBackground = 1,
+
+	// while the package is sited, as it always used to be
+	SupervisorStartupImmediate = 2,
+};
+
+struct SupervisorTimings
+{
+	DWORD dwBindRuntime;
+	DWORD dwCreateDomain;
+	DWORD dwCreateSupervisor;
+	// time a caller spent blocked waiting for a background load to finish
+	DWORD dwWait;
+};
+
+// Binds the clr, creates the Spark Language appdomain and the LanguageSupervisor in it - 
+// the root of all access into managed code. Loads at most once.
+class SupervisorLoader
+{
+	CComAutoCriticalSection _lock;
+	HANDLE _loaded;
+	volatile LONG _started;
+	HRESULT _hrLoad;
+	CComPtr<ILanguageSupervisor> _supervisor;
+	SupervisorTimings _timings;
+
+public:
+	SupervisorLoader();
+	~SupervisorLoader();
+
+	static SupervisorStartup ReadStartup(IServiceProvider* pSite);
+
+	// starts loading on a worker thread, holding the owner alive until it's done
+	HRESULT BeginLoad(IUnknown* pOwner);
+
+	// loads on the calling thread, or waits for a load already under way
+	HRESULT GetSupervisor(ILanguageSupervisor** ppSupervisor);
+
+	const SupervisorTimings& GetTimings() const {return _timings;}
+
+private:
+	struct LoadContext
+	{
+		SupervisorLoader* _loader;
+		CComPtr<IUnknown> _owner;
+	};
+	static DWORD WINAPI LoadProc(void* pv);
+
+	void Load();
+};
@@ -0,0 +1,229 @@
+
+#include "stdafx.h"
+#include "TextDiff.h"
+
+size_t TextDiff::CommonPrefix(const WCHAR* pText1, const WCHAR* pText2, size_t length)
+{
+	size_t index = 0;
+	for (; index + 8 <= length; index += 8)
+	{
+		__m128i block1 = _mm_loadu_si128((const __m128i*)(pText1 + index));
+		__m128i block2 = _mm_loadu_si128((const __m128i*)(pText2 + index));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(block1, block2));
+		if (mask != 0xffff)
+		{
+			unsigned long bit = 0;
+			_BitScanForward(&bit, ~mask & 0xffff);
+			return index + bit / 2;
+		}
+	}
+
+	while (index != length && pText1[index] == pText2[index])
+		++index;
+	return index;
+}
+
+size_t TextDiff::CommonSuffix(const WCHAR* pEnd1, const WCHAR* pEnd2, size_t length)
+{
+	size_t count = 0;
+	for (; count + 8 <= length; count += 8)
+	{
+		__m128i block1 = _mm_loadu_si128((const __m128i*)(pEnd1 - count - 8));
+		__m128i block2 = _mm_loadu_si128((const __m128i*)(pEnd2 - count - 8));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(block1, block2));
+		if (mask != 0xffff)
+		{
+			unsigned long bit = 0;
+			_BitScanReverse(&bit, ~mask & 0xffff);
+			return count + 7 - bit / 2;
+		}
+	}
+
+	while (count != length && pEnd1[-(long)count - 1] == pEnd2[-(long)count - 1])
+		++count;
+	return count;
+}
+
+void TextDiff::LineRange::Hash(long iEnd)
+{
+	hashes.SetCount(iEnd - iFirst);
+	for (long iLine = iFirst; iLine != iEnd; ++iLine)
+	{
+		// FNV-1a over the line including its line break
+		ULONG hash = 2166136261;
+		const WCHAR* pch = pText + pLines->GetLineStart(iLine);
+		const WCHAR* pchEnd = pText + pLines->GetLineStart(iLine + 1);
+		for (; pch != pchEnd; ++pch)
+			hash = (hash ^ *pch) * 16777619;
+		hashes[iLine - iFirst] = hash;
+	}
+}
+
+bool TextDiff::LineRange::Equals(long iLine, const LineRange& other, long iOtherLine) const
+{
+	if (hashes[iLine] != other.hashes[iOtherLine])
+		return false;
+
+	long iStart = pLines->GetLineStart(iFirst + iLine);
+	long length = pLines->GetLineStart(iFirst + iLine + 1) - iStart;
+	long iOtherStart = other.pLines->GetLineStart(other.iFirst + iOtherLine);
+	long otherLength = other.pLines->GetLineStart(other.iFirst + iOtherLine + 1) - iOtherStart;
+
+	return length == otherLength && 
+		CommonPrefix(pText + iStart, other.pText + iOtherStart, length) == (size_t)length;
+}
+
+void TextDiff::DiffLines(
+	const WCHAR* pOldText, const LineTable& oldLines, 
+	const WCHAR* pNewText, const LineTable& newLines, 
+	PooledArray<TextHunk>& hunks)
+{
+	hunks.RemoveAll();
+
+	long oldLength = oldLines.GetLength();
+	long newLength = newLines.GetLength();
+	long shorter = oldLength < newLength ? oldLength : newLength;
+
+	long prefix = (long)CommonPrefix(pOldText, pNewText, shorter);
+	if (prefix == oldLength && prefix == newLength)
+		return;
+	long suffix = (long)CommonSuffix(pOldText + oldLength, pNewText + newLength, shorter - prefix);
+
+	// whole lines inside the common prefix. the character after each one must be common 
+	// as well, so a "\r" can't be taken for a line break that the other text has as "\r\n"
+	long iFirst = 0;
+	while (oldLines.GetLineStart(iFirst + 1) < prefix)
+		++iFirst;
+
+	// whole lines inside the common suffix, including the character before each one
+	long iOldEnd = oldLines.GetLineCount();
+	long iNewEnd = newLines.GetLineCount();
+	while (iOldEnd > iFirst && iNewEnd > iFirst &&
+		oldLines.GetLineStart(iOldEnd - 1) - 1 >= oldLength - suffix)
+	{
+		--iOldEnd;
+		--iNewEnd;
+	}
+
+	LineRange oldRange;
+	oldRange.pText = pOldText;
+	oldRange.pLines = &oldLines;
+	oldRange.iFirst = iFirst;
+	oldRange.Hash(iOldEnd);
+
+	LineRange newRange;
+	newRange.pText = pNewText;
+	newRange.pLines = &newLines;
+	newRange.iFirst = iFirst;
+	newRange.Hash(iNewEnd);
+
+	if (!Myers(oldRange, iOldEnd - iFirst, newRange, iNewEnd - iFirst, hunks) || 
+		hunks.GetCount() > MaximumHunks)
+	{
+		// too different to be worth many small replacements
+		hunks.RemoveAll();
+		TextHunk hunk = {iFirst, iOldEnd, iFirst, iNewEnd};
+		hunks.Add(hunk);
+	}
+}
+
+bool TextDiff::Myers(
+	const LineRange& oldRange, long cOld, 
+	const LineRange& newRange, long cNew, 
+	PooledArray<TextHunk>& hunks)
+{
+	long maximumEdits = cOld + cNew;
+	if (maximumEdits > MaximumEdits)
+		maximumEdits = MaximumEdits;
+
+	// v[offset + k] is the furthest old line reached on diagonal k = x - y. the values 
+	// v held for diagonals -d..d before round d are kept in trace starting at d*d
+	long offset = maximumEdits + 1;
+	CAtlArray<long> v;
+	v.SetCount(2 * offset + 1);
+	for (size_t index = 0; index != v.GetCount(); ++index)
+		v[index] = 0;
+
+	CAtlArray<long> trace;
+	long cEdits = -1;
+	for (long d = 0; d <= maximumEdits && cEdits == -1; ++d)
+	{
+		for (long k = -d; k <= d; ++k)
+			trace.Add(v[offset + k]);
+
+		for (long k = -d; k <= d; k += 2)
+		{
+			long x;
+			if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+				x = v[offset + k + 1];
+			else
+				x = v[offset + k - 1] + 1;
+
+			long y = x - k;
+			while (x < cOld && y < cNew && oldRange.Equals(x, newRange, y))
+			{
+				++x;
+				++y;
+			}
+			v[offset + k] = x;
+
+			if (x >= cOld && y >= cNew)
+			{
+				cEdits = d;
+				break;
+			}
+		}
+	}
+
+	if (cEdits == -1)
+		return false;
+
+	// walk back through the rounds collecting the lines that matched along diagonals
+	CAtlArray<long> matches;
+	long x = cOld;
+	long y = cNew;
+	for (long d = cEdits; d >= 0; --d)
+	{
+		const long* pv = trace.GetData() + d * d + d; // pv[k] for -d <= k <= d
+		long k = x - y;
+		long previousX = 0;
+		long previousY = 0;
+		if (d != 0)
+		{
+			long previousK = (k == -d || (k != d && pv[k - 1] < pv[k + 1])) ? k + 1 : k - 1;
+			previousX = pv[previousK];
+			previousY = previousX - previousK;
+		}
+
+		while (x > previousX && y > previousY)
+		{
+			--x;
+			--y;
+			matches.Add(x);
+			matches.Add(y);
+		}
+		x = previousX;
+		y = previousY;
+	}
+
+	// the gaps between matched lines are the hunks, matches were collected last to first
+	long iOld = 0;
+	long iNew = 0;
+	for (size_t index = matches.GetCount(); ; index -= 2)
+	{
+		long iOldMatch = index == 0 ? cOld : matches[index - 2];
+		long iNewMatch = index == 0 ? cNew : matches[index - 1];
+		if (iOldMatch != iOld || iNewMatch != iNew)
+		{
+			TextHunk hunk = {
+				oldRange.iFirst + iOld, oldRange.iFirst + iOldMatch,
+				newRange.iFirst + iNew, newRange.iFirst + iNewMatch};
+			hunks.Add(hunk);
+		}
+		if (index == 0)
+			break;
+		iOld = iOldMatch + 1;
+		iNew = iNewMatch + 1;
+	}
+	return true;
+}
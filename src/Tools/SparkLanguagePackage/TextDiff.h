@@ -0,0 +1,53 @@
+
+#pragma once
+
+#include "LineTable.h"
+#include "PooledArray.h"
+
+// Lines [iOldFirst, iOldEnd) of the old text are replaced by lines [iNewFirst, iNewEnd) of the new
+struct TextHunk
+{
+	long iOldFirst;
+	long iOldEnd;
+	long iNewFirst;
+	long iNewEnd;
+};
+
+// Finds the line ranges which differ between two versions of a text, so an editor buffer 
+// can be brought up to date with a few small replacements rather than a full reload.
+class TextDiff
+{
+public:
+	// limits on the work done for a line diff - past these the changed region is one hunk
+	enum 
+	{
+		MaximumEdits = 512,
+		MaximumHunks = 64,
+	};
+
+	// number of leading/trailing characters the two texts have in common, compared 8 at a time
+	static size_t CommonPrefix(const WCHAR* pText1, const WCHAR* pText2, size_t length);
+	static size_t CommonSuffix(const WCHAR* pEnd1, const WCHAR* pEnd2, size_t length);
+
+	static void DiffLines(
+		const WCHAR* pOldText, const LineTable& oldLines, 
+		const WCHAR* pNewText, const LineTable& newLines, 
+		PooledArray<TextHunk>& hunks);
+
+private:
+	struct LineRange
+	{
+		const WCHAR* pText;
+		const LineTable* pLines;
+		long iFirst;
+		CAtlArray<ULONG> hashes;
+
+		void Hash(long iEnd);
+		bool Equals(long iLine, const LineRange& other, long iOtherLine) const;
+	};
+
+	static bool Myers(
+		const LineRange& oldRange, long cOld, 
+		const LineRange& newRange, long cNew, 
+		PooledArray<TextHunk>& hunks);
+};
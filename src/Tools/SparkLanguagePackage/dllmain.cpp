@@ -1,15 +1,15 @@
-// dllmain.cpp : Implementation of DllMain.
-
-#include "stdafx.h"
-#include "resource.h"
-#include "SparkLanguagePackage_i.h"
-#include "dllmain.h"
-
-CSparkLanguagePackageModule _AtlModule;
-
-// DLL Entry Point
-extern "C" BOOL WINAPI DllMain(HINSTANCE hInstance, DWORD dwReason, LPVOID lpReserved)
-{
-	hInstance;
-	return _AtlModule.DllMain(dwReason, lpReserved); 
-}
+// dllmain.cpp : Implementation of DllMain.
+
+#include "stdafx.h"
+#include "resource.h"
+#include "SparkLanguagePackage_i.h"
+#include "dllmain.h"
+
+CSparkLanguagePackageModule _AtlModule;
+
+// DLL Entry Point
+extern "C" BOOL WINAPI DllMain(HINSTANCE hInstance, DWORD dwReason, LPVOID lpReserved)
+{
+	hInstance;
+	return _AtlModule.DllMain(dwReason, lpReserved); 
+}
@@ -1,23 +1,23 @@
-//{{NO_DEPENDENCIES}}
-// Microsoft Visual C++ generated include file.
-// Used by SparkLanguagePackage.rc
-//
-#define IDS_PROJNAME                    100
-#define IDR_SPARKLANGUAGEPACKAGE        101
-#define IDS_PLK                         101
-#define IDR_PACKAGE                     102
-#define IDI_SPARK                       201
-#define IDB_SPLASH                      202
-#define IDI_ICON1                       203
-#define IDI_ORBZ_LIGHTNING              203
-
-// Next default values for new objects
-// 
-#ifdef APSTUDIO_INVOKED
-#ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        204
-#define _APS_NEXT_COMMAND_VALUE         32768
-#define _APS_NEXT_CONTROL_VALUE         201
-#define _APS_NEXT_SYMED_VALUE           103
-#endif
-#endif
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by SparkLanguagePackage.rc
+//
+#define IDS_PROJNAME                    100
+#define IDR_SPARKLANGUAGEPACKAGE        101
+#define IDS_PLK                         101
+#define IDR_PACKAGE                     102
+#define IDI_SPARK                       201
+#define IDB_SPLASH                      202
+#define IDI_ICON1                       203
+#define IDI_ORBZ_LIGHTNING              203
+
+// Next default values for new objects
+// 
+#ifdef APSTUDIO_INVOKED
+#ifndef APSTUDIO_READONLY_SYMBOLS
+#define _APS_NEXT_RESOURCE_VALUE        204
+#define _APS_NEXT_COMMAND_VALUE         32768
+#define _APS_NEXT_CONTROL_VALUE         201
+#define _APS_NEXT_SYMED_VALUE           103
+#endif
+#endif